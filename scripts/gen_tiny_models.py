@@ -0,0 +1,93 @@
+"""生成极小的 det/rec ONNX 替身模型（基准测试用，无需真实 PP-OCRv5 权重）
+
+det: x[1,3,H,W] → 边缘密度 → Sigmoid → [1,1,H,W]，文字区域输出高概率，可产生真实的文本框
+rec: x[N,3,48,W] → AveragePool(48x8) → Conv1x1(3→C) → [N,T=W/8,C] Softmax，C = 字典大小 + 2（blank + 空格）
+
+用法: python scripts/gen_tiny_models.py --out bench_models [--dict model/ppocr_keys_v1.txt]
+"""
+import argparse
+import os
+import string
+
+import numpy as np
+import onnx
+from onnx import TensorProto, helper, numpy_helper
+
+
+def build_det(path, opset):
+    # 拉普拉斯边缘 → |·| → 9x9 均值平滑 → Sigmoid：文字笔画区域高概率，白底与黑色 padding 均为低概率
+    lap = np.array([[-1, -1, -1], [-1, 8, -1], [-1, -1, -1]], dtype=np.float32) / 3.0
+    weight = np.stack([lap, lap, lap])[None, :, :, :]  # [1,3,3,3]
+    nodes = [
+        helper.make_node("Conv", ["x", "det_w"], ["edges"], pads=[1, 1, 1, 1]),
+        helper.make_node("Abs", ["edges"], ["edges_abs"]),
+        helper.make_node("AveragePool", ["edges_abs"], ["density"], kernel_shape=[9, 9], pads=[4, 4, 4, 4]),
+        helper.make_node("Mul", ["density", "det_scale"], ["scaled"]),
+        helper.make_node("Add", ["scaled", "det_bias"], ["logits"]),
+        helper.make_node("Sigmoid", ["logits"], ["sigmoid_0.tmp_0"]),
+    ]
+    graph = helper.make_graph(
+        nodes, "tiny_det",
+        [helper.make_tensor_value_info("x", TensorProto.FLOAT, [1, 3, "H", "W"])],
+        [helper.make_tensor_value_info("sigmoid_0.tmp_0", TensorProto.FLOAT, [1, 1, "H", "W"])],
+        [numpy_helper.from_array(weight, "det_w"),
+         numpy_helper.from_array(np.array([4.0], dtype=np.float32), "det_scale"),
+         numpy_helper.from_array(np.array([-3.0], dtype=np.float32), "det_bias")],
+    )
+    save(graph, path, opset)
+
+
+def build_rec(path, num_classes, opset, seed):
+    rng = np.random.default_rng(seed)
+    weight = rng.normal(0.0, 1.0, (num_classes, 3, 1, 1)).astype(np.float32)
+    bias = rng.normal(0.0, 0.5, (num_classes,)).astype(np.float32)
+    bias[0] += 2.0  # 偏向 blank，使输出接近真实模型的稀疏字符
+    nodes = [
+        helper.make_node("AveragePool", ["x"], ["pooled"], kernel_shape=[48, 8], strides=[48, 8]),
+        helper.make_node("Conv", ["pooled", "rec_w", "rec_b"], ["logits"]),          # [N,C,1,T]
+        helper.make_node("Squeeze", ["logits", "squeeze_axes"], ["logits_sq"]),       # [N,C,T]
+        helper.make_node("Transpose", ["logits_sq"], ["logits_t"], perm=[0, 2, 1]),   # [N,T,C]
+        helper.make_node("Softmax", ["logits_t"], ["softmax_5.tmp_0"], axis=2),
+    ]
+    graph = helper.make_graph(
+        nodes, "tiny_rec",
+        [helper.make_tensor_value_info("x", TensorProto.FLOAT, ["N", 3, 48, "W"])],
+        [helper.make_tensor_value_info("softmax_5.tmp_0", TensorProto.FLOAT, ["N", "T", num_classes])],
+        [numpy_helper.from_array(weight, "rec_w"), numpy_helper.from_array(bias, "rec_b"),
+         numpy_helper.from_array(np.array([2], dtype=np.int64), "squeeze_axes")],
+    )
+    save(graph, path, opset)
+
+
+def save(graph, path, opset):
+    model = helper.make_model(graph, opset_imports=[helper.make_opsetid("", opset)])
+    model.ir_version = 8
+    onnx.checker.check_model(model)
+    onnx.save(model, path)
+    print(f"已生成: {path}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--out", default="bench_models")
+    parser.add_argument("--dict", help="已有字典（决定 rec 类别数）；缺省生成 ASCII 字典")
+    parser.add_argument("--opset", type=int, default=13)
+    parser.add_argument("--seed", type=int, default=0)
+    args = parser.parse_args()
+
+    os.makedirs(args.out, exist_ok=True)
+    if args.dict:
+        with open(args.dict, encoding="utf-8") as f:
+            chars = [line.rstrip("\n") for line in f if line.rstrip("\n")]
+    else:
+        chars = [c for c in string.digits + string.ascii_letters + string.punctuation]
+        with open(os.path.join(args.out, "tiny_keys.txt"), "w", encoding="utf-8") as f:
+            f.write("\n".join(chars) + "\n")
+        print(f"已生成: {os.path.join(args.out, 'tiny_keys.txt')} ({len(chars)} 字符)")
+
+    build_det(os.path.join(args.out, "tiny_det.onnx"), args.opset)
+    build_rec(os.path.join(args.out, "tiny_rec.onnx"), len(chars) + 2, args.opset, args.seed)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,51 @@
+"""动态 INT8 量化 det/rec ONNX 模型（onnxruntime.quantization.quantize_dynamic）
+
+权重离线量化为 INT8，激活在运行时按批次动态量化，无需校准集。rec 的 MatMul / Gemm 收益最大；
+det 以卷积为主，默认不量化 Conv（ConvInteger 在多数 CPU 上不快于 FP32，需自行评估）。
+量化后须用 ocr_quant_eval 在标注集上对比 FP32，通过后服务才会加载（批准清单 <model>.approval.json）。
+
+用法: python scripts/quantize_models.py --model models/ch_PP-OCRv5_rec_infer.onnx [--op-types MatMul,Gemm] [--per-channel]
+输出: models/ch_PP-OCRv5_rec_infer.int8.onnx（写入 service_config.json 的 rec_model.int8_path）
+"""
+import argparse
+import os
+
+from onnxruntime.quantization import QuantType, quantize_dynamic
+from onnxruntime.quantization.shape_inference import quant_pre_process
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--model", required=True, help="FP32 ONNX 模型")
+    parser.add_argument("--output", help="缺省为 <model>.int8.onnx")
+    parser.add_argument("--op-types", default="MatMul,Gemm", help="量化的算子类型，逗号分隔（可加 Conv）")
+    parser.add_argument("--per-channel", action="store_true", help="按输出通道量化权重（精度更好，体积略大）")
+    parser.add_argument("--weight-type", choices=["int8", "uint8"], default="int8")
+    parser.add_argument("--skip-preprocess", action="store_true", help="跳过 shape 推断与图优化预处理")
+    args = parser.parse_args()
+
+    output = args.output or os.path.splitext(args.model)[0] + ".int8.onnx"
+    source = args.model
+    if not args.skip_preprocess:
+        # 量化前做 shape 推断与常量折叠，否则部分 MatMul 因缺少形状信息被跳过
+        source = output + ".prep.onnx"
+        quant_pre_process(args.model, source, skip_symbolic_shape=True)
+
+    quantize_dynamic(
+        source,
+        output,
+        op_types_to_quantize=[op.strip() for op in args.op_types.split(",") if op.strip()],
+        per_channel=args.per_channel,
+        weight_type=QuantType.QInt8 if args.weight_type == "int8" else QuantType.QUInt8,
+    )
+    if source != args.model:
+        os.remove(source)
+
+    fp32_mb = os.path.getsize(args.model) / 1e6
+    int8_mb = os.path.getsize(output) / 1e6
+    print(f"已生成: {output} ({fp32_mb:.1f} MB → {int8_mb:.1f} MB)")
+    print("下一步: 配置 int8_path 后运行 ocr_quant_eval --labels <标注> 进行精度评估与批准")
+
+
+if __name__ == "__main__":
+    main()
@@ -1,9 +1,12 @@
 #include "ocr_service.h"
+#include "ocr_trace.h"
 #include <spdlog/spdlog.h>
+#include <spdlog/sinks/rotating_file_sink.h>
 #include <json.hpp>
 #include <fstream>
 #include <iostream>
 #include <stdexcept>
+#include <string>
 
 #ifndef GIT_VERSION
 #define GIT_VERSION "unknown"
@@ -12,18 +15,50 @@
 #define BUILD_TIME "unknown"
 #endif
 
+// 用法: ocr_server [config.json] [--cli <image_path>] [--profile <runs>] [--role <all|det|rec|frontend>] [--listen <addr>]
+struct CommandLine {
+    std::string config_path = "config/service_config.json";
+    std::string cli_image;  // 非空 = CLI 模式
+    int profile_runs = 0;   // > 0：对 det / rec 接下来 N 次 Run 开启 ORT 算子级剖析
+    std::string role;       // 覆盖 service.role（同一配置文件启动多个 worker）
+    std::string listen;     // 覆盖 service.listen，如 unix:/run/ocr/rec0.sock
+};
+
+static CommandLine ParseCommandLine(int argc, char** argv) {
+    CommandLine cmd;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--cli" || arg == "--profile" || arg == "--role" || arg == "--listen") {
+            if (i + 1 >= argc) throw std::invalid_argument("缺少参数值: " + arg);
+            std::string value = argv[++i];
+            if (arg == "--cli") cmd.cli_image = value;
+            else if (arg == "--role") cmd.role = value;
+            else if (arg == "--listen") cmd.listen = value;
+            else cmd.profile_runs = std::stoi(value);
+        } else if (arg.rfind("--", 0) == 0) {
+            throw std::invalid_argument("未知参数: " + arg);
+        } else {
+            cmd.config_path = arg;
+        }
+    }
+    return cmd;
+}
+
 int main(int argc, char** argv) {
     spdlog::info("Git Version: {}", GIT_VERSION);
     spdlog::info("Build Time: {}", BUILD_TIME);
 
     try {
-        std::string config_path = (argc > 1) ? argv[1] : "config/service_config.json";
+        CommandLine cmd = ParseCommandLine(argc, argv);
+        std::string config_path = cmd.config_path;
         std::ifstream config_file(config_path);
         if (!config_file.is_open()) {
             throw std::runtime_error("无法加载分层配置: " + config_path);
         }
         auto root_config = nlohmann::json::parse(config_file);
         auto service_config = root_config.at("service_config");
+        if (!cmd.role.empty()) service_config["service"]["role"] = cmd.role;
+        if (!cmd.listen.empty()) service_config["service"]["listen"] = cmd.listen;
 
         // 服务层加载
         auto service_layer = service_config.at("service");
@@ -35,30 +70,33 @@ int main(int argc, char** argv) {
         auto log_level_str = service_layer.value("log_level", "INFO");
         spdlog::level::level_enum log_level = spdlog::level::from_str(log_level_str);
         spdlog::set_level(log_level);
-        spdlog::set_pattern("[%Y-%m-%d %H:%M:%S.%e] [%^%l%$] [%t] %v");
         std::string log_file = service_layer.value("log_file", "logs/ocr_service.log");
         auto logger = spdlog::rotating_logger_mt("ocr_logger", log_file, 10485760, 5);
         spdlog::set_default_logger(logger);
+        InstallTraceLogFormatter("[%Y-%m-%d %H:%M:%S.%e] [%^%l%$] [%t] [%*] %v");  // %* = 请求 ID
 
-        // CLI 模式支持（同前）
-        if (argc > 1 && std::string(argv[1]) == "--cli") {
-            if (argc < 3) {
-                spdlog::error("CLI 用法: ocr_server.exe --cli <image_path>");
-                return -1;
-            }
-            std::string img_path = argv[2];
-            cv::Mat img = cv::imread(img_path);
+        // CLI 模式：单图推理；--profile N 时同一图像跑 N 次并附带剖析汇总
+        if (!cmd.cli_image.empty()) {
+            cv::Mat img = cv::imread(cmd.cli_image);
             if (img.empty()) {
-                spdlog::error("图像加载失败: {}", img_path);
+                spdlog::error("图像加载失败: {}", cmd.cli_image);
                 return -1;
             }
             OCRService service(service_config);
-            auto results = service.Infer(img);  // 假设 public 或 friend
-            std::cout << results.dump(2) << std::endl;
+            if (cmd.profile_runs <= 0) {
+                std::cout << service.Infer(img).dump(2) << std::endl;
+                return 0;
+            }
+            service.StartProfiling(cmd.profile_runs);
+            json results;
+            for (int i = 0; i < cmd.profile_runs; ++i) results = service.Infer(img);
+            service.StartProfiling(0);  // rec 的 Run 次数随文本行数变化，收尾时结束未完成的剖析
+            std::cout << json{{"ocr", results}, {"profile", service.ProfileStatus()}}.dump(2) << std::endl;
             return 0;
         }
 
-        OCRService service(service_config);
+        OCRService service(service_config, config_path);  // 传入路径以支持 /admin/reload 与配置监视
+        if (cmd.profile_runs > 0) service.StartProfiling(cmd.profile_runs);
         service.StartServer();
 
         spdlog::info("服务运行中 (端口: {}, 线程: {})", 
@@ -0,0 +1,279 @@
+#include "ocr_admission.h"
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+AdmissionController::AdmissionController(const json& admission_config) {
+    max_concurrency_ = std::max(1, admission_config.value("max_concurrency", 1));
+    strict_priority_ = admission_config.value("scheduler", "weighted") == "strict";
+    allow_priority_header_ = admission_config.value("allow_priority_header", true);
+
+    // 优先级类别：按配置顺序从高到低；未配置时单一 default 道
+    json classes = admission_config.value("priority_classes", json::array());
+    if (classes.empty()) {
+        classes.push_back({{"name", "default"}, {"weight", 1},
+                           {"max_queue_depth", admission_config.value("max_queue_depth", 16)}});
+    }
+    for (const auto& cls : classes) {
+        auto lane = std::make_unique<Lane>();
+        lane->name = cls.at("name").get<std::string>();
+        lane->weight = std::max(1, cls.value("weight", 1));
+        lane->max_queue_depth = std::max(0, cls.value("max_queue_depth", admission_config.value("max_queue_depth", 16)));
+        lanes_.push_back(std::move(lane));
+    }
+
+    std::string default_class = admission_config.value("default_class", lanes_.front()->name);
+    default_lane_ = -1;
+    for (size_t i = 0; i < lanes_.size(); ++i) {
+        if (lanes_[i]->name == default_class) default_lane_ = static_cast<int>(i);
+    }
+    if (default_lane_ < 0) throw std::invalid_argument("default_class 未定义: " + default_class);
+
+    json api_keys = admission_config.value("api_keys", json::object());
+    for (const auto& [key, cls] : api_keys.items()) {
+        std::string name = cls.get<std::string>();
+        auto it = std::find_if(lanes_.begin(), lanes_.end(), [&](const auto& l) { return l->name == name; });
+        if (it == lanes_.end()) throw std::invalid_argument("api_keys 引用了未定义的优先级类别: " + name);
+        api_key_lanes_[key] = static_cast<int>(it - lanes_.begin());
+    }
+
+    for (const auto& lane : lanes_) {
+        spdlog::info("准入控制道 {}: 权重 {}, 队列深度 {}", lane->name, lane->weight, lane->max_queue_depth);
+    }
+    spdlog::info("准入控制: 并发 {}, 调度 {}", max_concurrency_, strict_priority_ ? "strict" : "weighted");
+}
+
+int AdmissionController::ResolveLane(const std::string& api_key, const std::string& requested_class) const {
+    if (!api_key.empty()) {
+        auto it = api_key_lanes_.find(api_key);
+        if (it != api_key_lanes_.end()) return it->second;
+    }
+    if (allow_priority_header_ && !requested_class.empty()) {
+        for (size_t i = 0; i < lanes_.size(); ++i) {
+            if (lanes_[i]->name == requested_class) return static_cast<int>(i);
+        }
+    }
+    return default_lane_;
+}
+
+int AdmissionController::TotalQueueCapacity() const {
+    int total = 0;
+    for (const auto& lane : lanes_) total += lane->max_queue_depth;
+    return total;
+}
+
+bool AdmissionController::TryEnqueue(int lane_idx) {
+    Lane& lane = *lanes_[lane_idx];
+    size_t current = lane.queued.load(std::memory_order_relaxed);
+    do {
+        if (current >= static_cast<size_t>(lane.max_queue_depth)) {
+            lane.shed.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+    } while (!lane.queued.compare_exchange_weak(current, current + 1, std::memory_order_relaxed));
+    return true;
+}
+
+void AdmissionController::Dequeue(int lane_idx) {
+    lanes_[lane_idx]->queued.fetch_sub(1, std::memory_order_relaxed);
+}
+
+AdmissionController::Result AdmissionController::WaitForSlot(int lane_idx, Clock::time_point enqueue_time,
+                                                             Clock::time_point deadline) {
+    Lane& lane = *lanes_[lane_idx];
+    std::unique_lock<std::mutex> lock(mutex_);
+    bool granted = false;
+    if (in_flight_ < max_concurrency_ && waiting_ == 0) {
+        ++in_flight_;
+        granted = true;
+    } else {
+        Waiter waiter;
+        lane.waiters.push_back(&waiter);
+        ++waiting_;
+        waiter.cv.wait_until(lock, deadline, [&waiter] { return waiter.granted; });
+        granted = waiter.granted;
+        if (!granted) {
+            lane.waiters.erase(std::find(lane.waiters.begin(), lane.waiters.end(), &waiter));
+            --waiting_;
+        }
+    }
+    lock.unlock();
+
+    lane.queued.fetch_sub(1, std::memory_order_relaxed);
+    auto now = Clock::now();
+    lane.queue_time_us.fetch_add(std::chrono::duration_cast<std::chrono::microseconds>(now - enqueue_time).count(),
+                                 std::memory_order_relaxed);
+
+    // 拿到槽位时已过截止时间：客户端多半已放弃，推理前丢弃
+    if (granted && now >= deadline) {
+        Release(0);
+        granted = false;
+    }
+    if (!granted) {
+        lane.expired.fetch_add(1, std::memory_order_relaxed);
+        return Result::kExpired;
+    }
+    lane.admitted.fetch_add(1, std::memory_order_relaxed);
+    return Result::kAdmitted;
+}
+
+AdmissionController::Waiter* AdmissionController::PickNextWaiter() {
+    Lane* chosen = nullptr;
+    if (strict_priority_) {
+        for (auto& lane : lanes_) {
+            if (!lane->waiters.empty()) {
+                chosen = lane.get();
+                break;
+            }
+        }
+    } else {
+        // 平滑加权轮询：仅在有等待者的道之间分配
+        int total = 0;
+        for (auto& lane : lanes_) {
+            if (lane->waiters.empty()) continue;
+            lane->current_weight += lane->weight;
+            total += lane->weight;
+            if (!chosen || lane->current_weight > chosen->current_weight) chosen = lane.get();
+        }
+        if (chosen) chosen->current_weight -= total;
+    }
+    if (!chosen) return nullptr;
+    Waiter* next = chosen->waiters.front();
+    chosen->waiters.pop_front();
+    --waiting_;
+    return next;
+}
+
+void AdmissionController::Release(int64_t service_us) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (service_us > 0) {
+        avg_service_us_ = avg_service_us_ == 0.0 ? service_us : 0.9 * avg_service_us_ + 0.1 * service_us;
+    }
+    if (Waiter* next = PickNextWaiter()) {
+        // 槽位直接移交，in_flight_ 不变
+        next->granted = true;
+        next->cv.notify_one();
+    } else {
+        --in_flight_;
+    }
+}
+
+void AdmissionController::ObserveLatency(int lane_idx, double seconds) {
+    lanes_[lane_idx]->latency_seconds.Observe(seconds);
+}
+
+size_t AdmissionController::QueueDepth() const {
+    size_t depth = 0;
+    for (const auto& lane : lanes_) depth += lane->queued.load(std::memory_order_relaxed);
+    return depth;
+}
+
+uint64_t AdmissionController::ShedCount() const {
+    uint64_t shed = 0;
+    for (const auto& lane : lanes_) shed += lane->shed.load(std::memory_order_relaxed);
+    return shed;
+}
+
+int AdmissionController::RetryAfterSeconds() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    double backlog = static_cast<double>(QueueDepth() + in_flight_);
+    double seconds = backlog * avg_service_us_ / max_concurrency_ / 1e6;
+    return std::clamp(static_cast<int>(std::ceil(seconds)), 1, 60);
+}
+
+json AdmissionController::Stats() const {
+    int in_flight;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        in_flight = in_flight_;
+    }
+    json classes = json::object();
+    uint64_t admitted = 0, expired = 0;
+    for (const auto& lane : lanes_) {
+        uint64_t lane_admitted = lane->admitted.load(std::memory_order_relaxed);
+        uint64_t lane_expired = lane->expired.load(std::memory_order_relaxed);
+        uint64_t waited = lane_admitted + lane_expired;
+        classes[lane->name] = {
+            {"queue_depth", lane->queued.load(std::memory_order_relaxed)},
+            {"max_queue_depth", lane->max_queue_depth},
+            {"weight", lane->weight},
+            {"admitted", lane_admitted},
+            {"shed", lane->shed.load(std::memory_order_relaxed)},
+            {"expired", lane_expired},
+            {"avg_queue_ms", waited ? lane->queue_time_us.load(std::memory_order_relaxed) / 1000.0 / waited : 0.0},
+            {"latency_seconds", lane->latency_seconds.ToJson()}
+        };
+        admitted += lane_admitted;
+        expired += lane_expired;
+    }
+    return {
+        {"queue_depth", QueueDepth()},
+        {"in_flight", in_flight},
+        {"admitted", admitted},
+        {"shed", ShedCount()},
+        {"expired", expired},
+        {"scheduler", strict_priority_ ? "strict" : "weighted"},
+        {"classes", classes}
+    };
+}
+
+std::string AdmissionController::PrometheusText() const {
+    int in_flight;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        in_flight = in_flight_;
+    }
+    std::string out;
+    out += "# HELP ocr_admission_in_flight Requests currently holding an inference slot\n";
+    out += "# TYPE ocr_admission_in_flight gauge\n";
+    out += "ocr_admission_in_flight " + std::to_string(in_flight) + "\n";
+
+    auto per_lane = [&](const char* name, const char* type, const char* help, auto value) {
+        out += std::string("# HELP ") + name + " " + help + "\n";
+        out += std::string("# TYPE ") + name + " " + type + "\n";
+        for (const auto& lane : lanes_) {
+            out += std::string(name) + "{class=\"" + lane->name + "\"} " + std::to_string(value(*lane)) + "\n";
+        }
+    };
+    per_lane("ocr_admission_queue_depth", "gauge", "Requests waiting for an inference slot",
+             [](const Lane& l) { return l.queued.load(std::memory_order_relaxed); });
+    per_lane("ocr_admission_admitted_total", "counter", "Requests admitted to inference",
+             [](const Lane& l) { return l.admitted.load(std::memory_order_relaxed); });
+    per_lane("ocr_admission_shed_total", "counter", "Requests rejected because the queue was full",
+             [](const Lane& l) { return l.shed.load(std::memory_order_relaxed); });
+    per_lane("ocr_admission_expired_total", "counter", "Requests dropped after exceeding their deadline in queue",
+             [](const Lane& l) { return l.expired.load(std::memory_order_relaxed); });
+
+    out += "# HELP ocr_request_latency_seconds End-to-end /ocr latency by priority class\n";
+    out += "# TYPE ocr_request_latency_seconds histogram\n";
+    for (const auto& lane : lanes_) {
+        lane->latency_seconds.AppendPrometheus(out, "ocr_request_latency_seconds", "class=\"" + lane->name + "\"");
+    }
+    return out;
+}
+
+AdmissionTicket::~AdmissionTicket() {
+    if (state_ == State::kQueued) {
+        controller_.Dequeue(lane_);
+    } else if (state_ == State::kRunning) {
+        auto service_us = std::chrono::duration_cast<std::chrono::microseconds>(
+            AdmissionController::Clock::now() - start_time_).count();
+        controller_.Release(service_us);
+    }
+}
+
+bool AdmissionTicket::Enqueue() {
+    if (!controller_.TryEnqueue(lane_)) return false;
+    state_ = State::kQueued;
+    enqueue_time_ = AdmissionController::Clock::now();
+    return true;
+}
+
+AdmissionController::Result AdmissionTicket::Wait(AdmissionController::Clock::time_point deadline) {
+    auto result = controller_.WaitForSlot(lane_, enqueue_time_, deadline);
+    start_time_ = AdmissionController::Clock::now();
+    queue_time_us_ = std::chrono::duration_cast<std::chrono::microseconds>(start_time_ - enqueue_time_).count();
+    state_ = (result == AdmissionController::Result::kAdmitted) ? State::kRunning : State::kDone;
+    return result;
+}
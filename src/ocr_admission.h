@@ -0,0 +1,115 @@
+#ifndef OCR_ADMISSION_H
+#define OCR_ADMISSION_H
+
+#include "ocr_metrics.h"
+#include <json.hpp>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using json = nlohmann::json;
+
+// 推理前的准入控制：按优先级分道的有界等待队列 + 并发槽位，队满快速拒绝（503）
+// 槽位释放时按调度策略选择下一条道：strict（高优先级道先行）或 weighted（平滑加权轮询）
+class AdmissionController {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    enum class Result {
+        kAdmitted,   // 获得推理槽位
+        kRejected,   // 队列已满，直接拒绝
+        kExpired     // 排队期间已超过截止时间
+    };
+
+    explicit AdmissionController(const json& admission_config);
+
+    // 优先级解析：API key 映射优先，其次请求声明的类别（允许时），否则默认类别
+    int ResolveLane(const std::string& api_key, const std::string& requested_class) const;
+    const std::string& LaneName(int lane) const { return lanes_[lane]->name; }
+    int TotalQueueCapacity() const;
+
+    // 占用所在道的一个队列位置（在解码前调用，失败即 503）
+    bool TryEnqueue(int lane);
+    // 等待推理槽位；须先 TryEnqueue 成功，enqueue_time 用于排队耗时统计
+    Result WaitForSlot(int lane, Clock::time_point enqueue_time, Clock::time_point deadline);
+    // 放弃已占用的队列位置（未进入 WaitForSlot 即退出时）
+    void Dequeue(int lane);
+    // 释放推理槽位，service_us 用于估算 Retry-After
+    void Release(int64_t service_us);
+    // 记录该类别请求的端到端延迟（秒）
+    void ObserveLatency(int lane, double seconds);
+
+    int RetryAfterSeconds() const;  // 按队列长度与平均耗时估算
+    json Stats() const;
+    std::string PrometheusText() const;  // ocr_admission_* 指标（按 class 标签）
+
+    size_t QueueDepth() const;
+    uint64_t ShedCount() const;
+
+private:
+    struct Waiter {
+        std::condition_variable cv;
+        bool granted = false;
+    };
+
+    struct Lane {
+        std::string name;
+        int weight = 1;
+        int max_queue_depth = 16;
+        int current_weight = 0;        // 加权轮询状态（受 mutex_ 保护）
+        std::deque<Waiter*> waiters;   // FIFO（受 mutex_ 保护）
+        std::atomic<size_t> queued{0};
+        std::atomic<uint64_t> admitted{0};
+        std::atomic<uint64_t> shed{0};
+        std::atomic<uint64_t> expired{0};
+        std::atomic<uint64_t> queue_time_us{0};  // 累计排队时间
+        Histogram latency_seconds{Histogram::LatencyBounds()};
+    };
+
+    int max_concurrency_;
+    bool strict_priority_;
+    bool allow_priority_header_;
+    int default_lane_ = 0;
+    std::vector<std::unique_ptr<Lane>> lanes_;  // 下标越小优先级越高
+    std::map<std::string, int> api_key_lanes_;
+
+    mutable std::mutex mutex_;
+    int in_flight_ = 0;
+    size_t waiting_ = 0;           // 所有道中等待槽位的请求数
+    double avg_service_us_ = 0.0;  // EWMA
+
+    Waiter* PickNextWaiter();  // 持 mutex_ 调用
+};
+
+// RAII：一次请求在准入控制中的生命周期（排队 → 推理 → 释放）
+class AdmissionTicket {
+public:
+    AdmissionTicket(AdmissionController& controller, int lane) : controller_(controller), lane_(lane) {}
+    ~AdmissionTicket();
+    AdmissionTicket(const AdmissionTicket&) = delete;
+    AdmissionTicket& operator=(const AdmissionTicket&) = delete;
+
+    bool Enqueue();
+    AdmissionController::Result Wait(AdmissionController::Clock::time_point deadline);
+    int64_t QueueTimeUs() const { return queue_time_us_; }
+    int Lane() const { return lane_; }
+
+private:
+    enum class State { kIdle, kQueued, kRunning, kDone };
+
+    AdmissionController& controller_;
+    int lane_;
+    State state_ = State::kIdle;
+    AdmissionController::Clock::time_point enqueue_time_;
+    AdmissionController::Clock::time_point start_time_;
+    int64_t queue_time_us_ = 0;
+};
+
+#endif // OCR_ADMISSION_H
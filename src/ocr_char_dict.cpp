@@ -0,0 +1,139 @@
+#include "ocr_char_dict.h"
+#include "ocr_model_loader.h"
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+constexpr std::string_view kSpace = " ";
+
+}  // namespace
+
+uint32_t Utf8Next(std::string_view s, size_t& pos) {
+    unsigned char c = static_cast<unsigned char>(s[pos]);
+    int extra = c < 0x80 ? 0 : (c >> 5) == 0x6 ? 1 : (c >> 4) == 0xE ? 2 : (c >> 3) == 0x1E ? 3 : -1;
+    if (extra < 0 || pos + extra >= s.size()) {
+        ++pos;
+        return c;
+    }
+    for (int i = 1; i <= extra; ++i) {
+        if ((static_cast<unsigned char>(s[pos + i]) & 0xC0) != 0x80) {  // 续字节缺失
+            ++pos;
+            return c;
+        }
+    }
+    uint32_t cp = extra == 0 ? c : (c & (0x3F >> extra));
+    for (int i = 1; i <= extra; ++i) cp = (cp << 6) | (static_cast<unsigned char>(s[pos + i]) & 0x3F);
+    pos += extra + 1;
+    return cp;
+}
+
+size_t Utf8PrefixBytes(std::string_view s, size_t max_codepoints) {
+    size_t pos = 0;
+    for (size_t n = 0; n < max_codepoints && pos < s.size(); ++n) Utf8Next(s, pos);
+    return pos;
+}
+
+CharDict::CharDict(const std::vector<std::string>& chars) {
+    std::vector<std::pair<size_t, size_t>> spans;
+    spans.reserve(chars.size());
+    for (const auto& ch : chars) {
+        spans.emplace_back(blob_.size(), ch.size());
+        blob_ += ch;
+    }
+    Index(std::move(spans), blob_.data(), false);
+}
+
+CharDict::CharDict(const std::string& path, bool use_space_char, bool mmap) : path_(path) {
+    const char* base = nullptr;
+    size_t size = 0;
+    if (mmap) {
+        mapping_ = std::make_shared<const MappedModel>(path);
+        base = static_cast<const char*>(mapping_->Data());
+        size = mapping_->Size();
+    } else {
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open()) throw std::runtime_error("字典文件无法打开: " + path);
+        std::ostringstream content;
+        content << file.rdbuf();
+        blob_ = content.str();
+        base = blob_.data();
+        size = blob_.size();
+    }
+
+    // 按行切分：只记录位置，不复制字符
+    std::vector<std::pair<size_t, size_t>> spans;
+    size_t pos = (size >= 3 && std::string_view(base, 3) == "\xEF\xBB\xBF") ? 3 : 0;
+    while (pos < size) {
+        const char* newline = static_cast<const char*>(std::memchr(base + pos, '\n', size - pos));
+        size_t end = newline ? static_cast<size_t>(newline - base) : size;
+        size_t len = end - pos;
+        if (len > 0 && base[pos + len - 1] == '\r') --len;
+        if (len > 0) spans.emplace_back(pos, len);
+        pos = end + 1;
+    }
+    if (spans.empty()) throw std::runtime_error("字典为空: " + path);
+    Index(std::move(spans), base, use_space_char);
+}
+
+CharDict::~CharDict() = default;
+
+void CharDict::Index(std::vector<std::pair<size_t, size_t>> spans, const char* base, bool use_space_char) {
+    if (spans.empty() && !use_space_char) throw std::invalid_argument("字典为空");
+    use_space_char_ = use_space_char;
+    entries_.reserve(spans.size() + 1);
+    for (const auto& [offset, len] : spans) entries_.emplace_back(base + offset, len);
+    if (use_space_char) entries_.push_back(kSpace);  // PaddleOCR：空格为最后一个字符类
+    index_.reserve(entries_.size());
+    for (size_t i = 0; i < entries_.size(); ++i) {
+        index_.emplace(entries_[i], static_cast<int>(i));  // 重复字符保留首个
+        max_char_bytes_ = std::max(max_char_bytes_, entries_[i].size());
+    }
+}
+
+int CharDict::Find(std::string_view ch) const {
+    auto it = index_.find(ch);
+    return it == index_.end() ? -1 : it->second;
+}
+
+json CharDict::Info() const {
+    size_t bytes = 0;
+    for (const auto& entry : entries_) bytes += entry.size();
+    return {
+        {"path", path_},
+        {"size", entries_.size()},
+        {"bytes", bytes},
+        {"mmap", mapping_ != nullptr},
+        {"use_space_char", use_space_char_}
+    };
+}
+
+std::shared_ptr<const CharDict> CharDict::Load(const json& dict_config) {
+    std::string path = dict_config.at("path").get<std::string>();
+    bool use_space_char = dict_config.value("use_space_char", true);
+    bool mmap = dict_config.value("mmap", false);
+
+    // 键含文件大小与修改时间：替换字典文件后不会复用旧内容
+    std::error_code ec;
+    auto size = std::filesystem::file_size(path, ec);
+    if (ec) throw std::runtime_error("字典文件无法打开: " + path);
+    auto mtime = std::filesystem::last_write_time(path, ec).time_since_epoch().count();
+    std::string key = path + "|" + std::to_string(size) + "|" + std::to_string(mtime) + "|" +
+                      (use_space_char ? "space" : "") + "|" + (mmap ? "mmap" : "");
+
+    static std::mutex mutex;
+    static std::map<std::string, std::weak_ptr<const CharDict>> cache;
+    std::lock_guard<std::mutex> lock(mutex);
+    if (auto cached = cache[key].lock()) return cached;
+    auto dict = std::make_shared<const CharDict>(path, use_space_char, mmap);
+    cache[key] = dict;
+    spdlog::info("字典加载: {} ({} 字符, 空格类: {}, mmap: {})", path, dict->Size(), use_space_char, mmap);
+    return dict;
+}
@@ -0,0 +1,60 @@
+#ifndef OCR_CHAR_DICT_H
+#define OCR_CHAR_DICT_H
+
+#include <json.hpp>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+using json = nlohmann::json;
+
+class MappedModel;
+
+// 解码一个 UTF-8 码点，pos 前进；非法或不完整的序列按单字节处理
+uint32_t Utf8Next(std::string_view s, size_t& pos);
+// s 的前 max_codepoints 个码点所占字节数（截断不会切开多字节字符）
+size_t Utf8PrefixBytes(std::string_view s, size_t max_codepoints);
+
+// 识别字典（不可变）：全部字符存于一块连续 UTF-8 内存（读入的文件内容或其只读映射），
+// 条目表只记录每个字符的位置，不再每个字符一个堆字符串。
+// 类别约定同 PaddleOCR：类别 0 为 blank，类别 i 对应 Char(i - 1)；use_space_char 时在末尾追加空格
+class CharDict {
+public:
+    // 由字符列表构造（测试 / 工具）
+    explicit CharDict(const std::vector<std::string>& chars);
+    // 从文件加载：每行一个字符（去掉 \r 与 UTF-8 BOM），空行跳过；mmap 时条目直接引用映射内存
+    CharDict(const std::string& path, bool use_space_char, bool mmap);
+    ~CharDict();
+    CharDict(const CharDict&) = delete;
+    CharDict& operator=(const CharDict&) = delete;
+
+    // 按 character_dict 配置（path / use_space_char / mmap）加载。进程内按文件与参数缓存，
+    // 同一字典在多个 rec session（多语言共用字典、热重载新旧管道）间共享同一份
+    static std::shared_ptr<const CharDict> Load(const json& dict_config);
+
+    size_t Size() const { return entries_.size(); }
+    // 模型应有的输出类别数（含 blank）
+    size_t NumClasses() const { return entries_.size() + 1; }
+    std::string_view Char(size_t i) const { return entries_[i]; }
+    size_t MaxCharBytes() const { return max_char_bytes_; }
+    // 字符 → 下标（0 起），不存在返回 -1
+    int Find(std::string_view ch) const;
+    // path / size / bytes / mmap / use_space_char
+    json Info() const;
+
+private:
+    void Index(std::vector<std::pair<size_t, size_t>> spans, const char* base, bool use_space_char);
+
+    std::string path_;
+    std::string blob_;                           // 非 mmap：文件内容 / 字符拼接
+    std::shared_ptr<const MappedModel> mapping_; // mmap：只读映射
+    std::vector<std::string_view> entries_;      // 指向 blob_ 或映射
+    std::unordered_map<std::string_view, int> index_;
+    size_t max_char_bytes_ = 0;
+    bool use_space_char_ = false;
+};
+
+#endif // OCR_CHAR_DICT_H
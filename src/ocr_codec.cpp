@@ -0,0 +1,95 @@
+#include "ocr_codec.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <sstream>
+
+namespace {
+
+std::string Trim(const std::string& s) {
+    size_t begin = s.find_first_not_of(" \t");
+    if (begin == std::string::npos) return "";
+    size_t end = s.find_last_not_of(" \t");
+    return s.substr(begin, end - begin + 1);
+}
+
+// 媒体类型 → 格式；不支持的类型返回 false
+bool MatchMediaType(const std::string& media, ResponseFormat& format) {
+    if (media == "application/msgpack" || media == "application/x-msgpack" ||
+        media == "application/vnd.msgpack") {
+        format = ResponseFormat::kMsgpack;
+        return true;
+    }
+    if (media == "application/cbor") {
+        format = ResponseFormat::kCbor;
+        return true;
+    }
+    if (media == "application/json" || media == "application/*" || media == "*/*") {
+        format = ResponseFormat::kJson;
+        return true;
+    }
+    return false;
+}
+
+}  // namespace
+
+ResponseFormat NegotiateFormat(const std::string& accept) {
+    ResponseFormat best = ResponseFormat::kJson;
+    float best_q = 0.0f;
+
+    std::stringstream ss(accept);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        // "type/subtype;q=0.8" → 媒体类型 + q 值
+        std::string media = item;
+        float q = 1.0f;
+        size_t semi = item.find(';');
+        if (semi != std::string::npos) {
+            media = item.substr(0, semi);
+            std::string params = item.substr(semi + 1);
+            size_t qpos = params.find("q=");
+            if (qpos != std::string::npos) q = std::strtof(params.c_str() + qpos + 2, nullptr);
+        }
+        media = Trim(media);
+        std::transform(media.begin(), media.end(), media.begin(),
+                       [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+        ResponseFormat format;
+        if (q <= 0.0f || !MatchMediaType(media, format)) continue;
+        if (q > best_q) {  // 同 q 值取先出现者
+            best = format;
+            best_q = q;
+        }
+    }
+    return best;
+}
+
+std::string EncodeResponse(const json& response, ResponseFormat format, std::string& content_type) {
+    switch (format) {
+        case ResponseFormat::kMsgpack: {
+            content_type = "application/msgpack";
+            std::string out;
+            json::to_msgpack(response, out);  // 直接写入 string，避免 vector 拷贝
+            return out;
+        }
+        case ResponseFormat::kCbor: {
+            content_type = "application/cbor";
+            std::string out;
+            json::to_cbor(response, out);  // 直接写入 string，避免 vector 拷贝
+            return out;
+        }
+        case ResponseFormat::kJson:
+        default:
+            content_type = "application/json";
+            return response.dump(2);
+    }
+}
+
+const char* FormatName(ResponseFormat format) {
+    switch (format) {
+        case ResponseFormat::kMsgpack: return "msgpack";
+        case ResponseFormat::kCbor: return "cbor";
+        case ResponseFormat::kJson:
+        default: return "json";
+    }
+}
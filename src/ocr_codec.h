@@ -0,0 +1,24 @@
+#ifndef OCR_CODEC_H
+#define OCR_CODEC_H
+
+#include <json.hpp>
+#include <string>
+
+using json = nlohmann::json;
+
+// /ocr 响应编码格式（由 Accept 头协商）
+enum class ResponseFormat {
+    kJson,
+    kMsgpack,
+    kCbor
+};
+
+// 解析 Accept 头（支持 q 值），未匹配时回退 JSON
+ResponseFormat NegotiateFormat(const std::string& accept);
+
+// 按格式序列化响应，content_type 输出对应 MIME 类型
+std::string EncodeResponse(const json& response, ResponseFormat format, std::string& content_type);
+
+const char* FormatName(ResponseFormat format);
+
+#endif // OCR_CODEC_H
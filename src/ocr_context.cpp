@@ -0,0 +1,49 @@
+#include "ocr_context.h"
+#include <spdlog/spdlog.h>
+
+DeadlineWatchdog::DeadlineWatchdog() : thread_(&DeadlineWatchdog::Loop, this) {}
+
+DeadlineWatchdog::~DeadlineWatchdog() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    cv_.notify_one();
+    thread_.join();
+}
+
+void DeadlineWatchdog::Watch(RequestContext* ctx) {
+    bool earliest;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = entries_.emplace(ctx->deadline, ctx).first;
+        earliest = (it == entries_.begin());
+    }
+    if (earliest) cv_.notify_one();  // 唤醒线程重新计算等待时间
+}
+
+void DeadlineWatchdog::Unwatch(RequestContext* ctx) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.erase({ctx->deadline, ctx});
+}
+
+void DeadlineWatchdog::Loop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stop_) {
+        if (entries_.empty()) {
+            cv_.wait(lock);
+            continue;
+        }
+        auto next = entries_.begin()->first;
+        if (RequestContext::Clock::now() < next) {
+            cv_.wait_until(lock, next);
+            continue;
+        }
+        // 到期：终止该请求所有进行中的 Run（持锁，保证 ctx 未被 Unwatch 释放）
+        RequestContext* ctx = entries_.begin()->second;
+        entries_.erase(entries_.begin());
+        ctx->timed_out.store(true, std::memory_order_relaxed);
+        ctx->run_options.SetTerminate();
+        spdlog::debug("请求截止时间已到，终止推理");
+    }
+}
@@ -0,0 +1,68 @@
+#ifndef OCR_CONTEXT_H
+#define OCR_CONTEXT_H
+
+#include <onnxruntime_cxx_api.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <set>
+#include <thread>
+
+// 单次请求的上下文：截止时间 + 可从外部终止的 ORT RunOptions
+struct RequestContext {
+    using Clock = std::chrono::steady_clock;
+
+    Clock::time_point deadline = Clock::time_point::max();
+    Ort::RunOptions run_options;        // 超时由看门狗 SetTerminate，中断正在运行的 Session::Run
+    std::atomic<bool> timed_out{false};  // 截止时间已到（看门狗或阶段检查置位）
+
+    bool HasDeadline() const { return deadline != Clock::time_point::max(); }
+    // 阶段间检查：到期即置位 timed_out
+    bool CheckDeadline() {
+        if (!timed_out.load(std::memory_order_relaxed) && HasDeadline() && Clock::now() >= deadline) {
+            timed_out.store(true, std::memory_order_relaxed);
+        }
+        return !timed_out.load(std::memory_order_relaxed);
+    }
+};
+
+// 截止时间看门狗：单后台线程，在最早到期的请求上调用 RunOptions::SetTerminate
+class DeadlineWatchdog {
+public:
+    DeadlineWatchdog();
+    ~DeadlineWatchdog();
+
+    void Watch(RequestContext* ctx);
+    void Unwatch(RequestContext* ctx);
+
+private:
+    using Entry = std::pair<RequestContext::Clock::time_point, RequestContext*>;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::set<Entry> entries_;  // 按截止时间排序
+    bool stop_ = false;
+    std::thread thread_;
+
+    void Loop();
+};
+
+// RAII：请求推理期间登记到看门狗
+class ScopedDeadlineWatch {
+public:
+    ScopedDeadlineWatch(DeadlineWatchdog& watchdog, RequestContext* ctx) : watchdog_(watchdog), ctx_(ctx) {
+        if (ctx_ && ctx_->HasDeadline()) watchdog_.Watch(ctx_);
+    }
+    ~ScopedDeadlineWatch() {
+        if (ctx_ && ctx_->HasDeadline()) watchdog_.Unwatch(ctx_);
+    }
+    ScopedDeadlineWatch(const ScopedDeadlineWatch&) = delete;
+    ScopedDeadlineWatch& operator=(const ScopedDeadlineWatch&) = delete;
+
+private:
+    DeadlineWatchdog& watchdog_;
+    RequestContext* ctx_;
+};
+
+#endif // OCR_CONTEXT_H
@@ -0,0 +1,124 @@
+#include "ocr_crop_filter.h"
+#include "ocr_metrics.h"
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+
+constexpr int kFeatureHeight = 32;       // 特征在此高度上计算，与框大小无关
+constexpr int kMaxFeatureWidth = 1024;
+constexpr int kMinComponentArea = 3;     // 更小的连通域视为噪点
+
+Counter& FilteredCounter(const std::string& reason, bool shadow) {
+    return MetricsRegistry::Instance().GetCounter(
+        shadow ? "ocr_crops_prefilter_shadow_total" : "ocr_crops_filtered_total",
+        shadow ? "Crops the pre-filter would have dropped (shadow mode, still recognized)"
+               : "Crops dropped by the pre-filter before recognition",
+        "reason=\"" + reason + "\"");
+}
+
+}  // namespace
+
+CropFeatures ComputeCropFeatures(const cv::Mat& crop, const cv::Mat& mask_roi) {
+    CropFeatures features;
+    if (!mask_roi.empty()) {
+        features.mask_fill = static_cast<double>(cv::countNonZero(mask_roi)) / mask_roi.total();
+    }
+    if (crop.empty()) return features;
+
+    cv::Mat gray;
+    if (crop.channels() == 3) cv::cvtColor(crop, gray, cv::COLOR_BGR2GRAY);
+    else gray = crop;
+    int width = std::clamp(static_cast<int>(static_cast<double>(gray.cols) * kFeatureHeight / gray.rows), 1, kMaxFeatureWidth);
+    cv::Mat small;
+    cv::resize(gray, small, cv::Size(width, kFeatureHeight), 0, 0, cv::INTER_AREA);
+
+    cv::Scalar mean, stddev;
+    cv::meanStdDev(small, mean, stddev);
+    features.contrast = stddev[0];
+    if (features.contrast < 1.0) return features;  // 近似纯色：Otsu 无意义
+
+    // 墨迹取二值化后的少数一侧（兼容深底浅字）
+    cv::Mat ink;
+    cv::threshold(small, ink, 0, 255, cv::THRESH_BINARY_INV | cv::THRESH_OTSU);
+    int ink_pixels = cv::countNonZero(ink);
+    if (ink_pixels * 2 > static_cast<int>(ink.total())) {
+        cv::bitwise_not(ink, ink);
+        ink_pixels = static_cast<int>(ink.total()) - ink_pixels;
+    }
+    features.ink_ratio = static_cast<double>(ink_pixels) / ink.total();
+
+    cv::Mat labels, stats, centroids;
+    int count = cv::connectedComponentsWithStats(ink, labels, stats, centroids, 8);
+    int largest_w = 0, largest_h = 0, largest_area = 0;
+    for (int i = 1; i < count; ++i) {  // 0 为背景
+        int area = stats.at<int>(i, cv::CC_STAT_AREA);
+        if (area < kMinComponentArea) continue;
+        ++features.components;
+        if (area > largest_area) {
+            largest_area = area;
+            largest_w = stats.at<int>(i, cv::CC_STAT_WIDTH);
+            largest_h = stats.at<int>(i, cv::CC_STAT_HEIGHT);
+        }
+    }
+    if (features.components == 1) {
+        double w = static_cast<double>(largest_w) / small.cols, h = static_cast<double>(largest_h) / small.rows;
+        features.rule_line = (w >= 0.9 && h <= 0.3) || (h >= 0.9 && w <= 0.3 && small.cols >= small.rows);
+    }
+    return features;
+}
+
+CropFilter::CropFilter(const json& config) {
+    std::string mode = config.value("mode", config.value("enabled", false) ? "enforce" : "off");
+    if (mode == "off") mode_ = Mode::kOff;
+    else if (mode == "enforce") mode_ = Mode::kEnforce;
+    else if (mode == "shadow") mode_ = Mode::kShadow;
+    else throw std::invalid_argument("未知 crop_filter.mode: " + mode + "（可选 off / enforce / shadow）");
+    min_contrast_ = config.value("min_contrast", 6.0);
+    min_ink_ratio_ = config.value("min_ink_ratio", 0.01);
+    min_components_ = config.value("min_components", 1);
+    min_mask_fill_ = config.value("min_mask_fill", 0.1);
+    drop_rule_lines_ = config.value("drop_rule_lines", true);
+    if (mode_ == Mode::kShadow) {
+        shadow_misses_ = &MetricsRegistry::Instance().GetCounter(
+            "ocr_crops_prefilter_shadow_recognized_total",
+            "Shadow-mode crops the pre-filter would have dropped but recognition returned text for");
+    }
+    if (Enabled()) {
+        spdlog::info("裁剪预过滤: {} (min_contrast {}, min_ink_ratio {}, min_components {}, min_mask_fill {}, rule_line {})",
+                     ModeName(), min_contrast_, min_ink_ratio_, min_components_, min_mask_fill_, drop_rule_lines_);
+    }
+}
+
+const std::vector<std::string>& CropFilter::Reasons() {
+    static const std::vector<std::string> reasons{"low_contrast", "low_ink", "no_components", "rule_line", "sparse_mask"};
+    return reasons;
+}
+
+const char* CropFilter::ModeName() const {
+    switch (mode_) {
+        case Mode::kEnforce: return "enforce";
+        case Mode::kShadow: return "shadow";
+        default: return "off";
+    }
+}
+
+CropFilter::Decision CropFilter::Evaluate(const cv::Mat& crop, const cv::Mat& mask_roi) const {
+    Decision decision;
+    if (!Enabled()) return decision;
+    decision.features = ComputeCropFeatures(crop, mask_roi);
+    const CropFeatures& f = decision.features;
+    if (f.contrast < min_contrast_) decision.reason = "low_contrast";
+    else if (f.ink_ratio < min_ink_ratio_) decision.reason = "low_ink";
+    else if (f.components < min_components_) decision.reason = "no_components";
+    else if (drop_rule_lines_ && f.rule_line) decision.reason = "rule_line";
+    else if (f.mask_fill < min_mask_fill_) decision.reason = "sparse_mask";
+    decision.drop = !decision.reason.empty();
+    if (decision.drop) FilteredCounter(decision.reason, mode_ == Mode::kShadow).Inc();
+    return decision;
+}
+
+void CropFilter::RecordShadowMiss(const Decision& decision) const {
+    if (shadow_misses_ && decision.drop) shadow_misses_->Inc();
+}
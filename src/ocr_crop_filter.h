@@ -0,0 +1,60 @@
+#ifndef OCR_CROP_FILTER_H
+#define OCR_CROP_FILTER_H
+
+#include <opencv2/opencv.hpp>
+#include <json.hpp>
+#include <string>
+#include <vector>
+
+using json = nlohmann::json;
+
+class Counter;
+
+// 裁剪的廉价特征（识别前计算，开销远小于一次 rec 推理）
+struct CropFeatures {
+    double contrast = 0.0;   // 灰度标准差
+    double ink_ratio = 0.0;  // Otsu 二值化后少数像素（墨迹）占比
+    int components = 0;      // 墨迹连通域数（忽略过小的噪点）
+    bool rule_line = false;  // 仅一个连通域且贯穿整框、厚度很薄（表格线 / 下划线）
+    double mask_fill = 1.0;  // 检测二值图在框内的填充率（无掩码时为 1）
+};
+
+// 在缩放到固定高度的灰度裁剪上计算特征；mask_roi 为检测二值图中该框的区域（可为空）
+CropFeatures ComputeCropFeatures(const cv::Mat& crop, const cv::Mat& mask_roi);
+
+// 识别前的裁剪预过滤（postprocess.crop_filter）：表格线、印章边、噪点与空白框不进识别。
+//   mode：off | enforce（直接丢弃）| shadow（只统计“会丢弃”，照常识别，用于评估误丢的真实文本行）
+// 阈值：min_contrast / min_ink_ratio / min_components / min_mask_fill，rule_line 可关闭
+class CropFilter {
+public:
+    enum class Mode { kOff, kEnforce, kShadow };
+
+    struct Decision {
+        bool drop = false;
+        std::string reason;  // low_contrast / low_ink / no_components / rule_line / sparse_mask
+        CropFeatures features;
+    };
+
+    explicit CropFilter(const json& config);
+
+    Mode GetMode() const { return mode_; }
+    bool Enabled() const { return mode_ != Mode::kOff; }
+    const char* ModeName() const;
+    static const std::vector<std::string>& Reasons();
+
+    // 计算特征并判定；按原因计数（enforce：ocr_crops_filtered_total，shadow：ocr_crops_prefilter_shadow_total）
+    Decision Evaluate(const cv::Mat& crop, const cv::Mat& mask_roi) const;
+    // shadow：判定会丢弃但识别出了文本（潜在误丢）
+    void RecordShadowMiss(const Decision& decision) const;
+
+private:
+    Mode mode_ = Mode::kOff;
+    double min_contrast_;
+    double min_ink_ratio_;
+    int min_components_;
+    double min_mask_fill_;
+    bool drop_rule_lines_;
+    Counter* shadow_misses_ = nullptr;
+};
+
+#endif // OCR_CROP_FILTER_H
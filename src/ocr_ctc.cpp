@@ -0,0 +1,376 @@
+#include "ocr_ctc.h"
+#include "ocr_lexicon.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <unordered_map>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define OCR_CTC_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define OCR_CTC_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define OCR_CTC_NEON 1
+#endif
+
+namespace {
+
+#if defined(OCR_CTC_AVX2) || defined(OCR_CTC_SSE2) || defined(OCR_CTC_NEON)
+// 合并各 lane 的候选：取最大值，并列取最小下标
+ArgmaxValue ReduceLanes(const float* values, const int32_t* indices, int lanes, ArgmaxValue best) {
+    for (int i = 0; i < lanes; ++i) {
+        if (values[i] > best.value || (values[i] == best.value && indices[i] < best.index)) {
+            best.value = values[i];
+            best.index = indices[i];
+        }
+    }
+    return best;
+}
+#endif
+
+// 尾部元素下标大于所有 lane，严格大于即可保持“并列取最小下标”
+ArgmaxValue ScalarTail(const float* data, int begin, int n, ArgmaxValue best) {
+    for (int i = begin; i < n; ++i) {
+        if (data[i] > best.value) {
+            best.value = data[i];
+            best.index = i;
+        }
+    }
+    return best;
+}
+
+}  // namespace
+
+ArgmaxValue ArgmaxWithValueScalar(const float* data, int n) {
+    ArgmaxValue best{0, -std::numeric_limits<float>::infinity()};
+    return ScalarTail(data, 0, n, best);
+}
+
+#if defined(OCR_CTC_AVX2)
+
+const char* ArgmaxBackend() { return "avx2"; }
+
+// 两组累加器交替处理 16 个元素，掩盖 compare → blend 的依赖延迟
+ArgmaxValue ArgmaxWithValue(const float* data, int n) {
+    ArgmaxValue best{0, -std::numeric_limits<float>::infinity()};
+    if (n < 16) return ScalarTail(data, 0, n, best);
+    __m256 best0 = _mm256_set1_ps(best.value), best1 = best0;
+    __m256i idx0 = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    __m256i idx1 = _mm256_add_epi32(idx0, _mm256_set1_epi32(8));
+    __m256i best_idx0 = idx0, best_idx1 = idx1;
+    const __m256i step = _mm256_set1_epi32(16);
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256 v0 = _mm256_loadu_ps(data + i);
+        __m256 v1 = _mm256_loadu_ps(data + i + 8);
+        __m256 gt0 = _mm256_cmp_ps(v0, best0, _CMP_GT_OQ);
+        __m256 gt1 = _mm256_cmp_ps(v1, best1, _CMP_GT_OQ);
+        best0 = _mm256_blendv_ps(best0, v0, gt0);
+        best1 = _mm256_blendv_ps(best1, v1, gt1);
+        best_idx0 = _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(best_idx0), _mm256_castsi256_ps(idx0), gt0));
+        best_idx1 = _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(best_idx1), _mm256_castsi256_ps(idx1), gt1));
+        idx0 = _mm256_add_epi32(idx0, step);
+        idx1 = _mm256_add_epi32(idx1, step);
+    }
+    alignas(32) float values[16];
+    alignas(32) int32_t indices[16];
+    _mm256_store_ps(values, best0);
+    _mm256_store_ps(values + 8, best1);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(indices), best_idx0);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(indices + 8), best_idx1);
+    return ScalarTail(data, i, n, ReduceLanes(values, indices, 16, best));
+}
+
+#elif defined(OCR_CTC_SSE2)
+
+const char* ArgmaxBackend() { return "sse2"; }
+
+// SSE2 无 blendv，用 and / andnot / or 选择
+static inline __m128 Select(__m128 mask, __m128 a, __m128 b) {
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+ArgmaxValue ArgmaxWithValue(const float* data, int n) {
+    ArgmaxValue best{0, -std::numeric_limits<float>::infinity()};
+    if (n < 8) return ScalarTail(data, 0, n, best);
+    __m128 best0 = _mm_set1_ps(best.value), best1 = best0;
+    __m128i idx0 = _mm_setr_epi32(0, 1, 2, 3);
+    __m128i idx1 = _mm_setr_epi32(4, 5, 6, 7);
+    __m128i best_idx0 = idx0, best_idx1 = idx1;
+    const __m128i step = _mm_set1_epi32(8);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128 v0 = _mm_loadu_ps(data + i);
+        __m128 v1 = _mm_loadu_ps(data + i + 4);
+        __m128 gt0 = _mm_cmpgt_ps(v0, best0);
+        __m128 gt1 = _mm_cmpgt_ps(v1, best1);
+        best0 = Select(gt0, v0, best0);
+        best1 = Select(gt1, v1, best1);
+        best_idx0 = _mm_castps_si128(Select(gt0, _mm_castsi128_ps(idx0), _mm_castsi128_ps(best_idx0)));
+        best_idx1 = _mm_castps_si128(Select(gt1, _mm_castsi128_ps(idx1), _mm_castsi128_ps(best_idx1)));
+        idx0 = _mm_add_epi32(idx0, step);
+        idx1 = _mm_add_epi32(idx1, step);
+    }
+    alignas(16) float values[8];
+    alignas(16) int32_t indices[8];
+    _mm_store_ps(values, best0);
+    _mm_store_ps(values + 4, best1);
+    _mm_store_si128(reinterpret_cast<__m128i*>(indices), best_idx0);
+    _mm_store_si128(reinterpret_cast<__m128i*>(indices + 4), best_idx1);
+    return ScalarTail(data, i, n, ReduceLanes(values, indices, 8, best));
+}
+
+#elif defined(OCR_CTC_NEON)
+
+const char* ArgmaxBackend() { return "neon"; }
+
+ArgmaxValue ArgmaxWithValue(const float* data, int n) {
+    ArgmaxValue best{0, -std::numeric_limits<float>::infinity()};
+    if (n < 8) return ScalarTail(data, 0, n, best);
+    float32x4_t best0 = vdupq_n_f32(best.value), best1 = best0;
+    const int32_t init[8] = {0, 1, 2, 3, 4, 5, 6, 7};
+    int32x4_t idx0 = vld1q_s32(init), idx1 = vld1q_s32(init + 4);
+    int32x4_t best_idx0 = idx0, best_idx1 = idx1;
+    const int32x4_t step = vdupq_n_s32(8);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        float32x4_t v0 = vld1q_f32(data + i);
+        float32x4_t v1 = vld1q_f32(data + i + 4);
+        uint32x4_t gt0 = vcgtq_f32(v0, best0);
+        uint32x4_t gt1 = vcgtq_f32(v1, best1);
+        best0 = vbslq_f32(gt0, v0, best0);
+        best1 = vbslq_f32(gt1, v1, best1);
+        best_idx0 = vbslq_s32(gt0, idx0, best_idx0);
+        best_idx1 = vbslq_s32(gt1, idx1, best_idx1);
+        idx0 = vaddq_s32(idx0, step);
+        idx1 = vaddq_s32(idx1, step);
+    }
+    float values[8];
+    int32_t indices[8];
+    vst1q_f32(values, best0);
+    vst1q_f32(values + 4, best1);
+    vst1q_s32(indices, best_idx0);
+    vst1q_s32(indices + 4, best_idx1);
+    return ScalarTail(data, i, n, ReduceLanes(values, indices, 8, best));
+}
+
+#else
+
+const char* ArgmaxBackend() { return "scalar"; }
+
+ArgmaxValue ArgmaxWithValue(const float* data, int n) {
+    return ArgmaxWithValueScalar(data, n);
+}
+
+#endif
+
+CharSpan TimestepsToCropSpan(int start, int end, int T, int input_width, int content_width, int crop_width) {
+    CharSpan span;
+    if (T <= 0 || content_width <= 0) return span;
+    float frame = static_cast<float>(input_width) / T;
+    float scale = static_cast<float>(crop_width) / content_width;
+    float limit = static_cast<float>(content_width);
+    span.x0 = std::min(start * frame, limit) * scale;
+    span.x1 = std::min((end + 1) * frame, limit) * scale;
+    return span;
+}
+
+CtcGreedyDecoder::CtcGreedyDecoder(std::shared_ptr<const CharDict> dict) : dict_(std::move(dict)) {
+    if (!dict_ || dict_->Size() == 0) throw std::invalid_argument("CTC 字典为空");
+}
+
+CtcGreedyDecoder::CtcGreedyDecoder(const std::vector<std::string>& dict)
+    : CtcGreedyDecoder(std::make_shared<const CharDict>(dict)) {}
+
+void CtcGreedyDecoder::Decode(const float* probs, int T, int C, CtcOutput& out) const {
+    // 输出不超过 T 个字符：一次性按最长字符预留，解码中只做 memcpy
+    out.text.resize(static_cast<size_t>(T) * dict_->MaxCharBytes());
+    out.char_scores.clear();
+    out.char_start.clear();
+    out.char_end.clear();
+    out.char_offset.clear();
+    char* dst = out.text.empty() ? nullptr : &out.text[0];
+    size_t written = 0;
+    const int dict_size = static_cast<int>(Size());
+
+    float score = 0.0f;
+    int prev = -1;
+    bool run_emitted = false;  // prev 对应的字符是否已输出（重复帧据此延长该字符的区间）
+    for (int t = 0; t < T; ++t) {
+        ArgmaxValue best = ArgmaxWithValue(probs + static_cast<size_t>(t) * C, C);
+        score += best.value / T;
+        int p = best.index;
+        if (p > dict_size) continue;  // 字典外类别丢弃，不打断重复
+        if (p == prev) {
+            if (run_emitted) {
+                out.char_end.back() = t;
+                out.char_scores.back() = std::max(out.char_scores.back(), best.value);
+            }
+            continue;
+        }
+        run_emitted = p > 0;
+        if (run_emitted) {
+            std::string_view ch = dict_->Char(p - 1);
+            out.char_offset.push_back(static_cast<uint32_t>(written));
+            std::memcpy(dst + written, ch.data(), ch.size());
+            written += ch.size();
+            out.char_scores.push_back(best.value);
+            out.char_start.push_back(t);
+            out.char_end.push_back(t);
+        }
+        prev = p;
+    }
+    out.text.resize(written);
+    out.score = score;
+    out.matched = true;
+}
+
+namespace {
+
+constexpr float kLogZero = -std::numeric_limits<float>::infinity();
+
+inline float LogAdd(float a, float b) {
+    if (a == kLogZero) return b;
+    if (b == kLogZero) return a;
+    float hi = std::max(a, b);
+    return hi + std::log1p(std::exp(-std::fabs(a - b)));
+}
+
+// 前缀树节点：前缀 = 父前缀 + label；同一前缀只有一个节点，不同路径在此合并
+struct PrefixNode {
+    int parent;
+    int label;  // CTC 类别（1..dict_size），根为 0
+    int state;  // 约束状态
+    int start, end;  // 该字符概率高于 blank 的帧区间；没有这样的帧时为创建帧
+    float score;
+    bool strong;     // 已出现概率高于 blank 的帧
+};
+
+struct Beam {
+    int node;
+    float blank;      // 以 blank 结尾的对数概率
+    float non_blank;  // 以 label 结尾的对数概率
+    float Total() const { return LogAdd(blank, non_blank); }
+};
+
+}  // namespace
+
+void CtcBeamDecoder::Decode(const float* probs, int T, int C, const BeamOptions& options,
+                            const DecodeConstraint* constraint, CtcOutput& out) const {
+    const int last_label = std::min(static_cast<int>(dict_->Size()), C - 1);
+    const int top_k = std::max(1, options.top_k);
+    const size_t beam_width = static_cast<size_t>(std::max(1, options.beam_width));
+
+    std::vector<PrefixNode> nodes{{-1, 0, constraint ? constraint->Start() : 0, 0, 0, 0.0f, true}};
+    std::unordered_map<uint64_t, int> child_of;  // (parent << 32 | label) → node
+    std::vector<Beam> beams{{0, 0.0f, kLogZero}}, next;
+    std::vector<int> slot;  // node → next 中的下标
+    std::vector<std::pair<float, int>> candidates;  // 概率降序
+    candidates.reserve(top_k + 1);
+
+    auto entry = [&](int node) {
+        if (static_cast<size_t>(node) >= slot.size()) slot.resize(node + 1, -1);
+        if (slot[node] < 0) {
+            slot[node] = static_cast<int>(next.size());
+            next.push_back({node, kLogZero, kLogZero});
+        }
+        return slot[node];
+    };
+    auto mark = [&](int node, int t, float p, float blank_p) {  // 字符在 t 帧高于 blank：更新区间与置信度
+        PrefixNode& n = nodes[node];
+        if (p <= blank_p) return;
+        if (!n.strong) {
+            n = {n.parent, n.label, n.state, t, t, p, true};
+            return;
+        }
+        n.end = std::max(n.end, t);
+        n.score = std::max(n.score, p);
+    };
+
+    for (int t = 0; t < T; ++t) {
+        const float* row = probs + static_cast<size_t>(t) * C;
+        float blank_p = row[0];
+        for (int c = last_label + 1; c < C; ++c) blank_p += row[c];
+        const float log_blank = std::log(std::max(blank_p, 1e-30f));
+
+        // top-k 候选：维持降序小数组，绝大多数元素只做一次比较
+        candidates.clear();
+        float floor = options.min_prob;
+        for (int c = 1; c <= last_label; ++c) {
+            float p = row[c];
+            if (p < floor) continue;
+            auto pos = std::upper_bound(candidates.begin(), candidates.end(), p,
+                                        [](float v, const std::pair<float, int>& e) { return v > e.first; });
+            candidates.insert(pos, {p, c});
+            if (static_cast<int>(candidates.size()) > top_k) candidates.pop_back();
+            if (static_cast<int>(candidates.size()) == top_k) floor = std::max(options.min_prob, candidates.back().first);
+        }
+
+        next.clear();
+        std::fill(slot.begin(), slot.end(), -1);
+        for (const Beam& beam : beams) {
+            const float total = beam.Total();
+            const int label = nodes[beam.node].label;
+            const int state = nodes[beam.node].state;
+            int i = entry(beam.node);
+            next[i].blank = LogAdd(next[i].blank, total + log_blank);
+            if (label > 0 && row[label] > 0.0f) {  // 重复字符（未经 blank）合并到同一前缀
+                next[i].non_blank = LogAdd(next[i].non_blank, beam.non_blank + std::log(row[label]));
+                mark(beam.node, t, row[label], blank_p);
+            }
+            for (const auto& [p, c] : candidates) {
+                const float from = (c == label) ? beam.blank : total;  // 同字符须隔 blank 才是新字符
+                if (from == kLogZero) continue;
+                int child_state = 0;
+                if (constraint) {
+                    child_state = constraint->Next(state, c - 1);
+                    if (child_state < 0) continue;
+                }
+                uint64_t key = static_cast<uint64_t>(beam.node) << 32 | static_cast<uint32_t>(c);
+                auto [it, inserted] = child_of.emplace(key, static_cast<int>(nodes.size()));
+                if (inserted) nodes.push_back({beam.node, c, child_state, t, t, p, false});
+                mark(it->second, t, p, blank_p);
+                i = entry(it->second);
+                next[i].non_blank = LogAdd(next[i].non_blank, from + std::log(p));
+            }
+        }
+
+        size_t keep = std::min(beam_width, next.size());
+        std::partial_sort(next.begin(), next.begin() + keep, next.end(),
+                          [](const Beam& a, const Beam& b) { return a.Total() > b.Total(); });
+        next.resize(keep);
+        beams.swap(next);
+    }
+
+    // beams 已按概率降序；有约束时取第一个完整匹配
+    const Beam* best = &beams.front();
+    out.matched = true;
+    if (constraint) {
+        auto it = std::find_if(beams.begin(), beams.end(),
+                               [&](const Beam& b) { return constraint->Accepts(nodes[b.node].state); });
+        if (it != beams.end()) best = &*it;
+        else out.matched = false;
+    }
+
+    std::vector<int> chain;
+    for (int node = best->node; node > 0; node = nodes[node].parent) chain.push_back(node);
+    out.text.clear();
+    out.char_scores.clear();
+    out.char_start.clear();
+    out.char_end.clear();
+    out.char_offset.clear();
+    for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
+        const PrefixNode& n = nodes[*it];
+        out.char_offset.push_back(static_cast<uint32_t>(out.text.size()));
+        out.text += dict_->Char(n.label - 1);
+        out.char_scores.push_back(n.score);
+        out.char_start.push_back(n.start);
+        out.char_end.push_back(n.end);
+    }
+    out.score = T > 0 ? std::exp(best->Total() / T) : 0.0f;
+}
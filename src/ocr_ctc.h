@@ -0,0 +1,88 @@
+#ifndef OCR_CTC_H
+#define OCR_CTC_H
+
+#include "ocr_char_dict.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class DecodeConstraint;
+
+// 一行概率的最大值及其下标（并列取最小下标，与逐元素 `p > max_p` 的标量循环一致）
+struct ArgmaxValue {
+    int index = 0;
+    float value = 0.0f;
+};
+
+// 向量化 argmax：AVX2（ENABLE_AVX2 编译）/ SSE2 / NEON，其它平台退回标量
+ArgmaxValue ArgmaxWithValue(const float* data, int n);
+// 标量参考实现（测试与基准对照）
+ArgmaxValue ArgmaxWithValueScalar(const float* data, int n);
+// 当前编译进来的 argmax 实现："avx2" / "sse2" / "neon" / "scalar"
+const char* ArgmaxBackend();
+
+// CTC 贪心解码结果；作为复用缓冲传入 Decode，多次解码不再分配内存
+struct CtcOutput {
+    std::string text;
+    float score = 0.0f;               // 各时间步最大概率的均值（含 blank 帧）
+    std::vector<float> char_scores;   // 每个输出字符的置信度：其连续帧中的最大概率
+    std::vector<int> char_start;      // 每个输出字符的首帧（时间步）
+    std::vector<int> char_end;        // 每个输出字符的末帧（含）
+    std::vector<uint32_t> char_offset;  // 每个输出字符在 text 中的起始字节
+    bool matched = true;              // 束搜索：最优结果满足约束（无约束恒为 true）
+};
+
+// 字符在裁剪图中的横向范围 [x0, x1)，像素
+struct CharSpan {
+    float x0 = 0.0f;
+    float x1 = 0.0f;
+};
+
+// CTC 时间步 → 裁剪图横坐标：T 帧均分网络输入宽度 input_width，其中 [0, content_width) 为缩放后的内容、
+// 其后为补边；再按 crop_width / content_width 映射回原始裁剪。帧区间 [start, end] 取整帧宽度，结果为近似位置
+CharSpan TimestepsToCropSpan(int start, int end, int T, int input_width, int content_width, int crop_width);
+
+// CTC 贪心解码：逐时间步 argmax → 去重 → 查字典，按字典条目整段拷贝到预分配的输出缓冲。
+// 类别约定：0 为 blank，i（1..dict.Size()）对应 dict.Char(i-1)；超出字典的类别（模型多出的空格类而
+// use_space_char = false 等）丢弃且不打断重复
+class CtcGreedyDecoder {
+public:
+    explicit CtcGreedyDecoder(std::shared_ptr<const CharDict> dict);
+    explicit CtcGreedyDecoder(const std::vector<std::string>& dict);
+
+    // probs：[T, C] 行主序概率
+    void Decode(const float* probs, int T, int C, CtcOutput& out) const;
+
+    size_t Size() const { return dict_->Size(); }
+    const CharDict& Dict() const { return *dict_; }
+
+private:
+    std::shared_ptr<const CharDict> dict_;
+};
+
+struct BeamOptions {
+    int beam_width = 8;     // 每个时间步保留的前缀数
+    int top_k = 10;         // 每个时间步只扩展概率最高的 top_k 个字符
+    float min_prob = 1e-3f; // 低于此概率的字符不扩展（blank 主导的帧几乎不产生候选）
+};
+
+// CTC 前缀束搜索（对数域），可选约束（词典 / 正则）：前缀只沿约束允许的字符扩展，结束时优先取满足约束的最优前缀。
+// 类别约定同贪心解码；字典外的类别并入 blank。
+// score 为最优前缀概率的几何平均（exp(log P / T)），与贪心的“逐帧最大概率均值”不同尺度。
+// 逐字符 char_start / char_end / char_scores 取自该字符首次出现的帧及其后由该字符主导的重复帧（近似）
+class CtcBeamDecoder {
+public:
+    explicit CtcBeamDecoder(std::shared_ptr<const CharDict> dict) : dict_(std::move(dict)) {}
+
+    // constraint 为空时不约束；束中没有完整满足约束的前缀时 out.matched = false（输出最优的部分前缀，调用方可退回贪心结果）
+    void Decode(const float* probs, int T, int C, const BeamOptions& options, const DecodeConstraint* constraint,
+                CtcOutput& out) const;
+
+private:
+    std::shared_ptr<const CharDict> dict_;
+};
+
+#endif // OCR_CTC_H
@@ -1,4 +1,5 @@
 #include "ocr_detect.h"
+#include "ocr_metrics.h"
 #include <spdlog/spdlog.h>
 #include <opencv2/opencv.hpp>
 #include <opencv2/imgproc.hpp>
@@ -7,7 +8,8 @@
 #include <memory>
 #include <algorithm>
 
-OCRDetect::OCRDetect(const json& det_config) : det_config_(det_config) {
+OCRDetect::OCRDetect(const json& det_config)
+    : env_(ModelLoader::Instance().Env(det_config.value("loading", json::object()))), det_config_(det_config) {
     std::string path = det_config.at("path").get<std::string>();
     if (!std::filesystem::exists(path)) {
         throw std::runtime_error("检测模型路径不存在: " + path);
@@ -22,18 +24,23 @@ OCRDetect::OCRDetect(const json& det_config) : det_config_(det_config) {
     is_bgr_ = det_config.value("is_bgr", true);
     min_size_ = det_config.value("min_size", 32);
     max_size_ = det_config.value("max_size", 1536);
+    det_batch_num_ = det_config.value("det_batch_num", 2);
 
     // 输入/输出名和形状
-    input_names_ = det_config.at("input_names").get<std::vector<std::string>>();
-    output_names_ = det_config.at("output_names").get<std::vector<std::string>>();
+    input_name_strs_ = det_config.at("input_names").get<std::vector<std::string>>();
+    output_name_strs_ = det_config.at("output_names").get<std::vector<std::string>>();
+    for (const auto& name : input_name_strs_) input_names_.push_back(name.c_str());
+    for (const auto& name : output_name_strs_) output_names_.push_back(name.c_str());
     input_shape_ = det_config.at("input_shape").get<std::vector<int64_t>>();
 
     // 初始化 ONNX
-    env_ = Ort::Env(ORT_LOGGING_LEVEL_WARNING, "Detect");
-    session_options_.SetIntraOpNumThreads(4);  // 从 service thread_pool_size 动态（假设固定）
+    // 线程数由 ModelLoader 统一设置（共享线程池或每 session intra_op_threads）
     session_options_.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_ENABLE_EXTENDED);
     session_options_.DisableCpuMemArena();
-    session_ = Ort::Session(env_, path.c_str(), session_options_);
+    auto loaded = ModelLoader::Instance().Load(env_, path, session_options_, det_config.value("loading", json::object()));
+    session_ = std::move(loaded.session);
+    model_mapping_ = std::move(loaded.mapping);
+    load_info_ = std::move(loaded.info);
 
     // 阈值从 postprocess 层
     json postprocess = det_config.value("postprocess", json::object());  // 若无，空
@@ -45,21 +52,42 @@ OCRDetect::OCRDetect(const json& det_config) : det_config_(det_config) {
 
 OCRDetect::~OCRDetect() = default;
 
-cv::Mat OCRDetect::Preprocess(const cv::Mat& img) {
+void OCRDetect::StartProfiling(int runs, const std::string& output_dir) {
+    profiler_.Arm(env_, session_options_, det_config_.at("path").get<std::string>(), runs, output_dir);
+}
+
+void OCRDetect::Warmup(const std::vector<int64_t>& shape) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t input_size = 1;
+    for (int64_t dim : shape) input_size *= static_cast<size_t>(dim);
+    std::vector<float> input_data(input_size, 0.0f);
+    Ort::MemoryInfo memory_info = Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
+    std::vector<Ort::Value> input_tensors;
+    input_tensors.push_back(Ort::Value::CreateTensor<float>(memory_info, input_data.data(), input_size,
+                                                            shape.data(), shape.size()));
+    session_.Run(Ort::RunOptions{nullptr}, input_names_.data(), input_tensors.data(), input_names_.size(),
+                 output_names_.data(), output_names_.size());
+}
+
+cv::Mat OCRDetect::Preprocess(const cv::Mat& img, bool native_scale, double& scale) {
     if (img.empty()) throw std::invalid_argument("输入图像为空");
 
-    // 动态 resize（短边 min_size，长边 max_size）
-    double scale = std::max(static_cast<double>(min_size_) / std::min(img.rows, img.cols),
-                            static_cast<double>(max_size_) / std::max(img.rows, img.cols));
-    cv::Size new_size(static_cast<int>(img.cols * scale), static_cast<int>(img.rows * scale));
+    // 动态 resize（短边 min_size，长边 max_size）；native_scale 只缩小
+    scale = native_scale ? std::min(1.0, static_cast<double>(max_size_) / std::max(img.rows, img.cols))
+                         : std::max(static_cast<double>(min_size_) / std::min(img.rows, img.cols),
+                                    static_cast<double>(max_size_) / std::max(img.rows, img.cols));
+    cv::Size new_size(std::max(1, static_cast<int>(img.cols * scale)), std::max(1, static_cast<int>(img.rows * scale)));
     new_size.width = std::min(new_size.width, max_size_);
     new_size.height = std::min(new_size.height, max_size_);
     cv::Mat resized;
     cv::resize(img, resized, new_size, 0, 0, cv::INTER_LINEAR);
+    scale = static_cast<double>(resized.cols) / img.cols;
 
-    // Pad to square-ish (for det)
-    int pad_h = std::max(0, max_size_ - resized.rows);
-    int pad_w = std::max(0, max_size_ - resized.cols);
+    // Pad to square-ish (for det)；native_scale 补到 32 的倍数（DB 下采样要求）
+    int target_h = native_scale ? (resized.rows + 31) / 32 * 32 : max_size_;
+    int target_w = native_scale ? (resized.cols + 31) / 32 * 32 : max_size_;
+    int pad_h = std::max(0, target_h - resized.rows);
+    int pad_w = std::max(0, target_w - resized.cols);
     cv::copyMakeBorder(resized, resized, 0, pad_h, 0, pad_w, cv::BORDER_CONSTANT, cv::Scalar(0));
 
     // Normalize
@@ -79,43 +107,90 @@ cv::Mat OCRDetect::Preprocess(const cv::Mat& img) {
     return chw;
 }
 
-std::vector<std::vector<float>> OCRDetect::Detect(const cv::Mat& img) {
+std::vector<std::vector<float>> OCRDetect::Detect(const cv::Mat& img, const Ort::RunOptions* run_options,
+                                                  DetectionMask* mask, bool native_scale) {
     std::lock_guard<std::mutex> lock(mutex_);
-    cv::Mat input = Preprocess(img);
-    std::vector<int64_t> dynamic_shape = input_shape_;  // [1,3,H,W] dynamic H/W
-    dynamic_shape[2] = input.size[2];  // H
-    dynamic_shape[3] = input.size[3];  // W
-    size_t input_size = input.total();
+    std::vector<Detection> results(1);
+    RunBatch({img}, 0, 1, run_options, native_scale, mask, results);
+    return std::move(results.front().boxes);
+}
 
-    std::vector<float> input_data(input_size);
-    memcpy(input_data.data(), input.ptr<float>(0), input_size * sizeof(float));
+std::vector<Detection> OCRDetect::DetectBatch(const std::vector<cv::Mat>& images, const Ort::RunOptions* run_options) {
+    std::vector<Detection> results(images.size());
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t batch_limit = static_cast<size_t>(std::max(1, det_batch_num_));
+    for (size_t begin = 0; begin < images.size(); begin += batch_limit) {
+        RunBatch(images, begin, std::min(batch_limit, images.size() - begin), run_options, false, nullptr, results);
+    }
+    return results;
+}
+
+void OCRDetect::RunBatch(const std::vector<cv::Mat>& images, size_t begin, size_t n, const Ort::RunOptions* run_options,
+                         bool native_scale, DetectionMask* mask, std::vector<Detection>& results) {
+    ScopedSpan span("det");
+    if (span.Active()) {
+        const cv::Mat& first = images[begin];
+        span.SetAttribute("image", std::to_string(first.cols) + "x" + std::to_string(first.rows));
+        if (n > 1) span.SetAttribute("batch", n);
+    }
+    std::vector<double> ratios(n, 1.0);  // 原图 → 检测输入
+    std::vector<float> input_data;
+    std::vector<int64_t> dynamic_shape = input_shape_;  // [n,3,H,W] dynamic H/W
+    {
+        ScopedStageTimer timer(Stage::kDetPreprocess);
+        for (size_t k = 0; k < n; ++k) {
+            cv::Mat input = Preprocess(images[begin + k], native_scale, ratios[k]);
+            if (k == 0) {
+                dynamic_shape[0] = static_cast<int64_t>(n);
+                dynamic_shape[2] = input.size[2];  // H
+                dynamic_shape[3] = input.size[3];  // W
+                input_data.resize(input.total() * n);
+            }
+            memcpy(input_data.data() + k * input.total(), input.ptr<float>(0), input.total() * sizeof(float));
+        }
+    }
 
     Ort::MemoryInfo memory_info = Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
-    auto input_tensor = Ort::Value::CreateTensor<float>(memory_info, input_data.data(), input_size,
+    auto input_tensor = Ort::Value::CreateTensor<float>(memory_info, input_data.data(), input_data.size(),
                                                        dynamic_shape.data(), dynamic_shape.size());
 
-    std::vector<Ort::Value> input_tensors{std::move(input_tensor)};
+    std::vector<Ort::Value> input_tensors;  // Ort::Value 仅可移动，不能用初始化列表
+    input_tensors.push_back(std::move(input_tensor));
     std::vector<Ort::Value> output_tensors;
+    Ort::RunOptions default_options{nullptr};
+    const Ort::RunOptions& options = run_options ? *run_options : default_options;
     try {
-        session_.Run(Ort::RunOptions{nullptr}, input_names_.data(), input_tensors.data(), input_names_.size(),
-                     output_names_.data(), output_names_.size(), &output_tensors);
+        ScopedStageTimer timer(Stage::kDetInference);
+        ScopedProfiledSession session(profiler_, session_);
+        session.Get().Run(options, input_names_.data(), input_tensors.data(), input_names_.size(),
+                          output_names_.data(), output_names_.size(), &output_tensors);
     } catch (const Ort::Exception& e) {
         spdlog::error("检测推理失败: {}", e.what());
-        return {};
+        return;
+    }
+    if (output_tensors.empty()) return;
+
+    ScopedStageTimer timer(Stage::kDetPostprocess);
+    auto shape = output_tensors[0].GetTensorTypeAndShapeInfo().GetShape();
+    int out_h = static_cast<int>(shape[2]), out_w = static_cast<int>(shape[3]);
+    const float* prob_map = output_tensors[0].GetTensorData<float>();
+    for (size_t k = 0; k < n; ++k) {
+        results[begin + k] = Postprocess(prob_map + k * static_cast<size_t>(out_h) * out_w, out_h, out_w, ratios[k],
+                                         k == 0 ? mask : nullptr);
     }
-
-    double ratio = static_cast<double>(input.size[3]) / img.cols;  // W ratio
-    return Postprocess(output_tensors, img.cols, img.rows, ratio);
 }
 
-std::vector<std::vector<float>> OCRDetect::Postprocess(const std::vector<Ort::Value>& outputs, int orig_w, int orig_h, double ratio) {
-    if (outputs.empty()) return {};
-
-    auto& output = outputs[0];
-    float* prob_map = output.GetTensorMutableData<float>();
-    auto shape = output.GetTensorTypeAndShapeInfo().GetShape();
-    int out_h = shape[2], out_w = shape[3];
+std::array<cv::Point2f, 4> OrderQuad(const cv::RotatedRect& rect, float scale) {
+    cv::Point2f pts[4];
+    rect.points(pts);
+    // 按 x 分出左右两对，每对内按 y 分上下（同 PaddleOCR get_mini_boxes）
+    std::sort(pts, pts + 4, [](const cv::Point2f& a, const cv::Point2f& b) { return a.x < b.x; });
+    if (pts[0].y > pts[1].y) std::swap(pts[0], pts[1]);
+    if (pts[2].y > pts[3].y) std::swap(pts[2], pts[3]);
+    return {pts[0] * scale, pts[2] * scale, pts[3] * scale, pts[1] * scale};
+}
 
+Detection OCRDetect::Postprocess(const float* prob_map, int out_h, int out_w, double ratio, DetectionMask* mask) {
     // Binary map (DB thresh)
     cv::Mat binary(out_h, out_w, CV_8UC1);
     for (int i = 0; i < out_h * out_w; ++i) {
@@ -125,6 +200,10 @@ std::vector<std::vector<float>> OCRDetect::Postprocess(const std::vector<Ort::Va
     // Morphology close
     cv::Mat kernel = cv::getStructuringElement(cv::MORPH_RECT, cv::Size(2, 2));
     cv::morphologyEx(binary, binary, cv::MORPH_CLOSE, kernel);
+    if (mask) {
+        mask->binary = binary.clone();  // findContours 可能修改输入
+        mask->ratio = ratio;
+    }
 
     // Contours
     std::vector<std::vector<cv::Point>> contours;
@@ -143,7 +222,7 @@ std::vector<std::vector<float>> OCRDetect::Postprocess(const std::vector<Ort::Va
     std::vector<int> indices;
     cv::dnn::NMSBoxesRotated(boxes, scores, det_threshold_, nms_threshold_, indices);
 
-    std::vector<std::vector<float>> bboxes;
+    Detection detection;
     for (int idx : indices) {
         cv::RotatedRect& rect = boxes[idx];
         cv::Point2f pts[4];
@@ -153,9 +232,11 @@ std::vector<std::vector<float>> OCRDetect::Postprocess(const std::vector<Ort::Va
         float y1 = std::min({pts[0].y, pts[1].y, pts[2].y, pts[3].y}) / ratio;
         float x2 = std::max({pts[0].x, pts[1].x, pts[2].x, pts[3].x}) / ratio;
         float y2 = std::max({pts[0].y, pts[1].y, pts[2].y, pts[3].y}) / ratio;
-        bboxes.emplace_back(std::vector<float>{x1, y1, x2, y2, scores[idx]});
+        detection.boxes.emplace_back(std::vector<float>{x1, y1, x2, y2, scores[idx]});
+
+        detection.quads.push_back(OrderQuad(rect, static_cast<float>(1.0 / ratio)));
     }
 
-    spdlog::debug("检测到 {} 个文本框 (阈值: {:.2f})", bboxes.size(), det_threshold_);
-    return bboxes;
+    spdlog::debug("检测到 {} 个文本框 (阈值: {:.2f})", detection.boxes.size(), det_threshold_);
+    return detection;
 }
\ No newline at end of file
@@ -1,39 +1,86 @@
 #ifndef OCR_DETECT_H
 #define OCR_DETECT_H
 
+#include "ocr_profiler.h"
+#include "ocr_model_loader.h"
 #include <opencv2/opencv.hpp>
 #include <onnxruntime_cxx_api.h>
 #include <json.hpp>
+#include <algorithm>
+#include <array>
 #include <vector>
 #include <string>
 #include <mutex>
 
 using json = nlohmann::json;
 
+// 检测二值图（DB 阈值 + 闭运算，检测输入分辨率）；原图坐标 × ratio 即二值图坐标
+struct DetectionMask {
+    cv::Mat binary;
+    double ratio = 1.0;
+};
+
+// 单图检测结果
+struct Detection {
+    std::vector<std::vector<float>> boxes;          // [x1,y1,x2,y2,score]
+    std::vector<std::array<cv::Point2f, 4>> quads;  // 与 boxes 对应的最小外接旋转矩形（原图坐标，左上起顺时针）
+};
+
+// 最小外接旋转矩形的四点排为 左上、右上、右下、左下，坐标乘以 scale（二值图坐标 → 原图坐标）
+std::array<cv::Point2f, 4> OrderQuad(const cv::RotatedRect& rect, float scale = 1.0f);
+
 class OCRDetect {
 public:
     OCRDetect(const json& det_config);  // 从分层 JSON 初始化
     ~OCRDetect();
-    std::vector<std::vector<float>> Detect(const cv::Mat& img);  // 返回 bboxes [x1,y1,x2,y2,score]
+    // 返回 bboxes [x1,y1,x2,y2,score]；run_options 可被外部 SetTerminate 中断；
+    // mask 非空时同时返回二值图（供识别前的裁剪预过滤复用，不再重复二值化）；
+    // native_scale：局部区域按原尺度检测（只缩小不放大，补边到 32 的倍数），耗时随区域面积而非 max_size
+    std::vector<std::vector<float>> Detect(const cv::Mat& img, const Ort::RunOptions* run_options = nullptr,
+                                           DetectionMask* mask = nullptr, bool native_scale = false);
+    // 批量检测（/det）：预处理统一补边到 max_size × max_size，形状一致，每 det_batch_num 张拼成一次 Run [n,3,H,W]。
+    // 结果与 images 一一对应；推理失败的批次结果为空
+    std::vector<Detection> DetectBatch(const std::vector<cv::Mat>& images, const Ort::RunOptions* run_options = nullptr);
+
+    // 算子级剖析：接下来 runs 次 Run 使用开启 profiling 的影子 session（runs = 0 取消）
+    void StartProfiling(int runs, const std::string& output_dir);
+    json ProfileStatus() const { return profiler_.Status(); }
+    bool ProfilingActive() const { return profiler_.Active(); }
+    const json& LoadInfo() const { return load_info_; }  // mmap / 预打包共享 / RSS 增量
+
+    // 预处理统一补边到 max_size × max_size：/ocr 的输入形状为 [1,3,H,W]，/det 拼批为 [batch,3,H,W]
+    std::vector<int64_t> CanonicalInputShape(int batch = 1) const { return {batch, 3, max_size_, max_size_}; }
+    int BatchNum() const { return std::max(1, det_batch_num_); }  // DetectBatch 单次 Run 的批大小上限
+    // 预热：以全零输入按给定形状 [n,3,H,W] 运行 session（不经预处理 / 后处理，不计入阶段指标）
+    void Warmup(const std::vector<int64_t>& shape);
 
 private:
-    Ort::Env env_;
+    Ort::Env& env_;  // 进程级共享（ModelLoader）
+    std::shared_ptr<const MappedModel> model_mapping_;  // 须先于 session_ 声明（后析构）
     Ort::Session session_{nullptr};
     Ort::SessionOptions session_options_;
-    std::vector<const char*> input_names_;
+    std::vector<std::string> input_name_strs_, output_name_strs_;  // 名称存储
+    std::vector<const char*> input_names_;   // 指向 *_name_strs_，供 Session::Run
     std::vector<const char*> output_names_;
     std::vector<int64_t> input_shape_;
 
     json det_config_;  // 存储子 config
+    json load_info_;
     std::vector<float> mean_, std_;
     bool is_bgr_;
     int min_size_, max_size_;
+    int det_batch_num_;
     float det_threshold_;  // 从 postprocess 层
     float nms_threshold_;  // 从 postprocess 层
 
-    cv::Mat Preprocess(const cv::Mat& img);  // 动态预处理
-    std::vector<std::vector<float>> Postprocess(const std::vector<Ort::Value>& outputs, int orig_w, int orig_h, double ratio);
+    cv::Mat Preprocess(const cv::Mat& img, bool native_scale, double& scale);  // 动态预处理；scale 为缩放比
+    // images[begin, begin + n) 拼成一次 Run；native_scale 时 n 须为 1（各图形状不同）；mask 对应首张
+    void RunBatch(const std::vector<cv::Mat>& images, size_t begin, size_t n, const Ort::RunOptions* run_options,
+                  bool native_scale, DetectionMask* mask, std::vector<Detection>& results);
+    // prob_map 为单图输出 [H, W]
+    Detection Postprocess(const float* prob_map, int out_h, int out_w, double ratio, DetectionMask* mask);
     std::mutex mutex_;  // 线程安全
+    OrtProfiler profiler_{"det"};
 };
 
 #endif // OCR_DETECT_H
\ No newline at end of file
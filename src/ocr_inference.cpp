@@ -1,25 +1,215 @@
 #include "ocr_inference.h"
+#include "ocr_metrics.h"
+#include "ocr_quant.h"
 #include <spdlog/spdlog.h>
 #include <json.hpp>
 #include <opencv2/opencv.hpp>
 #include <filesystem>
 #include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace {
+
+constexpr size_t kMaxRois = 256;
+constexpr float kMaxRoiCoord = 65536.0f;  // 坐标绝对值上限（远大于可解码的图像）
+
+std::vector<float> QuadBounds(const std::vector<cv::Point2f>& quad, const cv::Mat& img) {
+    float x1 = quad[0].x, y1 = quad[0].y, x2 = quad[0].x, y2 = quad[0].y;
+    for (const auto& p : quad) {
+        x1 = std::min(x1, p.x);
+        y1 = std::min(y1, p.y);
+        x2 = std::max(x2, p.x);
+        y2 = std::max(y2, p.y);
+    }
+    auto clamp = [](float v, int hi) { return std::clamp(v, 0.0f, static_cast<float>(hi)); };
+    return {clamp(x1, img.cols), clamp(y1, img.rows), clamp(x2, img.cols), clamp(y2, img.rows)};
+}
+
+}  // namespace
+
+RoiCrop CropRoi(const cv::Mat& img, const RegionOfInterest& roi) {
+    RoiCrop crop;
+    const auto& q = roi.quad;
+    if (q.size() != 4 || img.empty()) return crop;
+    for (const auto& p : q) {
+        if (!std::isfinite(p.x) || !std::isfinite(p.y)) return crop;
+    }
+    // 坐标先夹到图像外 1 像素内再取整（超大浮点转 int 未定义）
+    auto clamp_x = [&](float v) { return std::clamp(v, -1.0f, static_cast<float>(img.cols) + 1.0f); };
+    auto clamp_y = [&](float v) { return std::clamp(v, -1.0f, static_cast<float>(img.rows) + 1.0f); };
+    if (roi.axis_aligned) {
+        cv::Point p1(static_cast<int>(std::floor(clamp_x(q[0].x))), static_cast<int>(std::floor(clamp_y(q[0].y))));
+        cv::Point p2(static_cast<int>(std::ceil(clamp_x(q[2].x))), static_cast<int>(std::ceil(clamp_y(q[2].y))));
+        cv::Rect rect = cv::Rect(p1, p2) & cv::Rect(0, 0, img.cols, img.rows);
+        if (rect.area() <= 0) return crop;
+        crop.image = img(rect);
+        cv::Point2f tl(static_cast<float>(rect.x), static_cast<float>(rect.y));
+        cv::Point2f size(static_cast<float>(rect.width), static_cast<float>(rect.height));
+        crop.edge_a0 = tl;
+        crop.edge_a1 = {tl.x + size.x, tl.y};
+        crop.edge_b0 = {tl.x, tl.y + size.y};
+        crop.edge_b1 = tl + size;
+        return crop;
+    }
+    std::vector<float> bounds = QuadBounds(q, img);  // 外接框与图像不相交：空裁剪
+    if (bounds[2] <= bounds[0] || bounds[3] <= bounds[1]) return crop;
+    // 同 PaddleOCR get_rotate_crop_image：宽取上下边较长者、高取左右边较长者，竖排（高 ≥ 1.5 宽）逆时针转 90°
+    double edge_w = std::max(cv::norm(q[1] - q[0]), cv::norm(q[2] - q[3]));
+    double edge_h = std::max(cv::norm(q[3] - q[0]), cv::norm(q[2] - q[1]));
+    // 输出尺寸不超过图像对角线（图像内的任何四边形边长都不会更长），超出时等比缩小，防止超大四边形撑爆内存
+    double limit = std::ceil(std::hypot(static_cast<double>(img.cols), static_cast<double>(img.rows)));
+    double scale = std::min({1.0, limit / std::max(edge_w, 1.0), limit / std::max(edge_h, 1.0)});
+    int width = static_cast<int>(edge_w * scale);
+    int height = static_cast<int>(edge_h * scale);
+    if (width < 1 || height < 1) return crop;
+    cv::Point2f dst[4] = {{0.0f, 0.0f}, {static_cast<float>(width), 0.0f},
+                          {static_cast<float>(width), static_cast<float>(height)}, {0.0f, static_cast<float>(height)}};
+    cv::Mat transform = cv::getPerspectiveTransform(q.data(), dst);
+    cv::warpPerspective(img, crop.image, transform, cv::Size(width, height), cv::INTER_CUBIC, cv::BORDER_REPLICATE);
+    if (height >= 1.5 * width) {
+        cv::rotate(crop.image, crop.image, cv::ROTATE_90_COUNTERCLOCKWISE);
+        crop.edge_a0 = q[1];  // 转后的上边为原右边，自上而下
+        crop.edge_a1 = q[2];
+        crop.edge_b0 = q[0];
+        crop.edge_b1 = q[3];
+    } else {
+        crop.edge_a0 = q[0];
+        crop.edge_a1 = q[1];
+        crop.edge_b0 = q[3];
+        crop.edge_b1 = q[2];
+    }
+    return crop;
+}
+
+std::vector<RegionOfInterest> ParseRois(const json& rois) {
+    if (!rois.is_array()) throw std::invalid_argument("rois 须为数组");
+    if (rois.size() > kMaxRois) throw std::invalid_argument("rois 最多 " + std::to_string(kMaxRois) + " 个");
+    std::vector<RegionOfInterest> parsed;
+    parsed.reserve(rois.size());
+    for (const auto& item : rois) {
+        if (!item.is_object()) throw std::invalid_argument("roi 须为对象");
+        RegionOfInterest roi;
+        try {
+            if (item.contains("box")) {
+                auto b = item["box"].get<std::vector<float>>();
+                if (b.size() != 4 || b[2] <= b[0] || b[3] <= b[1]) {
+                    throw std::invalid_argument("roi.box 须为 [x1,y1,x2,y2] 且 x2 > x1、y2 > y1");
+                }
+                roi.quad = {{b[0], b[1]}, {b[2], b[1]}, {b[2], b[3]}, {b[0], b[3]}};
+            } else if (item.contains("quad")) {
+                auto points = item["quad"].get<std::vector<std::vector<float>>>();
+                if (points.size() != 4) throw std::invalid_argument("roi.quad 须为 4 个点");
+                for (const auto& p : points) {
+                    if (p.size() != 2) throw std::invalid_argument("roi.quad 的点须为 [x, y]");
+                    roi.quad.emplace_back(p[0], p[1]);
+                }
+                if (cv::contourArea(roi.quad) < 1.0) throw std::invalid_argument("roi.quad 面积为 0");
+                roi.axis_aligned = false;
+            } else {
+                throw std::invalid_argument("roi 需要 box 或 quad");
+            }
+            roi.name = item.value("name", "");
+        } catch (const json::exception& e) {
+            throw std::invalid_argument("rois 字段类型错误: " + std::string(e.what()));
+        }
+        for (const auto& p : roi.quad) {
+            if (!std::isfinite(p.x) || !std::isfinite(p.y) || std::abs(p.x) > kMaxRoiCoord || std::abs(p.y) > kMaxRoiCoord) {
+                throw std::invalid_argument("roi 坐标须为有限值且绝对值不超过 " + std::to_string(static_cast<int>(kMaxRoiCoord)));
+            }
+        }
+        if (item.contains("decode")) roi.decode = item["decode"];
+        parsed.push_back(std::move(roi));
+    }
+    return parsed;
+}
 
 OCRInference::OCRInference(const json& service_config) : service_config_(service_config) {
     try {
         auto model_layer = service_config.at("model");
+        std::string precision = model_layer.value("precision", "fp32");
+        bool require_approval = model_layer.value("require_int8_approval", true);
+
+        // 精度变体：precision = int8 时加载 int8_path（须经 ocr_quant_eval 批准），否则 path
+        auto select_variant = [&](json& config, const std::string& tag) {
+            ModelVariant variant = SelectModelVariant(config, precision, require_approval, tag);
+            config["path"] = variant.path;
+            model_variants_[tag] = {{"path", variant.path}, {"precision", variant.precision}};
+            if (!variant.note.empty()) model_variants_[tag]["fallback"] = variant.note;
+        };
 
         // Det 子层加载
+        json loading = model_layer.value("loading", json::object());  // mmap / 预打包权重共享
+
         auto det_config = model_layer.at("det_model");
-        detector_ = std::make_unique<OCRDetect>(det_config);
+        select_variant(det_config, "det");
+        det_config["loading"] = loading;
 
         // Rec 子层加载（合并 character_dict）
         auto rec_config = model_layer.at("rec_model");
+        select_variant(rec_config, "rec");
         auto dict_config = model_layer.at("character_dict");
         rec_config["character_dict"] = dict_config;  // 注入 dict 到 rec
         auto postprocess_config = model_layer.at("postprocess");
         rec_config["postprocess"] = postprocess_config;  // 注入 postprocess
-        recognizer_ = std::make_unique<OCRRecognize>(rec_config);
+        crop_filter_ = std::make_unique<CropFilter>(postprocess_config.value("crop_filter", json::object()));
+        rec_config["loading"] = loading;
+
+        // 多语言注册表：默认语言常驻，其余语言首次请求时加载，非常驻 session 按 LRU 保留至多 max_resident_languages 个。
+        // 语言条目的 rec_model 覆盖默认 rec_model 的字段（path / int8_path / 预处理）并自带 character_dict；
+        // 可选 det_model 覆盖默认检测模型，否则共享默认 det
+        default_lang_ = model_layer.value("default_lang", "ch");
+        size_t max_resident = model_layer.value("max_resident_languages", 2);
+        auto make_variant = [precision, require_approval](json config, const std::string& tag) {
+            ModelVariant variant = SelectModelVariant(config, precision, require_approval, tag);
+            config["path"] = variant.path;
+            return config;
+        };
+        detectors_ = std::make_unique<ModelRegistry<OCRDetect>>("检测模型", [](const json& config) {
+            return std::make_shared<OCRDetect>(config);
+        }, max_resident);
+        recognizers_ = std::make_unique<ModelRegistry<OCRRecognize>>("识别语言", [](const json& config) {
+            return std::make_shared<OCRRecognize>(config);
+        }, max_resident);
+
+        detectors_->Register(default_lang_, det_config, true);
+        recognizers_->Register(default_lang_, rec_config, true);
+        det_for_lang_[default_lang_] = default_lang_;
+        json base_det = model_layer.at("det_model");
+        json base_rec = model_layer.at("rec_model");
+        for (const char* key : {"int8_path", "precision"}) {  // 不沿用默认语言的量化变体
+            base_det.erase(key);
+            base_rec.erase(key);
+        }
+        for (const auto& [lang, lang_config] : model_layer.value("languages", json::object()).items()) {
+            if (lang == default_lang_) throw std::invalid_argument("languages 不能包含默认语言: " + lang);
+            json lang_rec = base_rec;
+            lang_rec.merge_patch(lang_config.at("rec_model"));
+            lang_rec = make_variant(lang_rec, "rec:" + lang);
+            lang_rec["character_dict"] = lang_config.at("character_dict");
+            lang_rec["postprocess"] = postprocess_config;
+            lang_rec["loading"] = loading;
+            recognizers_->Register(lang, lang_rec);
+            det_for_lang_[lang] = default_lang_;
+            if (lang_config.contains("det_model")) {
+                json lang_det = base_det;
+                lang_det.merge_patch(lang_config.at("det_model"));
+                lang_det = make_variant(lang_det, "det:" + lang);
+                lang_det["loading"] = loading;
+                detectors_->Register(lang, lang_det);
+                det_for_lang_[lang] = lang;
+            }
+        }
+
+        // 阶段 worker（service.role det / rec）只加载本阶段的模型，另一阶段在其他进程
+        std::string role = service_config.value("service", json::object()).value("role", "all");
+        bool load_det = role != "rec", load_rec = role != "det";
+        if (load_det) detector_ = detectors_->Get(default_lang_);
+        if (load_rec) recognizer_ = recognizers_->Get(default_lang_);
+        for (const auto& lang : model_layer.value("preload_languages", std::vector<std::string>{})) {
+            if (load_rec) recognizers_->Get(lang);
+            if (load_det) detectors_->Get(det_for_lang_.at(lang));
+        }
 
         // Cls 子层（可选）
         auto cls_config = model_layer.at("cls_model");
@@ -31,22 +221,47 @@ OCRInference::OCRInference(const json& service_config) : service_config_(service
             spdlog::info("方向分类模块禁用");
         }
 
-        spdlog::info("OCR 推理管道初始化完成 (det: {}, rec: {}, dict: {})",
-                     det_config.at("path"), rec_config.at("path"), dict_config.at("path"));
+        spdlog::info("OCR 推理管道初始化完成 (det: {} [{}], rec: {} [{}], dict: {}, 语言: {} + {} 个按需加载)",
+                     det_config.at("path"), model_variants_["det"]["precision"], rec_config.at("path"),
+                     model_variants_["rec"]["precision"], dict_config.at("path"), default_lang_,
+                     det_for_lang_.size() - 1);
     } catch (const std::exception& e) {
         spdlog::error("OCR 管道初始化失败: {}", e.what());
         throw;
     }
 }
 
-json OCRInference::Infer(const cv::Mat& img) {
-    std::lock_guard<std::mutex> lock(mutex_);  // 线程安全
+json OCRInference::Infer(const cv::Mat& img, RequestContext* ctx, const InferOptions& options) {
+    // 锁外取模型：未知语言直接抛出；首次使用的语言在注册表中加载，不占推理锁
+    const std::string& language = options.lang.empty() ? default_lang_ : options.lang;
+    std::shared_ptr<OCRRecognize> recognizer = recognizers_->Get(language);
+    std::shared_ptr<OCRDetect> detector = detectors_->Get(det_for_lang_.at(language));
+    // 解码配置按所选语言的字典解析（内联词典 / 正则在锁外编译）
+    DecodeSpec decode;
+    if (!options.decode.is_null()) decode = recognizer->ResolveDecode(options.decode);
+    std::vector<DecodeSpec> roi_decode_specs(options.rois.size());
+    std::vector<const DecodeSpec*> roi_decodes(options.rois.size(), options.decode.is_null() ? nullptr : &decode);
+    for (size_t i = 0; i < options.rois.size(); ++i) {
+        if (options.rois[i].decode.is_null()) continue;
+        roi_decode_specs[i] = recognizer->ResolveDecode(options.rois[i].decode);  // ROI 自带的解码方式
+        roi_decodes[i] = &roi_decode_specs[i];
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_, std::defer_lock);  // 线程安全
+    {
+        ScopedSpan span("inference_lock");  // 全局锁等待，排查长尾时常是主因
+        lock.lock();
+    }
     if (img.empty()) {
         spdlog::warn("输入图像为空");
         return json{{"results", json::array()}};
     }
 
-    auto results = RunPipeline(img);
+    ScopedDeadlineWatch watch(watchdog_, ctx);
+    auto results = !options.rois.empty() && options.roi_mode == RoiMode::kRecognize
+                       ? RecognizeRois(img, ctx, *recognizer, options, roi_decodes)
+                       : RunPipeline(img, ctx, *detector, *recognizer, options,
+                                     options.decode.is_null() ? nullptr : &decode, roi_decodes);
 
     json response;
     response["results"] = json::array();
@@ -55,6 +270,20 @@ json OCRInference::Infer(const cv::Mat& img) {
         j_res["bbox"] = res.bbox;
         j_res["text"] = res.text;
         j_res["score"] = res.score;
+        if (res.roi >= 0) {
+            j_res["roi"] = res.roi;
+            if (!options.rois[res.roi].name.empty()) j_res["name"] = options.rois[res.roi].name;
+        }
+        if (res.constrained) j_res["matched"] = res.matched;
+        if (!res.prefilter.empty()) j_res["prefilter"] = res.prefilter;
+        if (options.return_chars) {
+            // 每个字符：置信度 + 沿文本行方向的近似框（纵向沿用行框），供下游只对弱字符重识别
+            j_res["chars"] = json::array();
+            for (const auto& ch : res.chars) {
+                j_res["chars"].push_back({{"text", ch.text}, {"score", ch.score},
+                                          {"bbox", {ch.x0, res.bbox[1], ch.x1, res.bbox[3]}}});
+            }
+        }
         response["results"].push_back(j_res);
     }
 
@@ -62,14 +291,282 @@ json OCRInference::Infer(const cv::Mat& img) {
     auto postprocess = service_config_.at("model").at("postprocess");
     int max_len = postprocess.value("max_text_length", 25);
     spdlog::info("OCR 推理完成: {} 结果 (max_len: {})", results.size(), max_len);
+    if (ctx && ctx->timed_out) response["partial"] = true;  // 截止时间已到，结果不完整
+    return response;
+}
+
+json OCRInference::Detect(const std::vector<cv::Mat>& images, RequestContext* ctx, const std::string& lang) {
+    const std::string& language = lang.empty() ? default_lang_ : lang;
+    auto det_name = det_for_lang_.find(language);
+    if (det_name == det_for_lang_.end()) throw std::invalid_argument("未知识别语言: " + language);
+    std::shared_ptr<OCRDetect> detector = detectors_->Get(det_name->second);
+
+    std::unique_lock<std::mutex> lock(mutex_, std::defer_lock);
+    {
+        ScopedSpan span("inference_lock");
+        lock.lock();
+    }
+    ScopedDeadlineWatch watch(watchdog_, ctx);
+    std::vector<Detection> detections;
+    if (!ctx || ctx->CheckDeadline()) {
+        detections = detector->DetectBatch(images, ctx ? &ctx->run_options : nullptr);
+    }
+
+    json response;
+    response["results"] = json::array();
+    size_t total = 0;
+    for (size_t i = 0; i < images.size(); ++i) {
+        json boxes = json::array();
+        if (i < detections.size()) {
+            const Detection& detection = detections[i];
+            for (size_t k = 0; k < detection.boxes.size(); ++k) {
+                const auto& box = detection.boxes[k];
+                json polygon = json::array();
+                for (const auto& pt : detection.quads[k]) polygon.push_back({pt.x, pt.y});
+                boxes.push_back({{"bbox", {box[0], box[1], box[2], box[3]}}, {"polygon", polygon}, {"score", box[4]}});
+            }
+        }
+        total += boxes.size();
+        response["results"].push_back({{"boxes", std::move(boxes)}});
+    }
+    spdlog::info("检测完成: {} 张图, {} 个文本框", images.size(), total);
+    if (ctx && ctx->timed_out) response["partial"] = true;
+    return response;
+}
+
+json OCRInference::Recognize(const std::vector<cv::Mat>& crops, RequestContext* ctx, const InferOptions& options) {
+    const std::string& language = options.lang.empty() ? default_lang_ : options.lang;
+    std::shared_ptr<OCRRecognize> recognizer = recognizers_->Get(language);
+    DecodeSpec decode;
+    if (!options.decode.is_null()) decode = recognizer->ResolveDecode(options.decode);
+    const DecodeSpec* decode_ptr = options.decode.is_null() ? nullptr : &decode;
+
+    std::unique_lock<std::mutex> lock(mutex_, std::defer_lock);
+    {
+        ScopedSpan span("inference_lock");
+        lock.lock();
+    }
+    ScopedDeadlineWatch watch(watchdog_, ctx);
+    std::vector<RecognitionInput> inputs;
+    inputs.reserve(crops.size());
+    for (const auto& crop : crops) inputs.push_back({crop, decode_ptr});
+    std::vector<Recognition> recognized;
+    if (!ctx || ctx->CheckDeadline()) {
+        recognized = recognizer->RecognizeBatch(inputs, ctx ? &ctx->run_options : nullptr, options.return_chars);
+    }
+
+    json response;
+    response["results"] = json::array();
+    for (size_t i = 0; i < crops.size(); ++i) {
+        json j_res{{"text", ""}, {"score", 0.0f}};
+        if (i < recognized.size()) {
+            const Recognition& rec = recognized[i];
+            j_res["text"] = rec.text;
+            j_res["score"] = rec.text.empty() ? 0.0f : rec.score;
+            if (decode_ptr && decode_ptr->constraint) j_res["matched"] = rec.matched;
+            if (options.return_chars) {
+                j_res["chars"] = json::array();
+                for (const auto& ch : rec.chars) {
+                    j_res["chars"].push_back({{"text", ch.text}, {"score", ch.score},
+                                              {"bbox", {ch.x0, 0, ch.x1, crops[i].rows}}});
+                }
+            }
+        }
+        response["results"].push_back(std::move(j_res));
+    }
+    spdlog::info("识别完成: {} 个裁剪", crops.size());
+    if (ctx && ctx->timed_out) response["partial"] = true;
     return response;
 }
 
-std::vector<OCRResult> OCRInference::RunPipeline(const cv::Mat& img) {
+json OCRInference::Warmup(const json& warmup_config) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto elapsed_ms = [](std::chrono::steady_clock::time_point since) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - since).count();
+    };
+    int iterations = std::max(1, warmup_config.value("iterations", 1));
+    json errors = json::array();  // 单个形状失败（如模型批维固定）不中断预热
+
+    // det：默认为预处理产出的形状 [1..det_batch_num,3,max_size,max_size]（/det 按 det_batch_num 拼批，尾批可更小）；
+    // det_shapes 可追加 [[H, W], ...]（rec worker 不加载 det，跳过）
+    std::vector<std::vector<int64_t>> det_shapes;
+    for (int batch = 1; detector_ && batch <= detector_->BatchNum(); ++batch) {
+        det_shapes.push_back(detector_->CanonicalInputShape(batch));
+    }
+    for (const auto& hw : detector_ ? warmup_config.value("det_shapes", json::array()) : json::array()) {
+        std::vector<int64_t> shape{1, 3, hw.at(0).get<int64_t>(), hw.at(1).get<int64_t>()};
+        if (std::find(det_shapes.begin(), det_shapes.end(), shape) == det_shapes.end()) det_shapes.push_back(shape);
+    }
+    auto start = std::chrono::steady_clock::now();
+    for (const auto& shape : det_shapes) {
+        for (int i = 0; i < iterations; ++i) {
+            try {
+                detector_->Warmup(shape);
+            } catch (const Ort::Exception& e) {
+                errors.push_back({{"model", "det"}, {"shape", shape}, {"error", e.what()}});
+                break;
+            }
+        }
+    }
+    double det_ms = elapsed_ms(start);
+
+    // rec：默认全部宽度桶 × 1..rec_batch_num（同宽度的裁剪按 rec_batch_num 拼批，尾批可为任意大小）；
+    // 配置为空数组时同默认
+    std::vector<int> widths, batch_sizes;
+    if (recognizer_) {
+        widths = warmup_config.value("rec_widths", std::vector<int>{});
+        if (widths.empty()) widths = recognizer_->WidthBuckets();
+        batch_sizes = warmup_config.value("rec_batch_sizes", std::vector<int>{});
+        if (batch_sizes.empty()) {
+            for (int batch = 1; batch <= recognizer_->BatchNum(); ++batch) batch_sizes.push_back(batch);
+        }
+    }
+    start = std::chrono::steady_clock::now();
+    for (int batch : batch_sizes) {
+        for (int width : widths) {
+            for (int i = 0; i < iterations; ++i) {
+                try {
+                    recognizer_->Warmup(width, batch);
+                } catch (const Ort::Exception& e) {
+                    errors.push_back({{"model", "rec"}, {"width", width}, {"batch", batch}, {"error", e.what()}});
+                    break;
+                }
+            }
+        }
+    }
+    double rec_ms = elapsed_ms(start);
+
+    static Histogram& warmup_hist = MetricsRegistry::Instance().GetHistogram(
+        "ocr_warmup_duration_seconds", "Shape warm-up duration at startup and model reload", {0.1, 0.5, 1, 2, 5, 10, 30, 60});
+    warmup_hist.Observe((det_ms + rec_ms) / 1000.0);
+
+    json report = {
+        {"det", {{"shapes", det_shapes}, {"ms", det_ms}}},
+        {"rec", {{"widths", widths}, {"batch_sizes", batch_sizes}, {"height", recognizer_ ? recognizer_->ImageHeight() : 0}, {"ms", rec_ms}}},
+        {"iterations", iterations},
+        {"total_ms", det_ms + rec_ms},
+        {"errors", errors}
+    };
+    spdlog::info("预热完成: det {} 形状 {:.0f} ms, rec {} 宽度 × {} 批大小 {:.0f} ms, 失败 {}", det_shapes.size(), det_ms,
+                 widths.size(), batch_sizes.size(), rec_ms, errors.size());
+    for (const auto& error : errors) spdlog::warn("预热失败: {}", error.dump());
+    return report;
+}
+
+json OCRInference::StartProfiling(int runs, const std::vector<std::string>& models) {
+    std::string output_dir = service_config_.at("service").value("profiling_dir", "logs/profile");
+    // 先检查全部模型再开启：任一无效或已在剖析中时整体失败，不留下只开启了一半的剖析
+    std::lock_guard<std::mutex> lock(profile_mutex_);  // 检查与开启之间不被并发的开启请求插入
+    for (const auto& model : models) {
+        if (model != "det" && model != "rec") throw std::invalid_argument("未知模型: " + model + "（可选 det / rec）");
+        if ((model == "det" && !detector_) || (model == "rec" && !recognizer_)) {
+            throw std::invalid_argument("本进程未加载模型: " + model);
+        }
+        bool active = model == "det" ? detector_->ProfilingActive() : recognizer_->ProfilingActive();
+        if (runs > 0 && active) throw std::logic_error(model + " 剖析进行中");
+    }
+    std::vector<std::string> armed;
+    try {
+        for (const auto& model : models) {
+            if (model == "det") detector_->StartProfiling(runs, output_dir);
+            else recognizer_->StartProfiling(runs, output_dir);
+            armed.push_back(model);
+        }
+    } catch (...) {
+        if (runs > 0) {
+            for (const auto& model : armed) {  // 后一个模型开启失败（如创建 session 出错）：撤销已开启的
+                if (model == "det") detector_->StartProfiling(0, output_dir);
+                else recognizer_->StartProfiling(0, output_dir);
+            }
+        }
+        throw;
+    }
+    return ProfileStatus();
+}
+
+json OCRInference::LanguageStatus() const {
+    json languages = json::object();
+    for (const auto& [lang, det] : det_for_lang_) languages[lang] = {{"det", det}};
+    return {
+        {"default", default_lang_},
+        {"languages", languages},
+        {"rec", recognizers_->Status()},
+        {"det", detectors_->Status()}
+    };
+}
+
+json OCRInference::LoadInfo() const {
+    return {{"det", detector_ ? detector_->LoadInfo() : json()}, {"rec", recognizer_ ? recognizer_->LoadInfo() : json()}};
+}
+
+json OCRInference::ProfileStatus() const {
+    return {{"det", detector_ ? detector_->ProfileStatus() : json()},
+            {"rec", recognizer_ ? recognizer_->ProfileStatus() : json()}};
+}
+
+std::vector<OCRResult> OCRInference::RunPipeline(const cv::Mat& img, RequestContext* ctx, OCRDetect& detector,
+                                                 OCRRecognize& recognizer, const InferOptions& options,
+                                                 const DecodeSpec* decode,
+                                                 const std::vector<const DecodeSpec*>& roi_decodes) {
+    ScopedSpan span("pipeline");
     std::vector<OCRResult> results;
+    const Ort::RunOptions* run_options = ctx ? &ctx->run_options : nullptr;
 
-    // 1. 检测
-    auto bboxes = detector_->Detect(img);
+    // 1. 检测：整图，或 ROI / det_regions 各区域（原尺度）后平移回整图坐标；region_roi 为区域所属 ROI
+    if (ctx && !ctx->CheckDeadline()) return results;
+    cv::Rect frame(0, 0, img.cols, img.rows);
+    std::vector<cv::Rect> regions;
+    std::vector<int> region_roi;
+    if (!options.rois.empty()) {
+        for (size_t i = 0; i < options.rois.size(); ++i) {
+            cv::Rect region = cv::boundingRect(options.rois[i].quad) & frame;
+            if (region.area() <= 0) continue;
+            regions.push_back(region);
+            region_roi.push_back(static_cast<int>(i));
+        }
+    } else {
+        for (cv::Rect region : options.det_regions) {
+            region &= frame;
+            if (region.area() <= 0) continue;
+            regions.push_back(region);
+            region_roi.push_back(-1);
+        }
+    }
+    bool full_frame = options.rois.empty() && options.det_regions.empty();
+    if (full_frame) {
+        regions.push_back(frame);
+        region_roi.push_back(-1);
+    }
+    // 预过滤启用时复用检测二值图（框内填充率）；box_region[i] 为框 i 所在区域
+    std::vector<DetectionMask> masks(regions.size());
+    std::vector<std::vector<float>> bboxes;
+    std::vector<size_t> box_region;
+    for (size_t r = 0; r < regions.size(); ++r) {
+        if (ctx && !ctx->CheckDeadline()) break;
+        auto region_boxes = detector.Detect(full_frame ? img : img(regions[r]), run_options,
+                                            crop_filter_->Enabled() ? &masks[r] : nullptr, !full_frame);
+        const RegionOfInterest* roi = region_roi[r] >= 0 ? &options.rois[region_roi[r]] : nullptr;
+        for (auto& box : region_boxes) {
+            box[0] += regions[r].x;
+            box[2] += regions[r].x;
+            box[1] += regions[r].y;
+            box[3] += regions[r].y;
+            if (roi && !roi->axis_aligned &&
+                cv::pointPolygonTest(roi->quad, cv::Point2f((box[0] + box[2]) / 2, (box[1] + box[3]) / 2), false) < 0) {
+                continue;  // 外接矩形内、四边形外
+            }
+            bboxes.push_back(std::move(box));
+            box_region.push_back(r);
+        }
+    }
+    if (ctx && !ctx->CheckDeadline()) {
+        spdlog::warn("检测阶段超时，跳过识别");
+        return results;
+    }
+    static Histogram& boxes_hist = MetricsRegistry::Instance().GetHistogram(
+        "ocr_boxes_per_image", "Text boxes detected per image", {0, 1, 2, 5, 10, 20, 50, 100, 200, 500});
+    boxes_hist.Observe(static_cast<double>(bboxes.size()));
+    span.SetAttribute("boxes", bboxes.size());
     if (bboxes.empty()) {
         spdlog::debug("未检测到文本框");
         return results;
@@ -79,31 +576,130 @@ std::vector<OCRResult> OCRInference::RunPipeline(const cv::Mat& img) {
     // for each bbox: float angle = cls_->Classify(crop); rotate if needed
 
     // 3. 识别
-    for (const auto& bbox : bboxes) {
+    for (size_t b = 0; b < bboxes.size(); ++b) {
+        const auto& bbox = bboxes[b];
+        if (ctx && !ctx->CheckDeadline()) {
+            spdlog::warn("识别阶段超时，返回部分结果 ({}/{})", results.size(), bboxes.size());
+            break;
+        }
         if (bbox.size() != 5) continue;  // [x1,y1,x2,y2,score]
-        cv::Rect roi(static_cast<int>(bbox[0]), static_cast<int>(bbox[1]),
-                     static_cast<int>(bbox[2] - bbox[0]), static_cast<int>(bbox[3] - bbox[1]));
-        if (roi.area() <= 0 || roi.x < 0 || roi.y < 0) continue;
-
-        cv::Mat crop = img(roi);
-        if (crop.empty()) continue;
+        cv::Mat crop;
+        CropFilter::Decision prefilter;
+        {
+            ScopedStageTimer timer(Stage::kCrop);
+            cv::Rect roi(static_cast<int>(bbox[0]), static_cast<int>(bbox[1]),
+                         static_cast<int>(bbox[2] - bbox[0]), static_cast<int>(bbox[3] - bbox[1]));
+            if (roi.area() <= 0 || roi.x < 0 || roi.y < 0) continue;
+            roi &= cv::Rect(0, 0, img.cols, img.rows);  // 区域检测的框可能落入补边
+            if (roi.area() <= 0) continue;
+            crop = img(roi);
+            if (crop.empty()) continue;
+            if (crop_filter_->Enabled()) {
+                cv::Mat mask_roi;
+                const DetectionMask& mask = masks[box_region[b]];
+                if (!mask.binary.empty()) {
+                    cv::Point origin = regions[box_region[b]].tl();  // 二值图坐标相对所在区域
+                    cv::Rect mask_rect(cv::Point(static_cast<int>((bbox[0] - origin.x) * mask.ratio),
+                                                 static_cast<int>((bbox[1] - origin.y) * mask.ratio)),
+                                       cv::Point(static_cast<int>(std::ceil((bbox[2] - origin.x) * mask.ratio)),
+                                                 static_cast<int>(std::ceil((bbox[3] - origin.y) * mask.ratio))));
+                    mask_rect &= cv::Rect(0, 0, mask.binary.cols, mask.binary.rows);
+                    if (mask_rect.area() > 0) mask_roi = mask.binary(mask_rect);
+                }
+                prefilter = crop_filter_->Evaluate(crop, mask_roi);
+            }
+        }
+        // enforce：表格线 / 空白 / 噪点框不进识别；shadow：照常识别，只标记
+        if (prefilter.drop && crop_filter_->GetMode() == CropFilter::Mode::kEnforce) continue;
 
         float rec_score = 0.0f;
-        std::string text = recognizer_->Recognize(crop, rec_score);
+        std::vector<RecognizedChar> chars;
+        bool matched = true;
+        int roi = region_roi[box_region[b]];
+        const DecodeSpec* box_decode = roi >= 0 ? roi_decodes[roi] : decode;
+        std::string text = recognizer.Recognize(crop, rec_score, run_options, options.return_chars ? &chars : nullptr,
+                                                box_decode, &matched);
         if (text.empty() || rec_score < 0.1f) continue;  // 最小阈值
 
         OCRResult res;
+        float crop_x = static_cast<float>(static_cast<int>(bbox[0]));  // 裁剪左边缘（与 roi.x 一致）
+        for (auto& ch : chars) {
+            ch.x0 += crop_x;
+            ch.x1 += crop_x;
+        }
+        res.chars = std::move(chars);
+        res.matched = matched;
+        res.roi = roi;
+        res.constrained = box_decode && box_decode->constraint;
         res.bbox = {bbox[0], bbox[1], bbox[2], bbox[3]};
         res.text = std::move(text);
         res.score = std::max(bbox[4], rec_score);  // 取最大分数（det or rec）
+        if (prefilter.drop) {  // shadow：会被丢弃却识别出了文本
+            crop_filter_->RecordShadowMiss(prefilter);
+            res.prefilter = prefilter.reason;
+        }
 
         results.push_back(std::move(res));
     }
 
-    // 4. 排序（可选，按 y 坐标）
+    // 4. 排序（可选，按 y 坐标；有 ROI 时先按 ROI 分组）
     std::sort(results.begin(), results.end(), [](const OCRResult& a, const OCRResult& b) {
+        if (a.roi != b.roi) return a.roi < b.roi;
         return a.bbox[1] < b.bbox[1];  // top-to-bottom
     });
 
+    return results;
+}
+
+std::vector<OCRResult> OCRInference::RecognizeRois(const cv::Mat& img, RequestContext* ctx, OCRRecognize& recognizer,
+                                                   const InferOptions& options,
+                                                   const std::vector<const DecodeSpec*>& roi_decodes) {
+    ScopedSpan span("pipeline");
+    span.SetAttribute("rois", options.rois.size());
+    std::vector<OCRResult> results(options.rois.size());
+    if (ctx && !ctx->CheckDeadline()) return {};
+
+    std::vector<RoiCrop> crops(options.rois.size());
+    std::vector<RecognitionInput> inputs;
+    std::vector<size_t> input_roi;
+    {
+        ScopedStageTimer timer(Stage::kCrop);
+        for (size_t i = 0; i < options.rois.size(); ++i) {
+            results[i].roi = static_cast<int>(i);
+            results[i].bbox = QuadBounds(options.rois[i].quad, img);
+            results[i].score = 0.0f;
+            results[i].constrained = roi_decodes[i] && roi_decodes[i]->constraint;
+            crops[i] = CropRoi(img, options.rois[i]);
+            if (crops[i].image.empty()) continue;  // 完全在图像外：空结果
+            inputs.push_back({crops[i].image, roi_decodes[i]});
+            input_roi.push_back(i);
+        }
+    }
+
+    // 一次调用内按宽度分组拼批（rec_batch_num），不经检测
+    const Ort::RunOptions* run_options = ctx ? &ctx->run_options : nullptr;
+    auto recognized = recognizer.RecognizeBatch(inputs, run_options, options.return_chars);
+    for (size_t k = 0; k < recognized.size(); ++k) {
+        size_t i = input_roi[k];
+        OCRResult& res = results[i];
+        res.text = std::move(recognized[k].text);
+        res.score = res.text.empty() ? 0.0f : recognized[k].score;
+        res.matched = recognized[k].matched;
+        // 逐字符横向范围：裁剪图横坐标按比例落到阅读方向的两条边上，取外接横向范围
+        const RoiCrop& crop = crops[i];
+        float width = static_cast<float>(crop.image.cols);
+        for (auto& ch : recognized[k].chars) {
+            float xs[4];
+            int n = 0;
+            for (float x : {ch.x0, ch.x1}) {
+                float t = std::clamp(x / width, 0.0f, 1.0f);
+                xs[n++] = crop.edge_a0.x + t * (crop.edge_a1.x - crop.edge_a0.x);
+                xs[n++] = crop.edge_b0.x + t * (crop.edge_b1.x - crop.edge_b0.x);
+            }
+            ch.x0 = *std::min_element(xs, xs + 4);
+            ch.x1 = *std::max_element(xs, xs + 4);
+        }
+        res.chars = std::move(recognized[k].chars);
+    }
     return results;
 }
\ No newline at end of file
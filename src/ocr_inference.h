@@ -3,11 +3,16 @@
 
 #include "ocr_detect.h"
 #include "ocr_recognize.h"
+#include "ocr_context.h"
+#include "ocr_crop_filter.h"
+#include "ocr_model_registry.h"
 #include <opencv2/opencv.hpp>
 #include <nlohmann/json.hpp>
-#include <vector>
+#include <map>
 #include <memory>
 #include <mutex>
+#include <string>
+#include <vector>
 
 using json = nlohmann::json;
 
@@ -15,22 +20,104 @@ struct OCRResult {
     std::vector<float> bbox;
     std::string text;
     float score;
+    std::vector<RecognizedChar> chars;  // 仅 return_chars 时填充；x0 / x1 为图像坐标
+    bool matched = true;                // 约束解码命中（未命中时 text 为贪心结果）
+    std::string prefilter;              // shadow 预过滤：会被丢弃的原因（空 = 保留）
+    int roi = -1;                       // 所属 ROI 下标（无 ROI 为 -1）
+    bool constrained = false;           // 解码带词典 / 正则约束（输出 matched）
+};
+
+// 请求中的 ROI（已知版面）：轴对齐框或四边形（左上起顺时针），可带名称与独立的解码方式
+struct RegionOfInterest {
+    std::vector<cv::Point2f> quad;  // 4 点；轴对齐框也存为 4 点
+    bool axis_aligned = true;
+    std::string name;
+    json decode;  // null = 沿用请求级 decode
+};
+
+enum class RoiMode {
+    kDetect,     // 只在各 ROI 内检测后识别
+    kRecognize,  // 跳过检测，ROI 直接批量识别
+};
+
+// 解析请求的 "rois"：[{"box": [x1,y1,x2,y2]} 或 {"quad": [[x,y] × 4]}，可选 "name" / "decode"]；
+// 格式错误抛 std::invalid_argument
+std::vector<RegionOfInterest> ParseRois(const json& rois);
+
+// ROI 裁剪（四边形透视校正）；edge_a / edge_b 为阅读方向上的两条边（起点 → 终点），
+// 裁剪图中的横坐标按比例映射到这两条边上，得到逐字符在原图中的横向范围
+struct RoiCrop {
+    cv::Mat image;
+    cv::Point2f edge_a0, edge_a1, edge_b0, edge_b1;
+};
+
+// 与图像不相交或坐标非有限值时 image 为空；四边形输出尺寸不超过图像对角线（超出时等比缩小）
+RoiCrop CropRoi(const cv::Mat& img, const RegionOfInterest& roi);
+
+// 单次请求的推理选项
+struct InferOptions {
+    std::string lang;           // model.languages 中的识别语言（空 = default_lang）
+    bool return_chars = false;  // 结果附带逐字符置信度与位置（"chars"）
+    json decode;                // 解码方式：decode_profiles 名称或内联对象（null = 贪心），见 OCRRecognize::ResolveDecode
+    // 非空时只在这些区域内检测（各区域按原尺度，不放大到 max_size），结果仍为整图坐标；
+    // 区域会裁剪到图像范围内，重叠区域的重复框由调用方保证不出现（区域互不相交）
+    std::vector<cv::Rect> det_regions;
+    // rois 非空时忽略 det_regions，按 roi_mode 处理：
+    //   kDetect：各 ROI 的外接矩形内按原尺度检测（四边形 ROI 只保留中心落在四边形内的框），结果带 roi 下标；
+    //   kRecognize：不跑检测，四边形先透视校正，全部 ROI 一次批量识别；每个 ROI 恰好一条结果（识别不出时 text 为空），按请求顺序
+    std::vector<RegionOfInterest> rois;
+    RoiMode roi_mode = RoiMode::kDetect;
 };
 
 class OCRInference {
 public:
     OCRInference(const json& service_config);  // 从分层 JSON 初始化
-    json Infer(const cv::Mat& img);  // 端到端推理，返回 JSON results array
+    // 端到端推理，返回 JSON results array；ctx 携带截止时间，超时返回已完成的部分结果（"partial": true）。
+    // options.lang 未注册抛 std::invalid_argument
+    json Infer(const cv::Mat& img, RequestContext* ctx = nullptr, const InferOptions& options = {});
+    // 仅检测（/det）：多图按 det_batch_num 拼批，返回 {"results": [{"boxes": [{"bbox", "polygon", "score"}]}]}，
+    // 与 images 一一对应。lang 选择该语言使用的 det；超时后未处理的图结果为空并带 "partial"
+    json Detect(const std::vector<cv::Mat>& images, RequestContext* ctx = nullptr, const std::string& lang = "");
+    // 仅识别（/rec）：每张图视为一条已裁好的文本行，按宽度分组批量识别，
+    // 返回 {"results": [{"text", "score", "matched"?, "chars"?}]}，与 crops 一一对应（chars 的 bbox 为裁剪图坐标）
+    json Recognize(const std::vector<cv::Mat>& crops, RequestContext* ctx = nullptr, const InferOptions& options = {});
+    // 对 det / rec 接下来 runs 次 Run 开启 ORT 算子级剖析（runs = 0 取消）；返回当前状态
+    json StartProfiling(int runs, const std::vector<std::string>& models);
+    json ProfileStatus() const;
+    // 实际加载的模型变体：{"det": {"path", "precision", "fallback"?}, "rec": {...}}
+    const json& ModelVariants() const { return model_variants_; }
+    // 语言注册表：默认语言、各语言使用的 det、常驻 / 加载次数
+    json LanguageStatus() const;
+    // 默认语言各模型的加载方式与 RSS 增量：{"det": {...}, "rec": {...}}
+    json LoadInfo() const;
+    const json& Config() const { return service_config_; }  // 构造时的 service_config（热重载后随管道替换）
+    // 预热：det 各规范输入形状、rec 各宽度桶 × 批大小各跑 iterations 次全零输入，触发 ORT 按形状的
+    // 内存分配与 kernel 选择；warmup_config 见 service.warmup。返回各阶段耗时与形状列表
+    json Warmup(const json& warmup_config);
 
 private:
-    std::unique_ptr<OCRDetect> detector_;
-    std::unique_ptr<OCRRecognize> recognizer_;
+    std::shared_ptr<OCRDetect> detector_;        // 默认语言（常驻），预热 / 剖析作用于此；阶段 worker 只加载其一
+    std::shared_ptr<OCRRecognize> recognizer_;
+    std::unique_ptr<ModelRegistry<OCRDetect>> detectors_;      // 按语言名注册
+    std::unique_ptr<ModelRegistry<OCRRecognize>> recognizers_;
+    std::map<std::string, std::string> det_for_lang_;  // 语言 → det 注册名（未覆盖的语言共享默认 det）
+    std::string default_lang_;
     // std::unique_ptr<OCRCls> cls_;  // 可选方向分类（若启用）
 
     json service_config_;  // 存储完整 service_config
+    json model_variants_;  // FP32 / INT8 选择结果
     std::mutex mutex_;  // 线程安全（全局锁，生产用线程池优化）
+    std::mutex profile_mutex_;  // 串行化 StartProfiling（与推理锁无关）
+    DeadlineWatchdog watchdog_;  // 到期请求的 Session::Run 终止
+    std::unique_ptr<CropFilter> crop_filter_;  // 识别前的裁剪预过滤（postprocess.crop_filter）
 
-    std::vector<OCRResult> RunPipeline(const cv::Mat& img);  // 内部管道
+    // 内部管道；roi_decodes[i] 为 ROI i 实际使用的解码方式
+    std::vector<OCRResult> RunPipeline(const cv::Mat& img, RequestContext* ctx, OCRDetect& detector,
+                                       OCRRecognize& recognizer, const InferOptions& options,
+                                       const DecodeSpec* decode, const std::vector<const DecodeSpec*>& roi_decodes);
+    // RoiMode::kRecognize：跳过检测
+    std::vector<OCRResult> RecognizeRois(const cv::Mat& img, RequestContext* ctx, OCRRecognize& recognizer,
+                                         const InferOptions& options, const std::vector<const DecodeSpec*>& roi_decodes);
 };
 
 #endif // OCR_INFERENCE_H
\ No newline at end of file
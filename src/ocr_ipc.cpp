@@ -0,0 +1,414 @@
+#include "ocr_ipc.h"
+#include "ocr_metrics.h"
+#include <spdlog/spdlog.h>
+#include <cstring>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+#ifndef _WIN32
+
+#ifdef MSG_NOSIGNAL
+constexpr int kSendFlags = MSG_NOSIGNAL;  // 对端已关闭时返回 EPIPE 而不是 SIGPIPE
+#else
+constexpr int kSendFlags = 0;
+#endif
+
+bool ReadAll(int fd, void* data, size_t size) {
+    auto* p = static_cast<uint8_t*>(data);
+    while (size > 0) {
+        ssize_t n = ::recv(fd, p, size, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool WriteAll(int fd, const void* data, size_t size) {
+    const auto* p = static_cast<const uint8_t*>(data);
+    while (size > 0) {
+        ssize_t n = ::send(fd, p, size, kSendFlags);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// ms = 0 不设超时；超时后 recv / send 返回 EAGAIN，ReadAll / WriteAll 失败
+void SetTimeout(int fd, int option, int ms) {
+    timeval tv{};
+    tv.tv_sec = ms / 1000;
+    tv.tv_usec = (ms % 1000) * 1000;
+    ::setsockopt(fd, SOL_SOCKET, option, &tv, sizeof(tv));
+}
+
+bool TimedOut() {
+    return errno == EAGAIN || errno == EWOULDBLOCK;
+}
+
+void DisableSigpipe(int fd) {
+#ifdef SO_NOSIGPIPE
+    int on = 1;
+    ::setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#else
+    (void)fd;
+#endif
+}
+
+sockaddr_un SocketAddress(const std::string& path) {
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(addr.sun_path)) {
+        throw std::runtime_error("无效套接字路径（空或过长）: " + path);
+    }
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    return addr;
+}
+
+bool SendReply(int fd, uint32_t slot, const IpcReply& reply) {
+    std::vector<uint8_t> body = json::to_msgpack(reply.body);
+    IpcReplyHeader header;
+    header.slot = slot;
+    header.status = reply.status;
+    header.body_bytes = static_cast<uint32_t>(body.size());
+    return WriteAll(fd, &header, sizeof(header)) && WriteAll(fd, body.data(), body.size());
+}
+
+#endif  // _WIN32
+
+}  // namespace
+
+IpcServer::IpcServer(const json& config, Handler handler)
+    : socket_path_(config.value("socket", "/tmp/ocr/ingest.sock")),
+      slots_(config.value("slots", 4u)),
+      slot_bytes_(static_cast<uint64_t>(config.value("slot_mb", 24.0) * 1024 * 1024)),
+      max_connections_(config.value("max_connections", 8)),
+      handshake_timeout_ms_(config.value("handshake_timeout_ms", 1000)),
+      idle_timeout_ms_(config.value("idle_timeout_ms", 60000)),
+      handler_(std::move(handler)) {
+    if (slots_ == 0 || slots_ > 64) throw std::invalid_argument("ipc.slots 须在 1..64 之间");
+    if (slot_bytes_ < 3) throw std::invalid_argument("ipc.slot_mb 过小");
+    if (max_connections_ == 0) throw std::invalid_argument("ipc.max_connections 必须为正");
+    if (handshake_timeout_ms_ <= 0) throw std::invalid_argument("ipc.handshake_timeout_ms 必须为正");
+    if (idle_timeout_ms_ < 0) throw std::invalid_argument("ipc.idle_timeout_ms 不能为负");
+    auto& registry = MetricsRegistry::Instance();
+    frames_ = &registry.GetCounter("ocr_ipc_frames_total", "Frames received over the shared-memory ingestion channel");
+    rejected_connections_ = &registry.GetCounter("ocr_ipc_rejected_connections_total",
+                                                 "IPC connections refused at the max_connections cap");
+    timed_out_connections_ = &registry.GetCounter("ocr_ipc_timed_out_connections_total",
+                                                  "IPC connections closed by the handshake or idle timeout");
+}
+
+IpcServer::~IpcServer() {
+    Stop();
+}
+
+#ifndef _WIN32
+
+void IpcServer::Start() {
+    sockaddr_un addr = SocketAddress(socket_path_);
+    ::unlink(socket_path_.c_str());  // 上次退出残留的套接字文件
+    listen_fd_ = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd_ < 0) throw std::runtime_error("创建套接字失败: " + std::string(std::strerror(errno)));
+    if (::bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || ::listen(listen_fd_, 16) < 0) {
+        std::string error = std::strerror(errno);
+        ::close(listen_fd_);
+        listen_fd_ = -1;
+        throw std::runtime_error("监听 " + socket_path_ + " 失败: " + error);
+    }
+    stopping_ = false;
+    accept_thread_ = std::thread(&IpcServer::AcceptLoop, this);
+    spdlog::info("共享内存摄取: {} ({} 槽位 × {:.1f} MB, 连接上限 {})", socket_path_, slots_,
+                 slot_bytes_ / (1024.0 * 1024.0), max_connections_);
+}
+
+void IpcServer::Stop() {
+    if (listen_fd_ < 0) return;
+    stopping_ = true;
+    if (accept_thread_.joinable()) accept_thread_.join();
+    ::close(listen_fd_);
+    listen_fd_ = -1;
+    ::unlink(socket_path_.c_str());
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& connection : connections_) ::shutdown(connection.fd, SHUT_RDWR);  // 唤醒阻塞在 recv 上的连接线程
+    for (auto& connection : connections_) {
+        if (connection.thread.joinable()) connection.thread.join();
+        ::close(connection.fd);
+    }
+    connections_.clear();
+}
+
+void IpcServer::AcceptLoop() {
+    pollfd pfd{listen_fd_, POLLIN, 0};
+    while (!stopping_) {
+        int ready = ::poll(&pfd, 1, 200);  // 定期检查 stopping_（部分平台 shutdown 不能唤醒 accept）
+        if (ready <= 0) continue;
+        int fd = ::accept(listen_fd_, nullptr, nullptr);
+        if (fd < 0) continue;
+        DisableSigpipe(fd);
+        std::lock_guard<std::mutex> lock(mutex_);
+        ReapFinished();
+        if (connections_.size() >= max_connections_) {
+            rejected_connections_->Inc();
+            spdlog::warn("共享内存摄取连接数已达上限 {}，拒绝新连接", max_connections_);
+            ::close(fd);
+            continue;
+        }
+        connections_.emplace_back();
+        Connection& connection = connections_.back();
+        connection.fd = fd;
+        connection.thread = std::thread(&IpcServer::Serve, this, std::ref(connection));
+    }
+}
+
+void IpcServer::ReapFinished() {
+    for (auto it = connections_.begin(); it != connections_.end();) {
+        if (!it->done) {
+            ++it;
+            continue;
+        }
+        if (it->thread.joinable()) it->thread.join();
+        ::close(it->fd);
+        it = connections_.erase(it);
+    }
+}
+
+void IpcServer::Serve(Connection& connection) {
+    int fd = connection.fd;
+    std::string name = "/ocr_ipc_" + std::to_string(::getpid()) + "_" + std::to_string(connection_seq_++);
+    size_t total = static_cast<size_t>(slots_) * slot_bytes_;
+    void* base = MAP_FAILED;
+    int shm_fd = ::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (shm_fd >= 0) {
+        if (::ftruncate(shm_fd, static_cast<off_t>(total)) == 0) {
+            base = ::mmap(nullptr, total, PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
+        }
+        ::close(shm_fd);
+    }
+    if (base == MAP_FAILED) {
+        spdlog::error("创建共享内存 {} 失败: {}", name, std::strerror(errno));
+        ::shm_unlink(name.c_str());
+        ::shutdown(fd, SHUT_RDWR);
+        connection.done = true;
+        return;
+    }
+
+    // 握手：客户端映射完成后立即 unlink，之后名字不再可见，两端退出后内核自动回收
+    IpcHello hello;
+    hello.slots = slots_;
+    hello.slot_bytes = slot_bytes_;
+    std::strncpy(hello.shm_name, name.c_str(), sizeof(hello.shm_name) - 1);
+    // 握手须在 handshake_timeout_ms 内完成，之后 recv / send 超过 idle_timeout_ms 无进展即断开，
+    // 避免不回确认或长期空闲的客户端占满 max_connections 个连接线程
+    SetTimeout(fd, SO_RCVTIMEO, handshake_timeout_ms_);
+    SetTimeout(fd, SO_SNDTIMEO, handshake_timeout_ms_);
+    uint32_t ack = 0;
+    errno = 0;
+    bool ok = WriteAll(fd, &hello, sizeof(hello)) && ReadAll(fd, &ack, sizeof(ack)) && ack == kIpcMagic;
+    ::shm_unlink(name.c_str());
+    if (ok) {
+        spdlog::debug("共享内存摄取: 新连接 ({})", name);
+        SetTimeout(fd, SO_RCVTIMEO, idle_timeout_ms_);
+        SetTimeout(fd, SO_SNDTIMEO, idle_timeout_ms_);
+    } else if (TimedOut()) {
+        timed_out_connections_->Inc();
+        spdlog::warn("共享内存摄取: 握手超时（{} ms），断开连接", handshake_timeout_ms_);
+    }
+
+    const auto* slots = static_cast<const uint8_t*>(base);
+    std::string options_text;
+    while (ok && !stopping_) {
+        IpcDoorbell bell;
+        errno = 0;
+        if (!ReadAll(fd, &bell, sizeof(bell))) {  // 客户端关闭或空闲超时
+            if (TimedOut()) {
+                timed_out_connections_->Inc();
+                spdlog::info("共享内存摄取: 连接空闲超过 {} ms，断开 ({})", idle_timeout_ms_, name);
+            }
+            break;
+        }
+        if (bell.magic != kIpcMagic || bell.options_bytes > kIpcMaxOptionsBytes) {
+            spdlog::warn("共享内存摄取: 无效门铃消息，断开连接");
+            break;
+        }
+        options_text.resize(bell.options_bytes);
+        if (!ReadAll(fd, options_text.data(), options_text.size())) break;
+        frames_->Inc();
+
+        IpcReply reply;
+        uint64_t frame_bytes = static_cast<uint64_t>(bell.width) * bell.height * 3;
+        if (bell.slot >= slots_ || bell.width == 0 || bell.height == 0 || frame_bytes > slot_bytes_) {
+            reply = {400, {{"error", "无效帧：槽位越界或超过槽位大小"}}};
+        } else {
+            IpcFrame frame;
+            frame.pixels = slots + static_cast<size_t>(bell.slot) * slot_bytes_;
+            frame.width = static_cast<int>(bell.width);
+            frame.height = static_cast<int>(bell.height);
+            frame.stride = static_cast<size_t>(bell.width) * 3;
+            try {
+                frame.options = options_text.empty() ? json::object() : json::parse(options_text);
+                reply = handler_(frame);
+            } catch (const json::exception& e) {
+                reply = {400, {{"error", std::string("选项 JSON 无效: ") + e.what()}}};
+            } catch (const std::exception& e) {
+                reply = {500, {{"error", e.what()}}};
+            }
+        }
+        ok = SendReply(fd, bell.slot, reply);
+    }
+    ::munmap(base, total);
+    ::shutdown(fd, SHUT_RDWR);  // 立即让对端读到 EOF；fd 本身留到 ReapFinished / Stop 关闭
+    connection.done = true;
+}
+
+#else  // _WIN32
+
+void IpcServer::Start() {
+    throw std::runtime_error("共享内存摄取仅支持 POSIX 平台（Linux / macOS）");
+}
+
+void IpcServer::Stop() {}
+void IpcServer::AcceptLoop() {}
+void IpcServer::Serve(Connection&) {}
+void IpcServer::ReapFinished() {}
+
+#endif  // _WIN32
+
+json IpcServer::Stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t active = 0;
+    for (const auto& connection : connections_) active += !connection.done;
+    return {
+        {"socket", socket_path_},
+        {"connections", active},
+        {"slots", slots_},
+        {"slot_bytes", slot_bytes_},
+        {"idle_timeout_ms", idle_timeout_ms_},
+        {"frames", frames_->Value()},
+        {"timed_out_connections", timed_out_connections_->Value()}
+    };
+}
+
+#ifndef _WIN32
+
+IpcClient::IpcClient(const std::string& socket_path) {
+    sockaddr_un addr = SocketAddress(socket_path);
+    fd_ = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd_ < 0) throw std::runtime_error("创建套接字失败: " + std::string(std::strerror(errno)));
+    DisableSigpipe(fd_);
+    IpcHello hello;
+    if (::connect(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || !ReadAll(fd_, &hello, sizeof(hello))) {
+        std::string error = std::strerror(errno);
+        ::close(fd_);
+        throw std::runtime_error("连接 " + socket_path + " 失败: " + error);
+    }
+    if (hello.magic != kIpcMagic || hello.version != kIpcVersion || hello.slots == 0) {
+        ::close(fd_);
+        throw std::runtime_error("共享内存摄取握手失败：协议版本不匹配");
+    }
+    hello.shm_name[sizeof(hello.shm_name) - 1] = '\0';
+    slots_ = hello.slots;
+    slot_bytes_ = hello.slot_bytes;
+    mapped_bytes_ = static_cast<size_t>(slots_) * slot_bytes_;
+    int shm_fd = ::shm_open(hello.shm_name, O_RDWR, 0);
+    void* base = MAP_FAILED;
+    if (shm_fd >= 0) {
+        base = ::mmap(nullptr, mapped_bytes_, PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
+        ::close(shm_fd);
+    }
+    if (base == MAP_FAILED) {
+        std::string error = std::strerror(errno);
+        ::close(fd_);
+        throw std::runtime_error("映射共享内存 " + std::string(hello.shm_name) + " 失败: " + error);
+    }
+    base_ = static_cast<uint8_t*>(base);
+    uint32_t ack = kIpcMagic;
+    if (!WriteAll(fd_, &ack, sizeof(ack))) {
+        ::munmap(base_, mapped_bytes_);
+        ::close(fd_);
+        throw std::runtime_error("共享内存摄取握手失败：连接已断开");
+    }
+}
+
+IpcClient::~IpcClient() {
+    if (base_) ::munmap(base_, mapped_bytes_);
+    if (fd_ >= 0) ::close(fd_);
+}
+
+void IpcClient::Submit(const uint8_t* bgr, int width, int height, size_t stride, const json& options) {
+    uint64_t row_bytes = static_cast<uint64_t>(width) * 3;
+    if (width <= 0 || height <= 0 || row_bytes * height > slot_bytes_ || stride < row_bytes) {
+        throw std::invalid_argument("帧尺寸无效或超过槽位大小 (" + std::to_string(width) + "x" + std::to_string(height) + ")");
+    }
+    if (in_flight_.size() == slots_) ready_.push_back(ReadReply());  // 环满：先取回最早一帧腾出槽位
+
+    uint32_t slot = next_slot_;
+    next_slot_ = (next_slot_ + 1) % slots_;
+    uint8_t* dst = base_ + static_cast<size_t>(slot) * slot_bytes_;
+    if (stride == row_bytes) {
+        std::memcpy(dst, bgr, row_bytes * height);
+    } else {
+        for (int y = 0; y < height; ++y) std::memcpy(dst + y * row_bytes, bgr + y * stride, row_bytes);
+    }
+
+    std::string options_text = options.empty() ? std::string() : options.dump();
+    if (options_text.size() > kIpcMaxOptionsBytes) throw std::invalid_argument("选项过大");
+    IpcDoorbell bell;
+    bell.slot = slot;
+    bell.width = static_cast<uint32_t>(width);
+    bell.height = static_cast<uint32_t>(height);
+    bell.options_bytes = static_cast<uint32_t>(options_text.size());
+    if (!WriteAll(fd_, &bell, sizeof(bell)) || !WriteAll(fd_, options_text.data(), options_text.size())) {
+        throw std::runtime_error("共享内存摄取: 连接已断开");
+    }
+    in_flight_.push_back(slot);
+}
+
+IpcReply IpcClient::Receive() {
+    if (!ready_.empty()) {
+        IpcReply reply = std::move(ready_.front());
+        ready_.pop_front();
+        return reply;
+    }
+    if (in_flight_.empty()) throw std::logic_error("没有在途的帧");
+    return ReadReply();
+}
+
+IpcReply IpcClient::ReadReply() {
+    IpcReplyHeader header;
+    if (!ReadAll(fd_, &header, sizeof(header)) || header.magic != kIpcMagic) {
+        throw std::runtime_error("共享内存摄取: 读取结果失败（连接已断开）");
+    }
+    std::vector<uint8_t> body(header.body_bytes);
+    if (!ReadAll(fd_, body.data(), body.size())) throw std::runtime_error("共享内存摄取: 结果不完整");
+    if (in_flight_.empty() || in_flight_.front() != header.slot) throw std::runtime_error("共享内存摄取: 结果顺序错乱");
+    in_flight_.pop_front();
+    return {header.status, json::from_msgpack(body)};
+}
+
+#else  // _WIN32
+
+IpcClient::IpcClient(const std::string&) {
+    throw std::runtime_error("共享内存摄取仅支持 POSIX 平台（Linux / macOS）");
+}
+
+IpcClient::~IpcClient() {}
+void IpcClient::Submit(const uint8_t*, int, int, size_t, const json&) {}
+IpcReply IpcClient::Receive() { return {}; }
+IpcReply IpcClient::ReadReply() { return {}; }
+
+#endif  // _WIN32
@@ -0,0 +1,148 @@
+#ifndef OCR_IPC_H
+#define OCR_IPC_H
+
+#include <json.hpp>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <string>
+#include <thread>
+
+using json = nlohmann::json;
+
+class Counter;
+
+// 同机共享内存摄取（service.ipc，仅 POSIX）：客户端把解码后的 BGR 像素直接写进共享内存环形槽位，
+// 经 Unix 域套接字“按门铃”通知服务端；服务端就地包装成图像交给推理（零拷贝），结果从同一套接字返回。
+// 省去 /ocr 路径上的图像编码、base64、HTTP 与服务端解码。
+//
+// 每个连接独占一段共享内存（slots 个槽位 × slot_bytes），握手后即 shm_unlink，进程退出不残留。
+// 套接字上的消息（本机字节序）：
+//   服务端 → 客户端：IpcHello（共享内存名与布局）；客户端映射后回 4 字节 kIpcMagic 确认
+//   客户端 → 服务端：IpcDoorbell + options_bytes 字节 JSON 选项（lang / return_chars / decode / rois / timeout_ms ...）
+//   服务端 → 客户端：IpcReplyHeader + body_bytes 字节 MessagePack 响应；同一连接按门铃顺序串行处理、按序返回
+constexpr uint32_t kIpcMagic = 0x4952434f;  // "OCRI"
+constexpr uint32_t kIpcVersion = 1;
+constexpr uint32_t kIpcMaxOptionsBytes = 64 * 1024;
+
+struct IpcHello {
+    uint32_t magic = kIpcMagic;
+    uint32_t version = kIpcVersion;
+    uint32_t slots = 0;
+    uint32_t reserved = 0;
+    uint64_t slot_bytes = 0;
+    char shm_name[64] = {};
+};
+
+struct IpcDoorbell {
+    uint32_t magic = kIpcMagic;
+    uint32_t slot = 0;
+    uint32_t width = 0;   // 像素为连续存放的 BGR 8 位，行距 width * 3
+    uint32_t height = 0;
+    uint32_t options_bytes = 0;
+    uint32_t reserved = 0;
+};
+
+struct IpcReplyHeader {
+    uint32_t magic = kIpcMagic;
+    uint32_t slot = 0;
+    int32_t status = 0;  // 与 HTTP 状态码一致：200 / 400 / 503 / 504 / 500
+    uint32_t body_bytes = 0;
+};
+
+// 一帧请求：pixels 指向共享内存槽位，仅在处理函数返回前有效
+struct IpcFrame {
+    const uint8_t* pixels = nullptr;
+    int width = 0;
+    int height = 0;
+    size_t stride = 0;
+    json options;
+};
+
+struct IpcReply {
+    int status = 200;
+    json body;  // 200 时同 /ocr 响应；其余为 {"error": "..."}
+};
+
+class IpcServer {
+public:
+    using Handler = std::function<IpcReply(const IpcFrame& frame)>;
+
+    // config：socket（套接字路径）、slots（4）、slot_mb（每槽位 MB，24 ≈ 4096×2048 BGR）、max_connections（8）、
+    // handshake_timeout_ms（1000，客户端须在此时间内回确认）、idle_timeout_ms（60000，无门铃超过此时间断开；0 = 不限）
+    IpcServer(const json& config, Handler handler);
+    ~IpcServer();
+
+    // 绑定套接字并启动接收线程；失败抛 std::runtime_error（Windows 上始终抛出）
+    void Start();
+    void Stop();
+    json Stats() const;
+
+private:
+    std::string socket_path_;
+    uint32_t slots_;
+    uint64_t slot_bytes_;
+    size_t max_connections_;
+    int handshake_timeout_ms_;
+    int idle_timeout_ms_;
+    Handler handler_;
+
+    int listen_fd_ = -1;
+    std::atomic<bool> stopping_{false};
+    std::thread accept_thread_;
+    mutable std::mutex mutex_;  // 保护 connections_
+    struct Connection {
+        int fd = -1;
+        std::thread thread;
+        std::atomic<bool> done{false};
+    };
+    std::list<Connection> connections_;
+    std::atomic<uint64_t> connection_seq_{0};
+    Counter* frames_;
+    Counter* rejected_connections_;
+    Counter* timed_out_connections_;
+
+    void AcceptLoop();
+    void Serve(Connection& connection);
+    void ReapFinished();  // 持 mutex_ 调用
+};
+
+// 客户端：连接、映射共享内存后可流水线提交至多 slots 帧
+class IpcClient {
+public:
+    explicit IpcClient(const std::string& socket_path);  // 连接或映射失败抛 std::runtime_error
+    ~IpcClient();
+    IpcClient(const IpcClient&) = delete;
+    IpcClient& operator=(const IpcClient&) = delete;
+
+    uint32_t Slots() const { return slots_; }
+    uint64_t SlotBytes() const { return slot_bytes_; }
+    size_t InFlight() const { return in_flight_.size(); }
+
+    // 像素拷入下一个空闲槽位并按门铃；槽位全部在途时先取回最早的结果（存入待取队列）。
+    // 帧超过槽位大小抛 std::invalid_argument
+    void Submit(const uint8_t* bgr, int width, int height, size_t stride, const json& options = json::object());
+    // 按提交顺序取回下一个结果
+    IpcReply Receive();
+    IpcReply Infer(const uint8_t* bgr, int width, int height, size_t stride, const json& options = json::object()) {
+        Submit(bgr, width, height, stride, options);
+        return Receive();
+    }
+
+private:
+    int fd_ = -1;
+    uint8_t* base_ = nullptr;
+    size_t mapped_bytes_ = 0;
+    uint32_t slots_ = 0;
+    uint64_t slot_bytes_ = 0;
+    uint32_t next_slot_ = 0;
+    std::deque<uint32_t> in_flight_;  // 已按门铃、结果未读的槽位（提交顺序）
+    std::deque<IpcReply> ready_;      // Submit 为腾槽位提前读到的结果
+
+    IpcReply ReadReply();
+};
+
+#endif // OCR_IPC_H
@@ -0,0 +1,438 @@
+#include "ocr_lexicon.h"
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <map>
+#include <stdexcept>
+
+namespace {
+
+constexpr uint32_t kInvalidCodepoint = 0xFFFFFFFF;
+
+std::vector<uint32_t> Codepoints(const std::string& s) {
+    std::vector<uint32_t> cps;
+    for (size_t pos = 0; pos < s.size();) cps.push_back(Utf8Next(s, pos));
+    return cps;
+}
+
+// ---- 正则：解析为 AST，再自后向前构造 Thompson NFA ----
+
+constexpr int kMaxRepeat = 64;        // {m,n} 上限，限制 NFA 规模
+constexpr size_t kMaxClasses = 64;    // 字符类数（等价组签名为 64 位）
+constexpr size_t kMaxDfaStates = 4096;
+
+struct CharClass {
+    std::vector<std::pair<uint32_t, uint32_t>> ranges;
+    bool negate = false;
+
+    bool Matches(uint32_t cp) const {
+        if (cp == kInvalidCodepoint) return false;
+        bool hit = false;
+        for (const auto& [lo, hi] : ranges) {
+            if (cp >= lo && cp <= hi) {
+                hit = true;
+                break;
+            }
+        }
+        return hit != negate;
+    }
+};
+
+struct AstNode {
+    enum Kind { kEmpty, kClass, kConcat, kAlt, kRepeat } kind = kEmpty;
+    int cls = -1;
+    std::vector<int> children;
+    int min = 0, max = 0;  // kRepeat；max = -1 为无上限
+};
+
+class PatternParser {
+public:
+    PatternParser(const std::string& pattern, std::vector<AstNode>& nodes, std::vector<CharClass>& classes)
+        : cps_(Codepoints(pattern)), nodes_(nodes), classes_(classes) {}
+
+    int Parse() {
+        int root = ParseAlt();
+        if (pos_ != cps_.size()) Fail("多余的 ')'");
+        return root;
+    }
+
+private:
+    std::vector<uint32_t> cps_;
+    size_t pos_ = 0;
+    std::vector<AstNode>& nodes_;
+    std::vector<CharClass>& classes_;
+
+    [[noreturn]] void Fail(const std::string& message) const {
+        throw std::invalid_argument("正则语法错误（位置 " + std::to_string(pos_) + "）: " + message);
+    }
+    bool AtEnd() const { return pos_ >= cps_.size(); }
+    uint32_t Peek() const { return cps_[pos_]; }
+
+    int Add(AstNode node) {
+        nodes_.push_back(std::move(node));
+        return static_cast<int>(nodes_.size()) - 1;
+    }
+    int AddClass(CharClass cls) {
+        if (classes_.size() >= kMaxClasses) Fail("字符类过多");
+        classes_.push_back(std::move(cls));
+        AstNode node;
+        node.kind = AstNode::kClass;
+        node.cls = static_cast<int>(classes_.size()) - 1;
+        return Add(std::move(node));
+    }
+
+    int ParseAlt() {
+        std::vector<int> branches{ParseConcat()};
+        while (!AtEnd() && Peek() == '|') {
+            ++pos_;
+            branches.push_back(ParseConcat());
+        }
+        if (branches.size() == 1) return branches[0];
+        AstNode node;
+        node.kind = AstNode::kAlt;
+        node.children = std::move(branches);
+        return Add(std::move(node));
+    }
+
+    int ParseConcat() {
+        std::vector<int> items;
+        while (!AtEnd() && Peek() != '|' && Peek() != ')') items.push_back(ParseRepeat());
+        if (items.empty()) return Add(AstNode{});
+        if (items.size() == 1) return items[0];
+        AstNode node;
+        node.kind = AstNode::kConcat;
+        node.children = std::move(items);
+        return Add(std::move(node));
+    }
+
+    int ParseNumber() {
+        if (AtEnd() || Peek() < '0' || Peek() > '9') Fail("{} 中缺少数字");
+        int value = 0;
+        while (!AtEnd() && Peek() >= '0' && Peek() <= '9') {
+            value = value * 10 + static_cast<int>(Peek() - '0');
+            if (value > kMaxRepeat) Fail("重复次数超过 " + std::to_string(kMaxRepeat));
+            ++pos_;
+        }
+        return value;
+    }
+
+    int ParseRepeat() {
+        int atom = ParseAtom();
+        while (!AtEnd()) {
+            int min = 0, max = 0;
+            uint32_t c = Peek();
+            if (c == '*') {
+                min = 0, max = -1;
+            } else if (c == '+') {
+                min = 1, max = -1;
+            } else if (c == '?') {
+                min = 0, max = 1;
+            } else if (c == '{') {
+                ++pos_;
+                min = max = ParseNumber();
+                if (!AtEnd() && Peek() == ',') {
+                    ++pos_;
+                    max = (!AtEnd() && Peek() == '}') ? -1 : ParseNumber();
+                }
+                if (AtEnd() || Peek() != '}') Fail("缺少 '}'");
+                if (max >= 0 && max < min) Fail("{m,n} 要求 m <= n");
+            } else {
+                break;
+            }
+            ++pos_;
+            AstNode node;
+            node.kind = AstNode::kRepeat;
+            node.children = {atom};
+            node.min = min;
+            node.max = max;
+            atom = Add(std::move(node));
+        }
+        return atom;
+    }
+
+    // \d \w \s 及其取反；其它转义为字面量
+    bool EscapeRanges(uint32_t c, CharClass& cls) {
+        switch (c) {
+            case 'd': case 'D':
+                cls.ranges.push_back({'0', '9'});
+                break;
+            case 'w': case 'W':
+                cls.ranges.insert(cls.ranges.end(), {{'0', '9'}, {'A', 'Z'}, {'a', 'z'}, {'_', '_'}});
+                break;
+            case 's': case 'S':
+                cls.ranges.insert(cls.ranges.end(), {{' ', ' '}, {'\t', '\t'}, {0x3000, 0x3000}});
+                break;
+            default:
+                return false;
+        }
+        return true;
+    }
+
+    uint32_t ClassChar() {
+        if (AtEnd()) Fail("缺少 ']'");
+        uint32_t c = cps_[pos_++];
+        if (c == '\\') {
+            if (AtEnd()) Fail("末尾的 '\\'");
+            c = cps_[pos_++];
+        }
+        return c;
+    }
+
+    int ParseAtom() {
+        uint32_t c = cps_[pos_++];
+        if (c == '(') {
+            int inner = ParseAlt();
+            if (AtEnd() || Peek() != ')') Fail("缺少 ')'");
+            ++pos_;
+            return inner;
+        }
+        if (c == '.') {
+            CharClass any;
+            any.negate = true;
+            return AddClass(std::move(any));
+        }
+        if (c == '[') {
+            CharClass cls;
+            if (!AtEnd() && Peek() == '^') {
+                cls.negate = true;
+                ++pos_;
+            }
+            bool first = true;
+            while (AtEnd() || Peek() != ']' || first) {
+                first = false;
+                if (!AtEnd() && Peek() == '\\' && pos_ + 1 < cps_.size()) {
+                    CharClass shorthand;
+                    if (EscapeRanges(cps_[pos_ + 1], shorthand)) {
+                        if (cps_[pos_ + 1] >= 'A' && cps_[pos_ + 1] <= 'Z') Fail("字符类内不支持 \\D \\W \\S");
+                        cls.ranges.insert(cls.ranges.end(), shorthand.ranges.begin(), shorthand.ranges.end());
+                        pos_ += 2;
+                        continue;
+                    }
+                }
+                uint32_t lo = ClassChar(), hi = lo;
+                if (pos_ + 1 < cps_.size() && Peek() == '-' && cps_[pos_ + 1] != ']') {
+                    ++pos_;
+                    hi = ClassChar();
+                    if (hi < lo) Fail("字符范围逆序");
+                }
+                cls.ranges.push_back({lo, hi});
+            }
+            ++pos_;  // ']'
+            return AddClass(std::move(cls));
+        }
+        if (c == '\\') {
+            if (AtEnd()) Fail("末尾的 '\\'");
+            uint32_t e = cps_[pos_++];
+            CharClass cls;
+            if (EscapeRanges(e, cls)) {
+                cls.negate = (e >= 'A' && e <= 'Z');
+                return AddClass(std::move(cls));
+            }
+            c = e;
+        } else if (c == '*' || c == '+' || c == '?' || c == '{' || c == ')' || c == '|') {
+            --pos_;
+            Fail("意外的元字符");
+        }
+        CharClass literal;
+        literal.ranges.push_back({c, c});
+        return AddClass(std::move(literal));
+    }
+};
+
+struct NfaState {
+    enum Kind { kChar, kSplit, kMatch } kind = kMatch;
+    int cls = -1;
+    int out = -1, out1 = -1;
+};
+
+class NfaBuilder {
+public:
+    explicit NfaBuilder(const std::vector<AstNode>& nodes) : nodes_(nodes) {
+        states_.push_back(NfaState{});  // 0 = 匹配态
+    }
+
+    // 构造匹配 node 后转到 next 的片段，返回入口状态
+    int Compile(int node, int next) {
+        const AstNode& n = nodes_[node];
+        switch (n.kind) {
+            case AstNode::kEmpty:
+                return next;
+            case AstNode::kClass:
+                return Add({NfaState::kChar, n.cls, next, -1});
+            case AstNode::kConcat:
+                for (auto it = n.children.rbegin(); it != n.children.rend(); ++it) next = Compile(*it, next);
+                return next;
+            case AstNode::kAlt: {
+                int start = Compile(n.children.back(), next);
+                for (auto it = n.children.rbegin() + 1; it != n.children.rend(); ++it) {
+                    int branch = Compile(*it, next);
+                    start = Add({NfaState::kSplit, -1, branch, start});
+                }
+                return start;
+            }
+            case AstNode::kRepeat: {
+                int child = n.children[0];
+                int tail = next;
+                if (n.max < 0) {
+                    int loop = Add({NfaState::kSplit, -1, -1, next});
+                    int body = Compile(child, loop);
+                    states_[loop].out = body;
+                    tail = loop;
+                } else {
+                    for (int i = n.min; i < n.max; ++i) {
+                        int body = Compile(child, tail);
+                        tail = Add({NfaState::kSplit, -1, body, next});
+                    }
+                }
+                for (int i = 0; i < n.min; ++i) tail = Compile(child, tail);
+                return tail;
+            }
+        }
+        return next;
+    }
+
+    std::vector<NfaState> Take() { return std::move(states_); }
+
+private:
+    const std::vector<AstNode>& nodes_;
+    std::vector<NfaState> states_;
+
+    int Add(NfaState state) {
+        if (states_.size() >= 65536) throw std::invalid_argument("正则过于复杂（NFA 状态超限）");
+        states_.push_back(state);
+        return static_cast<int>(states_.size()) - 1;
+    }
+};
+
+// ε 闭包：只保留字符态与匹配态，排序后作为 DFA 状态的键
+std::vector<int> Closure(const std::vector<NfaState>& nfa, std::vector<int> stack) {
+    std::vector<uint8_t> seen(nfa.size(), 0);
+    std::vector<int> result;
+    while (!stack.empty()) {
+        int s = stack.back();
+        stack.pop_back();
+        if (s < 0 || seen[s]) continue;
+        seen[s] = 1;
+        if (nfa[s].kind == NfaState::kSplit) {
+            stack.push_back(nfa[s].out);
+            stack.push_back(nfa[s].out1);
+        } else {
+            result.push_back(s);
+        }
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+}  // namespace
+
+LexiconTrie::LexiconTrie(const std::vector<std::string>& words, const CharDict& dict) {
+    // 先建 map 形式的前缀树，再按节点编号展平为 CSR
+    std::vector<std::map<int, int>> children(1);
+    std::vector<uint8_t> terminal(1, 0);
+    std::vector<int> labels;
+    for (const auto& word : words) {
+        labels.clear();
+        bool ok = !word.empty();
+        for (size_t pos = 0; ok && pos < word.size();) {
+            size_t begin = pos;
+            Utf8Next(word, pos);
+            int label = dict.Find(std::string_view(word).substr(begin, pos - begin));
+            if (label < 0) ok = false;
+            else labels.push_back(label);
+        }
+        if (!ok) {
+            ++skipped_words_;
+            continue;
+        }
+        int node = 0;
+        for (int label : labels) {
+            auto it = children[node].find(label);
+            if (it == children[node].end()) {
+                children.emplace_back();
+                terminal.push_back(0);
+                int child = static_cast<int>(children.size()) - 1;
+                children[node].emplace(label, child);
+                node = child;
+            } else {
+                node = it->second;
+            }
+        }
+        if (!terminal[node]) ++word_count_;
+        terminal[node] = 1;
+    }
+
+    edge_begin_.reserve(children.size() + 1);
+    edge_begin_.push_back(0);
+    for (const auto& edges : children) {
+        for (const auto& [label, child] : edges) {
+            edge_labels_.push_back(label);
+            edge_targets_.push_back(child);
+        }
+        edge_begin_.push_back(static_cast<uint32_t>(edge_labels_.size()));
+    }
+    terminal_ = std::move(terminal);
+    if (skipped_words_ > 0) spdlog::warn("词典约束: {} 个词含字典外字符，已跳过", skipped_words_);
+}
+
+int LexiconTrie::Next(int state, int label) const {
+    auto begin = edge_labels_.begin() + edge_begin_[state];
+    auto end = edge_labels_.begin() + edge_begin_[state + 1];
+    auto it = std::lower_bound(begin, end, label);
+    if (it == end || *it != label) return -1;
+    return edge_targets_[it - edge_labels_.begin()];
+}
+
+PatternConstraint::PatternConstraint(const std::string& pattern, const CharDict& dict)
+    : pattern_(pattern) {
+    std::vector<AstNode> nodes;
+    std::vector<CharClass> classes;
+    int root = PatternParser(pattern, nodes, classes).Parse();
+    NfaBuilder builder(nodes);
+    int start = builder.Compile(root, 0);
+    std::vector<NfaState> nfa = builder.Take();
+
+    // 字母表等价组：签名 = 命中的字符类位图；多码点的字典项不匹配任何字符类
+    std::map<uint64_t, uint16_t> group_ids;
+    std::vector<uint64_t> group_signature;
+    group_of_.resize(dict.Size());
+    for (size_t label = 0; label < dict.Size(); ++label) {
+        std::string_view ch = dict.Char(label);
+        size_t pos = 0;
+        uint32_t cp = ch.empty() ? kInvalidCodepoint : Utf8Next(ch, pos);
+        if (pos != ch.size()) cp = kInvalidCodepoint;
+        uint64_t signature = 0;
+        for (size_t c = 0; c < classes.size(); ++c) {
+            if (classes[c].Matches(cp)) signature |= uint64_t{1} << c;
+        }
+        auto [it, inserted] = group_ids.emplace(signature, static_cast<uint16_t>(group_signature.size()));
+        if (inserted) group_signature.push_back(signature);
+        group_of_[label] = it->second;
+    }
+    group_count_ = group_signature.size();
+
+    // 子集构造
+    std::map<std::vector<int>, int> dfa_ids;
+    std::vector<std::vector<int>> dfa_states;
+    auto intern = [&](std::vector<int> set) {
+        if (set.empty()) return -1;
+        auto [it, inserted] = dfa_ids.emplace(set, static_cast<int>(dfa_states.size()));
+        if (inserted) {
+            if (dfa_states.size() >= kMaxDfaStates) throw std::invalid_argument("正则过于复杂（DFA 状态超限）: " + pattern);
+            dfa_states.push_back(std::move(set));
+        }
+        return it->second;
+    };
+    intern(Closure(nfa, {start}));
+    if (dfa_states.empty()) throw std::invalid_argument("正则无法匹配任何字符串: " + pattern);
+    for (size_t d = 0; d < dfa_states.size(); ++d) {
+        accept_.push_back(std::binary_search(dfa_states[d].begin(), dfa_states[d].end(), 0) ? 1 : 0);
+        for (size_t g = 0; g < group_count_; ++g) {
+            std::vector<int> moved;
+            for (int s : dfa_states[d]) {
+                const NfaState& state = nfa[s];
+                if (state.kind == NfaState::kChar && (group_signature[g] >> state.cls & 1)) moved.push_back(state.out);
+            }
+            transitions_.push_back(moved.empty() ? -1 : intern(Closure(nfa, std::move(moved))));
+        }
+    }
+}
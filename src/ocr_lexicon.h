@@ -0,0 +1,68 @@
+#ifndef OCR_LEXICON_H
+#define OCR_LEXICON_H
+
+#include "ocr_char_dict.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// 束搜索解码的约束：在识别字典的标签（dict 下标，0 起；对应 CTC 类别 label + 1）上的确定性自动机。
+// 实现为不可变对象，构造后可在多个请求 / 线程间共享
+class DecodeConstraint {
+public:
+    virtual ~DecodeConstraint() = default;
+    virtual int Start() const = 0;
+    // 接收字符 label 后的状态；-1 表示该前缀不可能满足约束
+    virtual int Next(int state, int label) const = 0;
+    // 状态是否为完整匹配（解码结束时只接受此类前缀）
+    virtual bool Accepts(int state) const = 0;
+};
+
+// 词典约束：词表按字典字符切分后存为紧凑前缀树（CSR：每节点一段按标签排序的出边，二分查找）。
+// 含字典外字符的词无法被识别出来，构造时跳过并计数
+class LexiconTrie : public DecodeConstraint {
+public:
+    LexiconTrie(const std::vector<std::string>& words, const CharDict& dict);
+
+    int Start() const override { return 0; }
+    int Next(int state, int label) const override;
+    bool Accepts(int state) const override { return terminal_[state] != 0; }
+
+    size_t WordCount() const { return word_count_; }
+    size_t SkippedWords() const { return skipped_words_; }
+    size_t NodeCount() const { return terminal_.size(); }
+
+private:
+    std::vector<uint32_t> edge_begin_;  // 节点 i 的出边位于 [edge_begin_[i], edge_begin_[i+1])
+    std::vector<int> edge_labels_;
+    std::vector<int> edge_targets_;
+    std::vector<uint8_t> terminal_;
+    size_t word_count_ = 0;
+    size_t skipped_words_ = 0;
+};
+
+// 正则约束（整串匹配）：支持字面量、.、[...] / [^...] 字符类、\d \w \s（及大写取反）、( )、|、* + ? {m} {m,} {m,n}。
+// 构造时编译为 NFA，再在字典字母表上做子集构造得到 DFA；字母表先按“命中哪些字符类”划分为等价组，
+// 转移表为 状态 × 组 的稠密表。语法错误或过于复杂（状态数超限）抛 std::invalid_argument
+class PatternConstraint : public DecodeConstraint {
+public:
+    PatternConstraint(const std::string& pattern, const CharDict& dict);
+
+    int Start() const override { return 0; }
+    int Next(int state, int label) const override {
+        return transitions_[static_cast<size_t>(state) * group_count_ + group_of_[label]];
+    }
+    bool Accepts(int state) const override { return accept_[state] != 0; }
+
+    const std::string& Pattern() const { return pattern_; }
+    size_t StateCount() const { return accept_.size(); }
+
+private:
+    std::string pattern_;
+    std::vector<uint16_t> group_of_;  // 字典标签 → 等价组
+    size_t group_count_ = 0;
+    std::vector<int> transitions_;    // [state * group_count_ + group]
+    std::vector<uint8_t> accept_;
+};
+
+#endif // OCR_LEXICON_H
@@ -0,0 +1,205 @@
+#include "ocr_metrics.h"
+#include <algorithm>
+#include <array>
+#include <cstdio>
+
+namespace {
+
+// 线程首次计数时轮转分配分片
+size_t ThreadShard(size_t shards) {
+    static std::atomic<size_t> next{0};
+    thread_local size_t shard = next.fetch_add(1, std::memory_order_relaxed);
+    return shard % shards;
+}
+
+std::string FormatValue(double value) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%.10g", value);
+    return buf;
+}
+
+std::string JoinLabels(const std::string& labels, const std::string& extra) {
+    if (labels.empty()) return extra;
+    if (extra.empty()) return labels;
+    return labels + "," + extra;
+}
+
+std::string Braced(const std::string& labels) {
+    return labels.empty() ? "" : "{" + labels + "}";
+}
+
+}  // namespace
+
+void Counter::Inc(uint64_t n) {
+    shards_[ThreadShard(kShards)].value.fetch_add(n, std::memory_order_relaxed);
+}
+
+uint64_t Counter::Value() const {
+    uint64_t total = 0;
+    for (const auto& shard : shards_) total += shard.value.load(std::memory_order_relaxed);
+    return total;
+}
+
+void Counter::Reset() {
+    for (auto& shard : shards_) shard.value.store(0, std::memory_order_relaxed);
+}
+
+Histogram::Histogram(std::vector<double> bounds)
+    : bounds_(std::move(bounds)), counts_(new std::atomic<uint64_t>[bounds_.size() + 1]) {
+    std::sort(bounds_.begin(), bounds_.end());
+    Reset();
+}
+
+std::vector<double> Histogram::LatencyBounds() {
+    return {0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10};
+}
+
+void Histogram::Observe(double value) {
+    size_t idx = std::lower_bound(bounds_.begin(), bounds_.end(), value) - bounds_.begin();
+    counts_[idx].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    double sum = sum_.load(std::memory_order_relaxed);
+    while (!sum_.compare_exchange_weak(sum, sum + value, std::memory_order_relaxed)) {
+    }
+}
+
+void Histogram::Reset() {
+    for (size_t i = 0; i <= bounds_.size(); ++i) counts_[i].store(0, std::memory_order_relaxed);
+    count_.store(0, std::memory_order_relaxed);
+    sum_.store(0.0, std::memory_order_relaxed);
+}
+
+double Histogram::Quantile(double q) const {
+    uint64_t total = Count();
+    if (total == 0) return 0.0;
+    double rank = q * total;
+    uint64_t seen = 0;
+    for (size_t i = 0; i <= bounds_.size(); ++i) {
+        uint64_t c = counts_[i].load(std::memory_order_relaxed);
+        if (c > 0 && seen + c >= rank) {
+            double lower = (i == 0) ? 0.0 : bounds_[i - 1];
+            if (i == bounds_.size()) return lower;  // +Inf 桶无上界
+            return lower + (bounds_[i] - lower) * (rank - seen) / c;
+        }
+        seen += c;
+    }
+    return bounds_.empty() ? 0.0 : bounds_.back();
+}
+
+json Histogram::ToJson() const {
+    json buckets = json::array();
+    for (size_t i = 0; i <= bounds_.size(); ++i) {
+        json le = (i < bounds_.size()) ? json(bounds_[i]) : json("+Inf");
+        buckets.push_back({{"le", le}, {"count", counts_[i].load(std::memory_order_relaxed)}});
+    }
+    return {
+        {"count", Count()},
+        {"sum", Sum()},
+        {"p50", Quantile(0.5)},
+        {"p90", Quantile(0.9)},
+        {"p99", Quantile(0.99)},
+        {"buckets", buckets}
+    };
+}
+
+void Histogram::AppendPrometheus(std::string& out, const std::string& name, const std::string& labels) const {
+    uint64_t cumulative = 0;
+    for (size_t i = 0; i <= bounds_.size(); ++i) {
+        cumulative += counts_[i].load(std::memory_order_relaxed);
+        std::string le = (i < bounds_.size()) ? FormatValue(bounds_[i]) : "+Inf";
+        out += name + "_bucket" + Braced(JoinLabels(labels, "le=\"" + le + "\"")) + " " + std::to_string(cumulative) + "\n";
+    }
+    out += name + "_sum" + Braced(labels) + " " + FormatValue(Sum()) + "\n";
+    out += name + "_count" + Braced(labels) + " " + std::to_string(cumulative) + "\n";
+}
+
+MetricsRegistry& MetricsRegistry::Instance() {
+    static MetricsRegistry registry;
+    return registry;
+}
+
+Counter& MetricsRegistry::GetCounter(const std::string& name, const std::string& help, const std::string& labels) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Family& family = families_[name];
+    family.help = help;
+    family.type = "counter";
+    auto& series = family.counters[labels];
+    if (!series) series = std::make_unique<Counter>();
+    return *series;
+}
+
+Histogram& MetricsRegistry::GetHistogram(const std::string& name, const std::string& help,
+                                         const std::vector<double>& bounds, const std::string& labels) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Family& family = families_[name];
+    family.help = help;
+    family.type = "histogram";
+    auto& series = family.histograms[labels];
+    if (!series) series = std::make_unique<Histogram>(bounds);
+    return *series;
+}
+
+std::string MetricsRegistry::RenderPrometheus() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::string out;
+    for (const auto& [name, family] : families_) {
+        out += "# HELP " + name + " " + family.help + "\n";
+        out += "# TYPE " + name + " " + family.type + "\n";
+        for (const auto& [labels, counter] : family.counters) {
+            out += name + Braced(labels) + " " + std::to_string(counter->Value()) + "\n";
+        }
+        for (const auto& [labels, histogram] : family.histograms) {
+            histogram->AppendPrometheus(out, name, labels);
+        }
+    }
+    return out;
+}
+
+json MetricsRegistry::Snapshot() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    json snapshot = json::object();
+    for (const auto& [name, family] : families_) {
+        json series = json::object();
+        for (const auto& [labels, counter] : family.counters) series[labels] = counter->Value();
+        for (const auto& [labels, histogram] : family.histograms) series[labels] = histogram->ToJson();
+        snapshot[name] = series;
+    }
+    return snapshot;
+}
+
+void MetricsRegistry::Reset() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& [name, family] : families_) {
+        for (auto& [labels, counter] : family.counters) counter->Reset();
+        for (auto& [labels, histogram] : family.histograms) histogram->Reset();
+    }
+}
+
+const char* StageName(Stage stage) {
+    switch (stage) {
+        case Stage::kDecode: return "decode";
+        case Stage::kDetPreprocess: return "det_preprocess";
+        case Stage::kDetInference: return "det_inference";
+        case Stage::kDetPostprocess: return "det_postprocess";
+        case Stage::kCrop: return "crop";
+        case Stage::kRecPreprocess: return "rec_preprocess";
+        case Stage::kRecInference: return "rec_inference";
+        case Stage::kCtcDecode: return "ctc_decode";
+        case Stage::kSerialize: return "serialize";
+        default: return "unknown";
+    }
+}
+
+Histogram& StageHistogram(Stage stage) {
+    // 首次调用时一次性注册全部阶段，之后无锁访问
+    static const std::array<Histogram*, static_cast<size_t>(Stage::kCount)> histograms = [] {
+        std::array<Histogram*, static_cast<size_t>(Stage::kCount)> result{};
+        for (size_t i = 0; i < result.size(); ++i) {
+            std::string labels = std::string("stage=\"") + StageName(static_cast<Stage>(i)) + "\"";
+            result[i] = &MetricsRegistry::Instance().GetHistogram(
+                "ocr_stage_duration_seconds", "Per-stage latency of the OCR pipeline", Histogram::LatencyBounds(), labels);
+        }
+        return result;
+    }();
+    return *histograms[static_cast<size_t>(stage)];
+}
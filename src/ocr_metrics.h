@@ -0,0 +1,117 @@
+#ifndef OCR_METRICS_H
+#define OCR_METRICS_H
+
+#include "ocr_trace.h"
+#include <json.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using json = nlohmann::json;
+
+// 分片计数器：各线程落在不同缓存行上累加，热路径无锁、无争用
+class Counter {
+public:
+    void Inc(uint64_t n = 1);
+    uint64_t Value() const;
+    void Reset();
+
+private:
+    static constexpr size_t kShards = 16;
+    struct alignas(64) Shard {
+        std::atomic<uint64_t> value{0};
+    };
+    Shard shards_[kShards];
+};
+
+// 固定桶直方图（无锁，原子计数）
+class Histogram {
+public:
+    explicit Histogram(std::vector<double> bounds);
+
+    void Observe(double value);
+    uint64_t Count() const { return count_.load(std::memory_order_relaxed); }
+    double Sum() const { return sum_.load(std::memory_order_relaxed); }
+    // 桶内线性插值估算分位数
+    double Quantile(double q) const;
+    void Reset();
+
+    json ToJson() const;
+    // Prometheus 文本格式：name_bucket{labels,le=...} / name_sum / name_count
+    void AppendPrometheus(std::string& out, const std::string& name, const std::string& labels) const;
+
+    static std::vector<double> LatencyBounds();  // 秒：0.5ms ~ 10s
+
+private:
+    std::vector<double> bounds_;  // 各桶上界（升序），最后一个隐含 +Inf
+    std::unique_ptr<std::atomic<uint64_t>[]> counts_;
+    std::atomic<uint64_t> count_{0};
+    std::atomic<double> sum_{0.0};
+};
+
+// 全局指标注册表：注册时加锁（启动期），之后按引用直接更新
+class MetricsRegistry {
+public:
+    static MetricsRegistry& Instance();
+
+    // labels 为预格式化的 Prometheus 标签，如 stage="decode"
+    Counter& GetCounter(const std::string& name, const std::string& help, const std::string& labels = "");
+    Histogram& GetHistogram(const std::string& name, const std::string& help, const std::vector<double>& bounds,
+                            const std::string& labels = "");
+
+    std::string RenderPrometheus() const;
+    json Snapshot() const;
+    void Reset();  // 清零所有指标（基准测试分段统计用）
+
+private:
+    struct Family {
+        std::string help;
+        std::string type;  // counter / histogram
+        std::map<std::string, std::unique_ptr<Counter>> counters;      // labels → series
+        std::map<std::string, std::unique_ptr<Histogram>> histograms;
+    };
+    mutable std::mutex mutex_;
+    std::map<std::string, Family> families_;
+};
+
+// 流水线阶段耗时：ocr_stage_duration_seconds{stage="..."}
+enum class Stage {
+    kDecode,
+    kDetPreprocess,
+    kDetInference,
+    kDetPostprocess,
+    kCrop,
+    kRecPreprocess,
+    kRecInference,
+    kCtcDecode,
+    kSerialize,
+    kCount
+};
+
+const char* StageName(Stage stage);
+Histogram& StageHistogram(Stage stage);
+
+// RAII：作用域结束时记录阶段耗时；请求被追踪时同时记为同名 span
+class ScopedStageTimer {
+public:
+    explicit ScopedStageTimer(Stage stage)
+        : stage_(stage), start_(std::chrono::steady_clock::now()), span_(StageName(stage)) {}
+    ~ScopedStageTimer() {
+        StageHistogram(stage_).Observe(std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count());
+    }
+    ScopedStageTimer(const ScopedStageTimer&) = delete;
+    ScopedStageTimer& operator=(const ScopedStageTimer&) = delete;
+
+private:
+    Stage stage_;
+    std::chrono::steady_clock::time_point start_;
+    ScopedSpan span_;
+};
+
+#endif // OCR_METRICS_H
@@ -0,0 +1,182 @@
+#include "ocr_model_loader.h"
+#include <spdlog/spdlog.h>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedModel::MappedModel(const std::string& path) : path_(path) {
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) throw std::runtime_error("模型文件无法打开: " + path);
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+        CloseHandle(file);
+        throw std::runtime_error("模型文件为空或无法读取大小: " + path);
+    }
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    void* data = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (!data) {
+        if (mapping) CloseHandle(mapping);
+        CloseHandle(file);
+        throw std::runtime_error("模型文件映射失败: " + path);
+    }
+    file_ = file;
+    mapping_ = mapping;
+    data_ = data;
+    size_ = static_cast<size_t>(file_size.QuadPart);
+#else
+    fd_ = open(path.c_str(), O_RDONLY);
+    if (fd_ < 0) throw std::runtime_error("模型文件无法打开: " + path);
+    struct stat st;
+    if (fstat(fd_, &st) != 0 || st.st_size == 0) {
+        close(fd_);
+        throw std::runtime_error("模型文件为空或无法读取大小: " + path);
+    }
+    size_ = static_cast<size_t>(st.st_size);
+    data_ = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd_, 0);
+    if (data_ == MAP_FAILED) {
+        close(fd_);
+        throw std::runtime_error("模型文件映射失败: " + path);
+    }
+#endif
+}
+
+MappedModel::~MappedModel() {
+#ifdef _WIN32
+    UnmapViewOfFile(data_);
+    CloseHandle(static_cast<HANDLE>(mapping_));
+    CloseHandle(static_cast<HANDLE>(file_));
+#else
+    munmap(data_, size_);
+    close(fd_);
+#endif
+}
+
+size_t ProcessRssBytes() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return counters.WorkingSetSize;
+    return 0;
+#elif defined(__linux__)
+    std::ifstream statm("/proc/self/statm");
+    size_t total_pages = 0, resident_pages = 0;
+    if (!(statm >> total_pages >> resident_pages)) return 0;
+    return resident_pages * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#else
+    return 0;
+#endif
+}
+
+ModelLoader& ModelLoader::Instance() {
+    static ModelLoader loader;
+    return loader;
+}
+
+Ort::Env& ModelLoader::Env(const json& loading) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (env_) return *env_;
+    shared_thread_pool_ = loading.value("shared_thread_pool", true);
+    intra_op_threads_ = loading.value("intra_op_threads", 4);
+    if (shared_thread_pool_) {
+        Ort::ThreadingOptions threading;
+        threading.SetGlobalIntraOpNumThreads(intra_op_threads_);
+        threading.SetGlobalInterOpNumThreads(1);
+        env_ = std::make_unique<Ort::Env>(threading, ORT_LOGGING_LEVEL_WARNING, "ocr");
+    } else {
+        env_ = std::make_unique<Ort::Env>(ORT_LOGGING_LEVEL_WARNING, "ocr");
+    }
+    spdlog::info("ORT 环境: {} ({} 线程)", shared_thread_pool_ ? "进程级共享线程池" : "每 session 独立线程池",
+                 intra_op_threads_);
+    return *env_;
+}
+
+// 以 路径 + 大小 + 修改时间 为键：热重载前替换了同名模型文件时不会复用旧映射
+std::shared_ptr<const MappedModel> ModelLoader::Map(const std::string& path) {
+    std::string key = path + "|" + std::to_string(std::filesystem::file_size(path)) + "|" +
+                      std::to_string(std::filesystem::last_write_time(path).time_since_epoch().count());
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (auto existing = mappings_[key].lock()) return existing;
+    auto mapping = std::make_shared<const MappedModel>(path);
+    mappings_[key] = mapping;
+    return mapping;
+}
+
+// 模型字节来自内存时 ORT 无法解析相对路径的 external data；PP-OCR 导出的模型均为单文件
+ModelLoader::Loaded ModelLoader::Load(const Ort::Env& env, const std::string& path, Ort::SessionOptions& options,
+                                      const json& loading) {
+    auto start = std::chrono::steady_clock::now();
+    size_t rss_before = ProcessRssBytes();
+    bool use_mmap = loading.value("mmap", true);
+    bool share_prepacked = loading.value("share_prepacked_weights", true);
+    bool is_ort_format = path.size() > 4 && path.compare(path.size() - 4, 4, ".ort") == 0;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (shared_thread_pool_) {
+            options.DisablePerSessionThreads();
+        } else {
+            options.SetIntraOpNumThreads(intra_op_threads_);
+        }
+    }
+
+    Loaded loaded;
+    if (use_mmap) {
+        std::shared_ptr<const MappedModel> mapping = Map(path);
+        // .ort 格式可直接引用映射内存（映射须与 session 同寿命）；ONNX 格式在创建 session 时解析完毕，随即解除映射
+        bool bytes_directly = is_ort_format && loading.value("use_model_bytes_directly", true);
+        if (bytes_directly) {
+            options.AddConfigEntry("session.use_ort_model_bytes_directly", "1");
+            if (loading.value("use_model_bytes_for_initializers", false)) {
+                options.AddConfigEntry("session.use_ort_model_bytes_for_initializers", "1");
+            }
+            loaded.mapping = mapping;
+        }
+        if (share_prepacked) {
+            loaded.session = Ort::Session(env, mapping->Data(), mapping->Size(), options, prepacked_);
+        } else {
+            loaded.session = Ort::Session(env, mapping->Data(), mapping->Size(), options);
+        }
+        loaded.info["mapped_bytes"] = mapping->Size();
+    } else if (share_prepacked) {
+        loaded.session = Ort::Session(env, std::filesystem::path(path).c_str(), options, prepacked_);
+    } else {
+        loaded.session = Ort::Session(env, std::filesystem::path(path).c_str(), options);
+    }
+
+    size_t rss_after = ProcessRssBytes();
+    loaded.info["path"] = path;
+    loaded.info["mmap"] = use_mmap;
+    loaded.info["bytes_referenced"] = loaded.mapping != nullptr;  // session 直接引用映射内存（.ort）
+    loaded.info["prepacked_shared"] = share_prepacked;
+    loaded.info["rss_delta_bytes"] = rss_after > rss_before ? rss_after - rss_before : 0;  // 本次加载新增的常驻内存（近似）
+    loaded.info["load_ms"] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    spdlog::info("模型加载: {} (mmap: {}, 共享预打包权重: {}, RSS +{:.1f} MB)", path, use_mmap, share_prepacked,
+                 loaded.info["rss_delta_bytes"].get<size_t>() / 1048576.0);
+    return loaded;
+}
+
+json ModelLoader::Stats() const {
+    json mapped = json::array();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto& [path, weak] : mappings_) {
+            if (auto mapping = weak.lock()) mapped.push_back({{"path", path}, {"bytes", mapping->Size()}});
+        }
+    }
+    return {{"process_rss_bytes", ProcessRssBytes()}, {"mapped", mapped}};
+}
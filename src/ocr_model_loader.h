@@ -0,0 +1,79 @@
+#ifndef OCR_MODEL_LOADER_H
+#define OCR_MODEL_LOADER_H
+
+#include <onnxruntime_cxx_api.h>
+#include <json.hpp>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+using json = nlohmann::json;
+
+// 只读内存映射的模型文件。同一主机上多个 ocr_server 进程映射同一文件时共享页缓存，
+// 不再各自把整个 ONNX 读进堆
+class MappedModel {
+public:
+    explicit MappedModel(const std::string& path);
+    ~MappedModel();
+    MappedModel(const MappedModel&) = delete;
+    MappedModel& operator=(const MappedModel&) = delete;
+
+    const void* Data() const { return data_; }
+    size_t Size() const { return size_; }
+    const std::string& Path() const { return path_; }
+
+private:
+    std::string path_;
+    void* data_ = nullptr;
+    size_t size_ = 0;
+#ifdef _WIN32
+    void* file_ = nullptr;     // HANDLE
+    void* mapping_ = nullptr;  // HANDLE
+#else
+    int fd_ = -1;
+#endif
+};
+
+// 当前进程常驻内存（RSS / Working Set），字节；不支持的平台返回 0
+size_t ProcessRssBytes();
+
+// 模型加载（model.loading）：
+//   mmap：从内存映射创建 session，不再把整个文件读入堆
+//   use_model_bytes_directly / use_model_bytes_for_initializers：仅 .ort 格式，session 直接引用映射内存，
+//     初始化器不再复制，多进程共享同一份页缓存（映射与 session 同寿命；替换模型文件须用重命名而非原地覆写）
+//   share_prepacked_weights：同一进程内同一模型的多个 session（热重载、多语言 rec）
+//     共享预打包权重（PrepackedWeightsContainer），额外 session 的权重内存接近零
+//   shared_thread_pool / intra_op_threads：所有 session 共用进程级 ORT 线程池（多语言模型不额外起线程）
+class ModelLoader {
+public:
+    static ModelLoader& Instance();
+
+    // 进程级 Env，首次调用时按 loading 创建（之后的配置变更需重启生效）
+    Ort::Env& Env(const json& loading);
+
+    struct Loaded {
+        Ort::Session session{nullptr};
+        std::shared_ptr<const MappedModel> mapping;  // 非空时须比 session 活得久
+        json info;  // path / mmap / mapped_bytes / bytes_referenced / prepacked_shared / rss_delta_bytes / load_ms
+    };
+
+    Loaded Load(const Ort::Env& env, const std::string& path, Ort::SessionOptions& options, const json& loading);
+
+    // 已映射文件与进程 RSS
+    json Stats() const;
+
+private:
+    ModelLoader() = default;
+    std::shared_ptr<const MappedModel> Map(const std::string& path);
+
+    mutable std::mutex mutex_;
+    std::unique_ptr<Ort::Env> env_;
+    bool shared_thread_pool_ = false;
+    int intra_op_threads_ = 4;  // 未共享线程池时为每个 session 的线程数
+    std::map<std::string, std::weak_ptr<const MappedModel>> mappings_;  // 同一文件只映射一次
+    Ort::PrepackedWeightsContainer prepacked_;  // 进程内所有 session 共享
+};
+
+#endif // OCR_MODEL_LOADER_H
@@ -0,0 +1,160 @@
+#ifndef OCR_MODEL_REGISTRY_H
+#define OCR_MODEL_REGISTRY_H
+
+#include <spdlog/spdlog.h>
+#include <json.hpp>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using json = nlohmann::json;
+
+// 具名模型注册表：按名称注册配置，首次 Get 时才加载（启动不为没人用的语言付费）。
+// 非常驻（pinned = false）的模型按 LRU 保留至多 max_resident 个，淘汰时只释放注册表的引用，
+// 正在使用的请求持有 shared_ptr，用完即释放
+template <typename Model>
+class ModelRegistry {
+public:
+    using Factory = std::function<std::shared_ptr<Model>(const json& config)>;
+
+    ModelRegistry(std::string kind, Factory factory, size_t max_resident)
+        : kind_(std::move(kind)), factory_(std::move(factory)), max_resident_(max_resident) {}
+
+    // pinned：常驻（默认语言），不计入 LRU 上限
+    void Register(const std::string& name, json config, bool pinned = false) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Entry& entry = entries_[name];
+        entry.config = std::move(config);
+        entry.pinned = pinned;
+    }
+
+    bool Contains(const std::string& name) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return entries_.count(name) > 0;
+    }
+
+    std::vector<std::string> Names() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::vector<std::string> names;
+        for (const auto& [name, entry] : entries_) names.push_back(name);
+        return names;
+    }
+
+    // 未注册抛 std::invalid_argument。已加载的模型只短暂持锁；加载在锁外进行，不阻塞其他模型的请求，
+    // 同名并发请求等待同一次加载（只加载一次），加载失败时等待者收到同一异常
+    std::shared_ptr<Model> Get(const std::string& name) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        auto it = entries_.find(name);
+        if (it == entries_.end()) throw std::invalid_argument("未知" + kind_ + ": " + name);
+        Entry& entry = it->second;
+        ++entry.requests;
+        if (entry.model) {
+            Touch(name, entry);
+            return entry.model;
+        }
+        if (entry.loading.valid()) {
+            auto loading = entry.loading;
+            lock.unlock();
+            return loading.get();
+        }
+        std::promise<std::shared_ptr<Model>> promise;
+        entry.loading = promise.get_future().share();
+        json config = entry.config;
+        lock.unlock();
+
+        auto start = std::chrono::steady_clock::now();
+        std::shared_ptr<Model> model;
+        try {
+            model = factory_(config);
+        } catch (...) {
+            lock.lock();
+            entries_[name].loading = {};
+            lock.unlock();
+            promise.set_exception(std::current_exception());
+            throw;
+        }
+        double load_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        lock.lock();
+        Entry& loaded = entries_[name];
+        loaded.model = model;
+        loaded.loading = {};
+        loaded.load_ms = load_ms;
+        ++loaded.loads;
+        spdlog::info("{} {} 已加载 ({:.0f} ms, 第 {} 次)", kind_, name, loaded.load_ms, loaded.loads);
+        Touch(name, loaded);
+        lock.unlock();
+        promise.set_value(model);
+        return model;
+    }
+
+    json Status() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        json status = {{"max_resident", max_resident_}, {"models", json::object()}};
+        for (const auto& [name, entry] : entries_) {
+            status["models"][name] = {
+                {"resident", entry.model != nullptr},
+                {"pinned", entry.pinned},
+                {"requests", entry.requests},
+                {"loads", entry.loads},
+                {"load_ms", entry.load_ms}
+            };
+        }
+        return status;
+    }
+
+    // 对已加载的模型执行 fn(name, model)（不触发加载）
+    void ForEachResident(const std::function<void(const std::string&, Model&)>& fn) const {
+        std::vector<std::pair<std::string, std::shared_ptr<Model>>> resident;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (const auto& [name, entry] : entries_) {
+                if (entry.model) resident.emplace_back(name, entry.model);
+            }
+        }
+        for (const auto& [name, model] : resident) fn(name, *model);
+    }
+
+private:
+    struct Entry {
+        json config;
+        std::shared_ptr<Model> model;
+        std::shared_future<std::shared_ptr<Model>> loading;  // 加载进行中（锁外），同名请求等待
+        bool pinned = false;
+        uint64_t requests = 0;
+        uint64_t loads = 0;  // 被淘汰后再次使用会重新加载
+        double load_ms = 0.0;
+    };
+
+    // 持 mutex_ 调用：非常驻模型移到 LRU 最前并按上限淘汰
+    void Touch(const std::string& name, const Entry& entry) {
+        if (entry.pinned) return;
+        lru_.remove(name);
+        lru_.push_front(name);
+        Evict();
+    }
+
+    void Evict() {
+        while (lru_.size() > max_resident_) {
+            const std::string victim = lru_.back();
+            lru_.pop_back();
+            entries_[victim].model.reset();
+            spdlog::info("{} {} 已从内存淘汰（LRU 上限 {}）", kind_, victim, max_resident_);
+        }
+    }
+
+    std::string kind_;
+    Factory factory_;
+    size_t max_resident_;
+    mutable std::mutex mutex_;
+    std::map<std::string, Entry> entries_;
+    std::list<std::string> lru_;  // 非常驻模型，最近使用在前
+};
+
+#endif // OCR_MODEL_REGISTRY_H
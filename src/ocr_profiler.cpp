@@ -0,0 +1,168 @@
+#include "ocr_profiler.h"
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <set>
+#include <stdexcept>
+#include <vector>
+
+json AggregateOrtProfile(const json& trace, int top_nodes) {
+    struct OpStats {
+        std::set<std::string> nodes;
+        uint64_t calls = 0;
+        double total_us = 0.0;
+    };
+    std::map<std::string, OpStats> op_types;
+    std::map<std::string, std::pair<std::string, double>> node_totals;  // 节点名 → (算子类型, 耗时)
+    uint64_t runs = 0;
+    double run_total_us = 0.0, kernel_total_us = 0.0;
+
+    for (const auto& event : trace) {
+        if (!event.is_object() || !event.contains("dur")) continue;
+        std::string cat = event.value("cat", "");
+        std::string name = event.value("name", "");
+        double dur = event["dur"].get<double>();
+        if (cat == "Session" && name == "model_run") {
+            ++runs;
+            run_total_us += dur;
+            continue;
+        }
+        // 每个节点有 _fence_before / _kernel_time / _fence_after 三条，只统计 kernel
+        const std::string suffix = "_kernel_time";
+        if (cat != "Node" || name.size() <= suffix.size() ||
+            name.compare(name.size() - suffix.size(), suffix.size(), suffix) != 0) {
+            continue;
+        }
+        std::string node = name.substr(0, name.size() - suffix.size());
+        std::string op = event.contains("args") ? event["args"].value("op_name", "unknown") : "unknown";
+        auto& stats = op_types[op];
+        stats.nodes.insert(node);
+        ++stats.calls;
+        stats.total_us += dur;
+        kernel_total_us += dur;
+        auto& total = node_totals[node];
+        total.first = op;
+        total.second += dur;
+    }
+
+    json ops = json::array();
+    for (const auto& [op, stats] : op_types) {
+        ops.push_back({
+            {"op_type", op},
+            {"nodes", stats.nodes.size()},
+            {"calls", stats.calls},
+            {"total_us", stats.total_us},
+            {"avg_us_per_run", runs ? stats.total_us / runs : stats.total_us},
+            {"percent", kernel_total_us > 0 ? 100.0 * stats.total_us / kernel_total_us : 0.0}
+        });
+    }
+    std::sort(ops.begin(), ops.end(), [](const json& a, const json& b) {
+        return a["total_us"].get<double>() > b["total_us"].get<double>();
+    });
+
+    std::vector<std::pair<std::string, std::pair<std::string, double>>> nodes(node_totals.begin(), node_totals.end());
+    std::sort(nodes.begin(), nodes.end(), [](const auto& a, const auto& b) { return a.second.second > b.second.second; });
+    if (nodes.size() > static_cast<size_t>(top_nodes)) nodes.resize(top_nodes);
+    json top = json::array();
+    for (const auto& [node, info] : nodes) {
+        top.push_back({{"name", node}, {"op_type", info.first}, {"total_us", info.second}});
+    }
+
+    return {
+        {"runs", runs},
+        {"model_run_us", {{"total", run_total_us}, {"avg", runs ? run_total_us / runs : 0.0}}},
+        {"kernel_us_total", kernel_total_us},
+        {"op_types", ops},
+        {"top_nodes", top}
+    };
+}
+
+void OrtProfiler::Arm(Ort::Env& env, const Ort::SessionOptions& base_options, const std::string& model_path,
+                      int runs, const std::string& output_dir) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (runs <= 0) {
+            if (session_) {
+                remaining_ = 0;
+                if (in_flight_ == 0) Finish();
+                spdlog::info("{} 剖析已取消", tag_);
+            }
+            return;
+        }
+        if (arming_) throw std::logic_error(tag_ + " 剖析正在开启");
+        if (session_) throw std::logic_error(tag_ + " 剖析进行中（剩余 " + std::to_string(remaining_) + " 次）");
+        arming_ = true;
+    }
+
+    // 影子 session 在锁外创建（加载模型可能需要数秒），期间 Acquire / Release 照常，推理不受阻塞
+    std::shared_ptr<Ort::Session> session;
+    try {
+        std::filesystem::create_directories(output_dir);
+        std::filesystem::path prefix = std::filesystem::path(output_dir) / (tag_ + "_profile");
+        Ort::SessionOptions options = base_options.Clone();
+        options.EnableProfiling(prefix.c_str());
+        session = std::make_shared<Ort::Session>(env, std::filesystem::path(model_path).c_str(), options);
+    } catch (...) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        arming_ = false;
+        throw;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    session_ = std::move(session);
+    arming_ = false;
+    requested_ = runs;
+    remaining_ = runs;
+    report_ = json();
+    spdlog::info("{} 剖析开启: 接下来 {} 次 Run", tag_, runs);
+}
+
+bool OrtProfiler::Active() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return arming_ || session_ != nullptr;
+}
+
+std::shared_ptr<Ort::Session> OrtProfiler::Acquire() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!session_ || remaining_ <= 0) return nullptr;
+    --remaining_;
+    ++in_flight_;
+    return session_;
+}
+
+void OrtProfiler::Release() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    --in_flight_;
+    if (remaining_ == 0 && in_flight_ == 0 && session_) Finish();
+}
+
+void OrtProfiler::Finish() {
+    Ort::AllocatorWithDefaultOptions allocator;
+    std::string trace_path;
+    try {
+        trace_path = session_->EndProfilingAllocated(allocator).get();
+        std::ifstream trace_file(trace_path);
+        if (!trace_file.is_open()) throw std::runtime_error("无法读取 profiling 输出: " + trace_path);
+        report_ = AggregateOrtProfile(json::parse(trace_file));
+        report_["trace_file"] = trace_path;
+        report_["runs_requested"] = requested_;
+        spdlog::info("{} 剖析完成: {} 次 Run, trace: {}", tag_, report_["runs"].get<uint64_t>(), trace_path);
+    } catch (const std::exception& e) {
+        spdlog::error("{} 剖析汇总失败: {}", tag_, e.what());
+        report_ = {{"error", e.what()}, {"trace_file", trace_path}};
+    }
+    session_.reset();
+}
+
+json OrtProfiler::Status() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    json status = {{"state", session_ ? "profiling" : arming_ ? "arming" : (report_.is_null() ? "idle" : "done")}};
+    if (session_) {
+        status["runs_requested"] = requested_;
+        status["remaining"] = remaining_;
+    }
+    if (!report_.is_null()) status["report"] = report_;
+    return status;
+}
@@ -0,0 +1,65 @@
+#ifndef OCR_PROFILER_H
+#define OCR_PROFILER_H
+
+#include <onnxruntime_cxx_api.h>
+#include <json.hpp>
+#include <memory>
+#include <mutex>
+#include <string>
+
+using json = nlohmann::json;
+
+// 汇总 ORT profiling 输出（Chrome trace 事件数组）：按算子类型统计 kernel 耗时，附耗时最高的节点
+json AggregateOrtProfile(const json& trace, int top_nodes = 10);
+
+// ORT 算子级剖析：EnableProfiling 只能在创建 session 时指定，
+// 因此按需创建开启剖析的影子 session，接管接下来 N 次 Run，结束后 EndProfiling 并汇总。
+// 常驻 session 不受影响，运行时开关无需重启服务
+class OrtProfiler {
+public:
+    explicit OrtProfiler(std::string tag) : tag_(std::move(tag)) {}
+
+    // 为接下来 runs 次 Run 开启剖析（创建 session 较慢，在调用线程、锁外完成，不阻塞推理）；
+    // runs = 0 取消进行中的剖析并以已完成的部分出报告；进行中或正在开启时再次开启抛 std::logic_error
+    void Arm(Ort::Env& env, const Ort::SessionOptions& base_options, const std::string& model_path,
+             int runs, const std::string& output_dir);
+    bool Active() const;  // 剖析中或正在开启
+    // Run 前调用：剖析中返回影子 session，否则 nullptr；非空时须与 Release 成对
+    std::shared_ptr<Ort::Session> Acquire();
+    void Release();
+
+    json Status() const;  // state / 剩余次数 / 最近一次报告
+
+private:
+    std::string tag_;
+    mutable std::mutex mutex_;
+    std::shared_ptr<Ort::Session> session_;  // 剖析中的影子 session
+    int requested_ = 0;
+    int remaining_ = 0;
+    int in_flight_ = 0;
+    bool arming_ = false;  // 影子 session 创建中（锁外）
+    json report_;  // 最近一次完成的汇总
+
+    void Finish();  // 持 mutex_ 调用：EndProfiling + 解析 trace
+};
+
+// RAII：剖析中使用影子 session，否则使用常驻 session
+class ScopedProfiledSession {
+public:
+    ScopedProfiledSession(OrtProfiler& profiler, Ort::Session& session)
+        : profiler_(profiler), profiled_(profiler.Acquire()), session_(profiled_ ? *profiled_ : session) {}
+    ~ScopedProfiledSession() {
+        if (profiled_) profiler_.Release();
+    }
+    ScopedProfiledSession(const ScopedProfiledSession&) = delete;
+    ScopedProfiledSession& operator=(const ScopedProfiledSession&) = delete;
+
+    Ort::Session& Get() { return session_; }
+
+private:
+    OrtProfiler& profiler_;
+    std::shared_ptr<Ort::Session> profiled_;
+    Ort::Session& session_;
+};
+
+#endif // OCR_PROFILER_H
@@ -0,0 +1,82 @@
+#include "ocr_quant.h"
+#include <spdlog/spdlog.h>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+std::string ApprovalManifestPath(const std::string& model_path) {
+    return model_path + ".approval.json";
+}
+
+std::string ModelFingerprint(const std::string& model_path) {
+    std::ifstream file(model_path, std::ios::binary);
+    if (!file.is_open()) throw std::runtime_error("无法读取模型: " + model_path);
+    uint64_t hash = 1469598103934665603ull;  // FNV-1a offset basis
+    std::vector<char> buffer(1 << 16);
+    while (file) {
+        file.read(buffer.data(), buffer.size());
+        for (std::streamsize i = 0; i < file.gcount(); ++i) {
+            hash ^= static_cast<unsigned char>(buffer[i]);
+            hash *= 1099511628211ull;
+        }
+    }
+    char hex[17];
+    std::snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(hash));
+    return hex;
+}
+
+json ReadApproval(const std::string& model_path) {
+    std::ifstream file(ApprovalManifestPath(model_path));
+    if (!file.is_open()) return nullptr;
+    return json::parse(file);
+}
+
+void WriteApproval(const std::string& model_path, const json& manifest) {
+    std::ofstream file(ApprovalManifestPath(model_path));
+    if (!file.is_open()) throw std::runtime_error("无法写入批准清单: " + ApprovalManifestPath(model_path));
+    file << manifest.dump(2) << std::endl;
+}
+
+bool IsApproved(const std::string& model_path, std::string& reason) {
+    json manifest;
+    try {
+        manifest = ReadApproval(model_path);
+    } catch (const std::exception& e) {
+        reason = std::string("批准清单解析失败: ") + e.what();
+        return false;
+    }
+    if (manifest.is_null()) {
+        reason = "缺少批准清单 " + ApprovalManifestPath(model_path);
+        return false;
+    }
+    if (!manifest.value("approved", false)) {
+        reason = "评估未通过: " + manifest.value("reason", std::string("unknown"));
+        return false;
+    }
+    if (manifest.value("fingerprint", "") != ModelFingerprint(model_path)) {
+        reason = "模型文件与评估时不一致（指纹不符）";
+        return false;
+    }
+    return true;
+}
+
+ModelVariant SelectModelVariant(const json& model_config, const std::string& default_precision,
+                                bool require_approval, const std::string& tag) {
+    ModelVariant variant{model_config.at("path").get<std::string>(), "fp32", ""};
+    std::string precision = model_config.value("precision", default_precision);
+    if (precision == "fp32") return variant;
+    if (precision != "int8") throw std::invalid_argument(tag + " precision 必须为 fp32 或 int8: " + precision);
+
+    std::string int8_path = model_config.value("int8_path", "");
+    if (int8_path.empty() || !std::filesystem::exists(int8_path)) {
+        variant.note = "int8_path 未配置或不存在";
+    } else if (std::string reason; require_approval && !IsApproved(int8_path, reason)) {
+        variant.note = reason;
+    } else {
+        return {int8_path, "int8", ""};
+    }
+    spdlog::error("{} INT8 模型未启用，回退 FP32: {}", tag, variant.note);
+    return variant;
+}
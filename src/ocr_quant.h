@@ -0,0 +1,31 @@
+#ifndef OCR_QUANT_H
+#define OCR_QUANT_H
+
+#include <json.hpp>
+#include <string>
+
+using json = nlohmann::json;
+
+// 量化模型变体：det_model / rec_model 可配置 int8_path，precision（模型级覆盖 model.precision）选择加载哪个。
+// INT8 模型须经离线评估（tools/ocr_quant_eval）批准：批准清单 <int8_path>.approval.json 记录模型指纹与精度对比，
+// 模型文件变动后指纹不符即视为未批准
+struct ModelVariant {
+    std::string path;
+    std::string precision;  // "fp32" | "int8"
+    std::string note;       // 回退原因（空 = 按配置加载）
+};
+
+std::string ApprovalManifestPath(const std::string& model_path);
+// 模型文件内容的 FNV-1a 64 位指纹（十六进制），用于识别模型是否与评估时一致
+std::string ModelFingerprint(const std::string& model_path);
+// 读取批准清单（不存在返回 null）
+json ReadApproval(const std::string& model_path);
+void WriteApproval(const std::string& model_path, const json& manifest);
+// 清单存在、approved 为 true 且指纹与当前文件一致
+bool IsApproved(const std::string& model_path, std::string& reason);
+
+// 按精度选择模型路径；require_approval 时未批准的 INT8 模型回退 FP32
+ModelVariant SelectModelVariant(const json& model_config, const std::string& default_precision,
+                                bool require_approval, const std::string& tag);
+
+#endif // OCR_QUANT_H
@@ -1,4 +1,5 @@
 #include "ocr_recognize.h"
+#include "ocr_metrics.h"
 #include <spdlog/spdlog.h>
 #include <json.hpp>
 #include <opencv2/opencv.hpp>
@@ -8,8 +9,10 @@
 #include <filesystem>
 #include <algorithm>
 #include <cctype>
+#include <map>
 
-OCRRecognize::OCRRecognize(const json& rec_config) : rec_config_(rec_config) {
+OCRRecognize::OCRRecognize(const json& rec_config)
+    : env_(ModelLoader::Instance().Env(rec_config.value("loading", json::object()))), rec_config_(rec_config) {
     std::string path = rec_config.at("path").get<std::string>();
     if (!std::filesystem::exists(path)) {
         throw std::runtime_error("识别模型路径不存在: " + path);
@@ -26,54 +29,90 @@ OCRRecognize::OCRRecognize(const json& rec_config) : rec_config_(rec_config) {
     rec_batch_num_ = rec_config.value("rec_batch_num", 6);
 
     // 输入/输出名和形状
-    input_names_ = rec_config.at("input_names").get<std::vector<std::string>>();
-    output_names_ = rec_config.at("output_names").get<std::vector<std::string>>();
+    input_name_strs_ = rec_config.at("input_names").get<std::vector<std::string>>();
+    output_name_strs_ = rec_config.at("output_names").get<std::vector<std::string>>();
+    for (const auto& name : input_name_strs_) input_names_.push_back(name.c_str());
+    for (const auto& name : output_name_strs_) output_names_.push_back(name.c_str());
     input_shape_ = rec_config.at("input_shape").get<std::vector<int64_t>>();
 
     // 初始化 ONNX
-    env_ = Ort::Env(ORT_LOGGING_LEVEL_WARNING, "Recognize");
-    session_options_.SetIntraOpNumThreads(4);
+    // 线程数由 ModelLoader 统一设置（共享线程池或每 session intra_op_threads）
     session_options_.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_ENABLE_EXTENDED);
-    session_ = Ort::Session(env_, path.c_str(), session_options_);
+    auto loaded = ModelLoader::Instance().Load(env_, path, session_options_, rec_config.value("loading", json::object()));
+    session_ = std::move(loaded.session);
+    model_mapping_ = std::move(loaded.mapping);
+    load_info_ = std::move(loaded.info);
 
-    // 字典从 character_dict 层
+    // 字典从 character_dict 层（use_space_char 默认 true：PaddleOCR 模型的末类为空格）
     json dict_config = rec_config.at("character_dict");
-    std::string dict_path = dict_config.at("path").get<std::string>();
-    int expected_size = dict_config.value("dict_size", 6625);
-    LoadDict(dict_path);
-    if (static_cast<int>(dict_.size()) != expected_size) {
-        spdlog::warn("字典大小不匹配: {} vs {}", dict_.size(), expected_size);
+    dict_ = CharDict::Load(dict_config);
+    decoder_ = std::make_unique<CtcGreedyDecoder>(dict_);
+    beam_decoder_ = std::make_unique<CtcBeamDecoder>(dict_);
+    load_info_["dict"] = dict_->Info();
+    // dict_size / 模型输出维：类别数 = 字典字符数 + blank（含空格类）
+    auto output_shape = session_.GetOutputTypeInfo(0).GetTensorTypeAndShapeInfo().GetShape();
+    int64_t model_classes = output_shape.size() == 3 ? output_shape[2] : -1;
+    if (dict_config.contains("dict_size") && dict_->NumClasses() != dict_config["dict_size"].get<size_t>()) {
+        spdlog::warn("字典类别数不匹配: {} (含 blank) vs dict_size {}", dict_->NumClasses(), dict_config["dict_size"].get<size_t>());
+    }
+    if (model_classes > 0 && static_cast<size_t>(model_classes) != dict_->NumClasses()) {
+        spdlog::warn("模型输出类别数 {} 与字典 {} (含 blank) 不一致，超出字典的类别将被丢弃（检查 use_space_char）",
+                     model_classes, dict_->NumClasses());
     }
 
     // 阈值从 postprocess 层
     json postprocess = rec_config.value("postprocess", json::object());
     rec_threshold_ = postprocess.value("rec_score_thresh", 0.5f);
+    beam_threshold_ = postprocess.value("beam_score_thresh", 0.3f);
+    max_text_length_ = postprocess.value("max_text_length", 25);
+    for (const auto& [name, spec] : postprocess.value("decode_profiles", json::object()).items()) {
+        decode_profiles_[name] = CompileDecode(spec, true);
+        decode_profiles_[name].name = name;
+    }
+
+    input_width_hist_ = &MetricsRegistry::Instance().GetHistogram(
+        "ocr_rec_input_width_pixels", "Width of recognition input tensors after resize and padding",
+        {32, 64, 96, 128, 160, 192, 224, 256, 288, 320});
 
-    spdlog::info("识别模块加载: {} (高度: {}, 字典大小: {})", path, rec_image_height_, dict_.size());
+    spdlog::info("识别模块加载: {} (高度: {}, 字典大小: {})", path, rec_image_height_, dict_->Size());
 }
 
 OCRRecognize::~OCRRecognize() = default;
 
-void OCRRecognize::LoadDict(const std::string& dict_path) {
-    std::ifstream file(dict_path);
-    if (!file.is_open()) {
-        throw std::runtime_error("字典文件无法打开: " + dict_path);
-    }
-    std::string line;
-    dict_.clear();
-    while (std::getline(file, line)) {
-        if (!line.empty()) dict_.emplace_back(std::move(line));
-    }
-    if (dict_.empty()) throw std::runtime_error("字典为空");
+void OCRRecognize::StartProfiling(int runs, const std::string& output_dir) {
+    profiler_.Arm(env_, session_options_, rec_config_.at("path").get<std::string>(), runs, output_dir);
+}
+
+std::vector<int> OCRRecognize::WidthBuckets() const {
+    std::vector<int> widths;
+    for (int w = 32; w <= kMaxWidth; w += 32) widths.push_back(w);
+    return widths;
+}
+
+void OCRRecognize::Warmup(int width, int batch) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<int64_t> shape = input_shape_;  // [1,3,48,W]
+    shape[0] = batch;
+    shape[2] = rec_image_height_;
+    shape[3] = width;
+    size_t input_size = static_cast<size_t>(batch) * 3 * rec_image_height_ * width;
+    std::vector<float> input_data(input_size, 0.0f);
+    Ort::MemoryInfo memory_info = Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
+    std::vector<Ort::Value> input_tensors;
+    input_tensors.push_back(Ort::Value::CreateTensor<float>(memory_info, input_data.data(), input_size,
+                                                            shape.data(), shape.size()));
+    session_.Run(Ort::RunOptions{nullptr}, input_names_.data(), input_tensors.data(), input_names_.size(),
+                 output_names_.data(), output_names_.size());
 }
 
-cv::Mat OCRRecognize::Preprocess(const cv::Mat& img) {
+cv::Mat OCRRecognize::Preprocess(const cv::Mat& img, int& content_width) {
     if (img.empty()) throw std::invalid_argument("输入裁剪图像为空");
 
     // Resize to height, dynamic width
     double ratio = static_cast<double>(rec_image_height_) / img.rows;
     int target_w = static_cast<int>(img.cols * ratio);
-    target_w = std::min(target_w, 320);  // max width
+    target_w = std::clamp(target_w, 1, kMaxWidth);  // 细高裁剪（cols * H < rows）缩放后宽度不能为 0
+    content_width = target_w;
     cv::Mat resized;
     cv::resize(img, resized, cv::Size(target_w, rec_image_height_), 0, 0, cv::INTER_LINEAR);
 
@@ -102,83 +141,213 @@ cv::Mat OCRRecognize::Preprocess(const cv::Mat& img) {
     return chw;
 }
 
-std::string OCRRecognize::Recognize(const cv::Mat& img_crop, float& score) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    cv::Mat input = Preprocess(img_crop);
-    std::vector<int64_t> dynamic_shape = input_shape_;  // [1,3,48,W]
-    dynamic_shape[3] = input.size[3];  // dynamic W
-    size_t input_size = input.total();
+DecodeSpec OCRRecognize::ResolveDecode(const json& spec) const {
+    if (spec.is_string()) {
+        auto it = decode_profiles_.find(spec.get<std::string>());
+        if (it == decode_profiles_.end()) throw std::invalid_argument("未知解码配置: " + spec.get<std::string>());
+        return it->second;
+    }
+    if (!spec.is_object()) throw std::invalid_argument("decode 须为配置名或对象");
 
-    std::vector<float> input_data(input_size);
-    memcpy(input_data.data(), input.ptr<float>(0), input_size * sizeof(float));
+    // 同一内联约束常随每个请求重复出现：命中缓存则跳过词典树 / 正则的编译
+    std::string key = spec.dump();
+    {
+        std::lock_guard<std::mutex> lock(decode_cache_mutex_);
+        auto it = decode_cache_index_.find(key);
+        if (it != decode_cache_index_.end()) {
+            decode_cache_.splice(decode_cache_.begin(), decode_cache_, it->second);
+            return it->second->second;
+        }
+    }
+    DecodeSpec decode;
+    try {
+        decode = CompileDecode(spec, false);  // 锁外编译
+    } catch (const json::exception& e) {
+        throw std::invalid_argument("decode 字段类型错误: " + std::string(e.what()));
+    }
+    std::lock_guard<std::mutex> lock(decode_cache_mutex_);
+    if (decode_cache_index_.count(key) == 0) {
+        decode_cache_.emplace_front(key, decode);
+        decode_cache_index_[std::move(key)] = decode_cache_.begin();
+        if (decode_cache_.size() > kDecodeCacheSize) {
+            decode_cache_index_.erase(decode_cache_.back().first);
+            decode_cache_.pop_back();
+        }
+    }
+    return decode;
+}
 
-    Ort::MemoryInfo memory_info = Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
-    auto input_tensor = Ort::Value::CreateTensor<float>(memory_info, input_data.data(), input_size,
-                                                       dynamic_shape.data(), dynamic_shape.size());
+DecodeSpec OCRRecognize::CompileDecode(const json& spec, bool from_config) const {
+    DecodeSpec decode;
+    bool has_lexicon = spec.contains("lexicon") || spec.contains("lexicon_path");
+    bool has_pattern = spec.contains("pattern");
+    if (has_lexicon && has_pattern) throw std::invalid_argument("decode 的 lexicon 与 pattern 只能二选一");
+    std::string mode = spec.value("mode", (has_lexicon || has_pattern) ? "beam" : "greedy");
+    if (mode != "greedy" && mode != "beam") throw std::invalid_argument("未知解码方式: " + mode + "（可选 greedy / beam）");
+    if (mode == "greedy") {
+        if (has_lexicon || has_pattern) throw std::invalid_argument("词典 / 正则约束需要 beam 解码");
+        return decode;
+    }
 
-    std::vector<Ort::Value> input_tensors{std::move(input_tensor)};
-    std::vector<Ort::Value> output_tensors;
-    try {
-        session_.Run(Ort::RunOptions{nullptr}, input_names_.data(), input_tensors.data(), input_names_.size(),
-                     output_names_.data(), output_names_.size(), &output_tensors);
-    } catch (const Ort::Exception& e) {
-        spdlog::error("识别推理失败: {}", e.what());
-        score = 0.0f;
-        return "";
+    decode.beam = true;
+    decode.beam_options.beam_width = spec.value("beam_width", decode.beam_options.beam_width);
+    decode.beam_options.top_k = spec.value("top_k", decode.beam_options.top_k);
+    decode.beam_options.min_prob = spec.value("min_prob", decode.beam_options.min_prob);
+    if (decode.beam_options.beam_width < 1 || decode.beam_options.beam_width > 64 ||
+        decode.beam_options.top_k < 1 || decode.beam_options.top_k > 64) {
+        throw std::invalid_argument("beam_width / top_k 须在 1..64");
     }
+    decode.score_thresh = spec.value("score_thresh", beam_threshold_);
+    if (!(decode.score_thresh >= 0.0f && decode.score_thresh <= 1.0f)) throw std::invalid_argument("score_thresh 须在 0..1");
 
-    std::string text = Postprocess(output_tensors, score);
-    if (score < rec_threshold_) {
-        spdlog::debug("识别分数低: {:.3f} < {:.3f}, 过滤", score, rec_threshold_);
-        return "";
+    if (spec.contains("lexicon_path")) {
+        // 词表文件只允许来自配置，请求不能指定服务端路径
+        if (!from_config) throw std::invalid_argument("lexicon_path 只能在 decode_profiles 中配置");
+        std::string path = spec["lexicon_path"].get<std::string>();
+        std::ifstream file(path);
+        if (!file.is_open()) throw std::runtime_error("词表文件无法打开: " + path);
+        std::vector<std::string> words;
+        for (std::string line; std::getline(file, line);) {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (!line.empty()) words.push_back(std::move(line));
+        }
+        decode.constraint = std::make_shared<LexiconTrie>(words, *dict_);
+    } else if (spec.contains("lexicon")) {
+        auto words = spec["lexicon"].get<std::vector<std::string>>();
+        size_t bytes = 0;
+        for (const auto& word : words) bytes += word.size();
+        if (!from_config && (words.size() > kMaxInlineLexiconWords || bytes > kMaxInlineLexiconBytes)) {
+            throw std::invalid_argument("内联 lexicon 过大（上限 " + std::to_string(kMaxInlineLexiconWords) + " 词 / " +
+                                        std::to_string(kMaxInlineLexiconBytes) + " 字节），请在 decode_profiles 中配置");
+        }
+        decode.constraint = std::make_shared<LexiconTrie>(words, *dict_);
+    } else if (has_pattern) {
+        std::string pattern = spec["pattern"].get<std::string>();
+        if (!from_config && pattern.size() > kMaxInlinePatternBytes) {
+            throw std::invalid_argument("内联 pattern 过长（上限 " + std::to_string(kMaxInlinePatternBytes) + " 字节）");
+        }
+        decode.constraint = std::make_shared<PatternConstraint>(pattern, *dict_);
     }
-    return text;
+    return decode;
 }
 
-std::string OCRRecognize::Postprocess(const std::vector<Ort::Value>& outputs, float& score) {
-    if (outputs.empty()) {
-        score = 0.0f;
-        return "";
-    }
-
-    auto& output = outputs[0];
-    float* output_data = output.GetTensorMutableData<float>();
-    auto shape = output.GetTensorTypeAndShapeInfo().GetShape();
-    int T = shape[1];  // time steps
-    int C = shape[2];  // classes (dict_size + blank)
-
-    score = 0.0f;
-    std::vector<int> pred(T);
-    for (int t = 0; t < T; ++t) {
-        float max_p = -1.0f;
-        int max_idx = 0;
-        for (int c = 0; c < C; ++c) {
-            float p = output_data[t * C + c];
-            if (p > max_p) {
-                max_p = p;
-                max_idx = c;
-            }
+std::string OCRRecognize::Recognize(const cv::Mat& img_crop, float& score, const Ort::RunOptions* run_options,
+                                    std::vector<RecognizedChar>* chars, const DecodeSpec* decode, bool* matched) {
+    std::vector<Recognition> results = RecognizeBatch({{img_crop, decode}}, run_options, chars != nullptr);
+    Recognition& result = results.front();
+    score = result.score;
+    if (matched) *matched = result.matched;
+    if (chars) *chars = std::move(result.chars);
+    return std::move(result.text);
+}
+
+std::vector<Recognition> OCRRecognize::RecognizeBatch(const std::vector<RecognitionInput>& inputs,
+                                                      const Ort::RunOptions* run_options, bool return_chars) {
+    std::vector<Recognition> results(inputs.size());
+    if (inputs.empty()) return results;
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    // 预处理并按补边宽度分组（形状相同才能拼批）
+    std::vector<cv::Mat> blobs(inputs.size());
+    std::vector<int> content_widths(inputs.size());
+    std::map<int, std::vector<size_t>> by_width;
+    {
+        ScopedStageTimer timer(Stage::kRecPreprocess);
+        for (size_t i = 0; i < inputs.size(); ++i) {
+            blobs[i] = Preprocess(inputs[i].crop, content_widths[i]);
+            by_width[blobs[i].size[3]].push_back(i);
         }
-        pred[t] = max_idx;
-        score += max_p / T;
-    }
-
-    // CTC decode: remove blanks (last class) and duplicates
-    std::string text;
-    int prev = -1;
-    for (int p : pred) {
-        if (p == C - 1) continue;  // blank (last)
-        if (p == prev) continue;   // duplicate
-        if (p > 0 && p <= static_cast<int>(dict_.size())) {  // valid char
-            text += dict_[p - 1];
+    }
+
+    size_t batch_limit = static_cast<size_t>(std::max(1, rec_batch_num_));
+    Ort::MemoryInfo memory_info = Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
+    Ort::RunOptions default_options{nullptr};
+    const Ort::RunOptions& options = run_options ? *run_options : default_options;
+    for (const auto& [width, indices] : by_width) {
+        for (size_t begin = 0; begin < indices.size(); begin += batch_limit) {
+            size_t n = std::min(batch_limit, indices.size() - begin);
+            ScopedSpan span("rec_batch");
+            span.SetAttribute("width", width);
+            span.SetAttribute("batch", n);
+
+            std::vector<int64_t> dynamic_shape = input_shape_;  // [n,3,48,W]
+            dynamic_shape[0] = static_cast<int64_t>(n);
+            dynamic_shape[3] = width;  // dynamic W
+            size_t item_size = blobs[indices[begin]].total();
+            std::vector<float> input_data(item_size * n);
+            for (size_t k = 0; k < n; ++k) {
+                memcpy(input_data.data() + k * item_size, blobs[indices[begin + k]].ptr<float>(0), item_size * sizeof(float));
+                input_width_hist_->Observe(static_cast<double>(width));
+            }
+
+            std::vector<Ort::Value> input_tensors;  // Ort::Value 仅可移动，不能用初始化列表
+            input_tensors.push_back(Ort::Value::CreateTensor<float>(memory_info, input_data.data(), input_data.size(),
+                                                                    dynamic_shape.data(), dynamic_shape.size()));
+            std::vector<Ort::Value> output_tensors;
+            try {
+                ScopedStageTimer timer(Stage::kRecInference);
+                ScopedProfiledSession session(profiler_, session_);
+                session.Get().Run(options, input_names_.data(), input_tensors.data(), input_names_.size(),
+                                  output_names_.data(), output_names_.size(), &output_tensors);
+            } catch (const Ort::Exception& e) {
+                spdlog::error("识别推理失败: {}", e.what());
+                continue;  // 本组结果保持为空
+            }
+            if (output_tensors.empty()) continue;
+
+            ScopedStageTimer timer(Stage::kCtcDecode);
+            auto shape = output_tensors[0].GetTensorTypeAndShapeInfo().GetShape();
+            int T = static_cast<int>(shape[1]);  // time steps
+            int C = static_cast<int>(shape[2]);  // classes (字典字符数 + blank)
+            const float* probs = output_tensors[0].GetTensorData<float>();
+            for (size_t k = 0; k < n; ++k) {
+                size_t index = indices[begin + k];
+                Recognition& result = results[index];
+                result.text = Postprocess(probs + k * static_cast<size_t>(T) * C, T, C, result.score,
+                                          inputs[index].decode, result.matched);
+                // 束搜索与贪心分数尺度不同，各用各的阈值；约束未命中时结果已退回贪心
+                const DecodeSpec* decode = inputs[index].decode;
+                float threshold = decode && decode->beam && result.matched ? decode->score_thresh : rec_threshold_;
+                if (result.score < threshold) {
+                    spdlog::debug("识别分数低: {:.3f} < {:.3f}, 过滤", result.score, threshold);
+                    result.text.clear();
+                    continue;
+                }
+                if (!return_chars) continue;
+                // 时间步按网络输入宽度均分，映射回补边前内容、再缩放回原始裁剪宽度；截断掉的字符不输出
+                const CtcOutput& decoded = decode_output_;
+                result.chars.reserve(decoded.char_scores.size());
+                for (size_t i = 0; i < decoded.char_scores.size(); ++i) {
+                    size_t char_begin = decoded.char_offset[i];
+                    size_t char_end = i + 1 < decoded.char_offset.size() ? decoded.char_offset[i + 1] : decoded.text.size();
+                    if (char_end > result.text.size()) break;
+                    CharSpan x = TimestepsToCropSpan(decoded.char_start[i], decoded.char_end[i], T, width,
+                                                     content_widths[index], inputs[index].crop.cols);
+                    result.chars.push_back({result.text.substr(char_begin, char_end - char_begin), decoded.char_scores[i],
+                                            x.x0, x.x1});
+                }
+            }
         }
-        prev = p;
     }
+    return results;
+}
+
+std::string OCRRecognize::Postprocess(const float* output_data, int T, int C, float& score, const DecodeSpec* decode,
+                                      bool& matched) {
+    // CTC 贪心解码：向量化 argmax + 按预计算偏移拷贝字典字节；
+    // 束搜索的约束未命中时退回贪心结果，由调用方据 matched 决定是否另行处理
+    if (decode && decode->beam) {
+        beam_decoder_->Decode(output_data, T, C, decode->beam_options, decode->constraint.get(), decode_output_);
+        matched = decode_output_.matched;
+        if (!matched) decoder_->Decode(output_data, T, C, decode_output_);
+    } else {
+        decoder_->Decode(output_data, T, C, decode_output_);
+    }
+    score = decode_output_.score;
+    std::string text = decode_output_.text;
 
-    // Trim max length from postprocess
-    json postprocess = rec_config_.value("postprocess", json::object());
-    int max_len = postprocess.value("max_text_length", 25);
-    if (static_cast<int>(text.length()) > max_len) text = text.substr(0, max_len);
+    // max_text_length 按码点截断，不切开多字节字符
+    text.resize(Utf8PrefixBytes(text, static_cast<size_t>(std::max(0, max_text_length_))));
 
     spdlog::debug("识别解码: '{}' (score: {:.3f})", text, score);
     return text;
@@ -1,41 +1,130 @@
 #ifndef OCR_RECOGNIZE_H
 #define OCR_RECOGNIZE_H
 
+#include "ocr_profiler.h"
+#include "ocr_model_loader.h"
+#include "ocr_ctc.h"
+#include "ocr_lexicon.h"
 #include <opencv2/opencv.hpp>
 #include <onnxruntime_cxx_api.h>
 #include <json.hpp>
+#include <algorithm>
+#include <list>
+#include <map>
+#include <memory>
 #include <vector>
 #include <string>
 #include <mutex>
+#include <unordered_map>
+
+class Histogram;
 
 using json = nlohmann::json;
 
+// 单个识别字符：置信度（其 CTC 帧中的最大概率）与在裁剪图中的近似横向范围
+struct RecognizedChar {
+    std::string text;
+    float score = 0.0f;
+    float x0 = 0.0f;  // 相对裁剪图左边缘，像素
+    float x1 = 0.0f;
+};
+
+// 解码方式：贪心（默认）或前缀束搜索，束搜索可带词典 / 正则约束（约束与本识别器的字典绑定）
+struct DecodeSpec {
+    bool beam = false;
+    BeamOptions beam_options;
+    std::shared_ptr<const DecodeConstraint> constraint;
+    float score_thresh = 0.0f;  // 束搜索结果的分数阈值（未命中约束退回贪心时仍用 rec_score_thresh）
+    std::string name;  // 配置中的 decode_profiles 名称；内联为空
+};
+
+// 批量识别的单项输入与结果
+struct RecognitionInput {
+    cv::Mat crop;
+    const DecodeSpec* decode = nullptr;  // 空 = 贪心
+};
+
+struct Recognition {
+    std::string text;  // 低于分数阈值（贪心 rec_score_thresh / 束搜索 beam_score_thresh）时为空
+    float score = 0.0f;
+    bool matched = true;
+    std::vector<RecognizedChar> chars;  // 仅 return_chars
+};
+
 class OCRRecognize {
 public:
     OCRRecognize(const json& rec_config);  // 从分层 JSON 初始化
     ~OCRRecognize();
-    std::string Recognize(const cv::Mat& img_crop, float& score);  // 返回文本 + score
+    // 返回文本 + score；run_options 可被外部 SetTerminate 中断；
+    // chars 非空时输出逐字符置信度与横向范围（与返回文本一一对应，低于阈值被过滤时为空）；
+    // decode 为空时贪心解码；有约束而束中无完整匹配时退回贪心结果，matched 置 false
+    std::string Recognize(const cv::Mat& img_crop, float& score, const Ort::RunOptions* run_options = nullptr,
+                          std::vector<RecognizedChar>* chars = nullptr, const DecodeSpec* decode = nullptr,
+                          bool* matched = nullptr);
+    // 批量识别：预处理后按补边宽度（32 的倍数）分组，每组至多 rec_batch_num 个拼成一次 Run [n,3,H,W]。
+    // 同组补边与逐个识别一致，结果不随批大小变化；每项可用各自的解码方式。结果与 inputs 一一对应
+    std::vector<Recognition> RecognizeBatch(const std::vector<RecognitionInput>& inputs,
+                                            const Ort::RunOptions* run_options = nullptr, bool return_chars = false);
+
+    // 请求中的 decode：字符串为 postprocess.decode_profiles 中的名称，对象为内联配置
+    // {"mode": "greedy" | "beam", "beam_width", "top_k", "min_prob", "score_thresh", "lexicon": [...], "pattern": "..."}。
+    // 内联约束按 JSON 文本缓存编译结果（LRU，kDecodeCacheSize 项）；无效配置抛 std::invalid_argument
+    DecodeSpec ResolveDecode(const json& spec) const;
+    static constexpr size_t kDecodeCacheSize = 64;
+    static constexpr size_t kMaxInlineLexiconWords = 1024;  // 内联词典上限（词数 / 总字节）；更大的词表用 lexicon_path
+    static constexpr size_t kMaxInlineLexiconBytes = 32 * 1024;
+    static constexpr size_t kMaxInlinePatternBytes = 256;
+
+    // 算子级剖析：接下来 runs 次 Run 使用开启 profiling 的影子 session（runs = 0 取消）
+    void StartProfiling(int runs, const std::string& output_dir);
+    json ProfileStatus() const { return profiler_.Status(); }
+    bool ProfilingActive() const { return profiler_.Active(); }
+    const json& LoadInfo() const { return load_info_; }  // mmap / 预打包共享 / RSS 增量；dict 为字典信息
+
+    static constexpr int kMaxWidth = 320;  // 输入宽度上限；预处理补边到 32 的倍数
+    // 线上出现的全部宽度桶：32, 64, ..., kMaxWidth
+    std::vector<int> WidthBuckets() const;
+    int ImageHeight() const { return rec_image_height_; }
+    int BatchNum() const { return std::max(1, rec_batch_num_); }  // RecognizeBatch 单次 Run 的批大小上限
+    // 预热：以全零输入 [batch,3,H,width] 运行 session（不经预处理 / CTC 解码，不计入阶段指标）
+    void Warmup(int width, int batch = 1);
 
 private:
-    Ort::Env env_;
+    Ort::Env& env_;  // 进程级共享（ModelLoader）
+    std::shared_ptr<const MappedModel> model_mapping_;  // 须先于 session_ 声明（后析构）
     Ort::Session session_{nullptr};
     Ort::SessionOptions session_options_;
-    std::vector<const char*> input_names_;
+    std::vector<std::string> input_name_strs_, output_name_strs_;  // 名称存储
+    std::vector<const char*> input_names_;   // 指向 *_name_strs_，供 Session::Run
     std::vector<const char*> output_names_;
     std::vector<int64_t> input_shape_;
 
     json rec_config_;  // 存储子 config
+    json load_info_;
     std::vector<float> mean_, std_;
     bool is_bgr_;
     int rec_image_height_;
     int rec_batch_num_;
     float rec_threshold_;  // 从 postprocess 层
-    std::vector<std::string> dict_;  // 字符字典
+    float beam_threshold_;  // postprocess.beam_score_thresh：束搜索分数为几何平均，尺度低于贪心
+    int max_text_length_;  // 从 postprocess 层
+    std::shared_ptr<const CharDict> dict_;  // 不可变字典，同一文件在各 rec session 间共享
+    std::unique_ptr<CtcGreedyDecoder> decoder_;  // 连续 UTF-8 字典 + 向量化 argmax
+    std::unique_ptr<CtcBeamDecoder> beam_decoder_;
+    std::map<std::string, DecodeSpec> decode_profiles_;  // 构造时编译
+    // 内联 decode 的编译缓存：JSON 文本 → DecodeSpec，最近使用在前
+    mutable std::mutex decode_cache_mutex_;
+    mutable std::list<std::pair<std::string, DecodeSpec>> decode_cache_;
+    mutable std::unordered_map<std::string, std::list<std::pair<std::string, DecodeSpec>>::iterator> decode_cache_index_;
+    CtcOutput decode_output_;        // 复用的解码缓冲（mutex_ 保护）
+    Histogram* input_width_hist_;    // 识别输入宽度分布
 
-    cv::Mat Preprocess(const cv::Mat& img);  // 动态预处理
-    std::string Postprocess(const std::vector<Ort::Value>& outputs, float& score);  // CTC decode
-    void LoadDict(const std::string& dict_path);
+    cv::Mat Preprocess(const cv::Mat& img, int& content_width);  // 动态预处理；content_width 为补边前宽度
+    // CTC decode：output_data 为单项输出 [T, C]
+    std::string Postprocess(const float* output_data, int T, int C, float& score, const DecodeSpec* decode, bool& matched);
+    DecodeSpec CompileDecode(const json& spec, bool from_config) const;
     std::mutex mutex_;  // 线程安全
+    OrtProfiler profiler_{"rec"};
 };
 
 #endif // OCR_RECOGNIZE_H
\ No newline at end of file
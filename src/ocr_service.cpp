@@ -1,4 +1,6 @@
 #include "ocr_service.h"
+#include "ocr_codec.h"
+#include "ocr_model_loader.h"
 #include <spdlog/spdlog.h>
 #include <json.hpp>
 #include <opencv2/opencv.hpp>
@@ -7,20 +9,170 @@
 #include <thread>
 #include <fstream>
 #include <filesystem>
+#include <algorithm>
+#include <chrono>
+#include <ctime>
 
-OCRService::OCRService(const json& service_config) : service_config_(service_config) {
+namespace {
+
+json LoadServiceConfig(const std::string& path) {
+    std::ifstream file(path);
+    if (!file.is_open()) throw std::runtime_error("无法加载配置: " + path);
+    return json::parse(file).at("service_config");
+}
+
+// /ocr 与共享内存摄取共用的请求选项：lang / return_chars / decode / rois / roi_mode
+InferOptions ParseInferOptions(const json& j) {
+    InferOptions options;
+    options.lang = j.value("lang", "");
+    options.return_chars = j.value("return_chars", false);
+    if (j.contains("decode")) options.decode = j["decode"];
+    if (j.contains("rois")) {
+        // 已知版面：只在 ROI 内检测（roi_mode "det"，默认）或跳过检测直接识别（"rec"）
+        options.rois = ParseRois(j["rois"]);
+        std::string roi_mode = j.value("roi_mode", "det");
+        if (roi_mode == "rec") options.roi_mode = RoiMode::kRecognize;
+        else if (roi_mode != "det") throw std::invalid_argument("未知 roi_mode: " + roi_mode + "（可选 det / rec）");
+    }
+    return options;
+}
+
+std::string Base64Decode(const std::string& encoded) {
+    // 完整 Base64 解码（处理 padding）
+    static const std::string chars = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string decoded;
+    int val = 0, valb = -8;
+    for (char c : encoded) {
+        if (c == '=') break;  // padding
+        size_t pos = chars.find(c);
+        if (pos == std::string::npos) continue;
+        val = (val << 6) + static_cast<int>(pos);
+        valb += 6;
+        if (valb >= 0) {
+            decoded.push_back(static_cast<char>((val >> valb) & 0xFF));
+            valb -= 8;
+        }
+    }
+    return decoded;
+}
+
+}  // namespace
+
+cv::Mat DecodeImage(const std::string& base64_img, size_t max_bytes, size_t* total_bytes) {
+    std::string decoded = Base64Decode(base64_img);
+    size_t bytes = decoded.size() + (total_bytes ? *total_bytes : 0);
+    if (bytes > max_bytes) throw std::invalid_argument("图像解码后过大（上限 " + std::to_string(max_bytes) + " 字节）");
+    if (total_bytes) *total_bytes = bytes;
+    std::vector<uchar> img_data(decoded.begin(), decoded.end());
+    return cv::imdecode(img_data, cv::IMREAD_COLOR);
+}
+
+std::vector<cv::Mat> DecodeStageImages(const json& body, size_t limit, size_t max_bytes) {
+    json encoded = json::array();
+    if (body.contains("images")) {
+        if (!body["images"].is_array()) throw std::invalid_argument("images 必须为 base64 字符串数组");
+        encoded = body["images"];
+    } else if (body.contains("image_base64") && !body["image_base64"].empty()) {
+        encoded.push_back(body["image_base64"]);
+    }
+    if (encoded.empty()) throw std::invalid_argument("缺少 image_base64 或 images");
+    if (encoded.size() > limit) {
+        throw std::invalid_argument("images 过多: " + std::to_string(encoded.size()) + "（上限 " + std::to_string(limit) + "）");
+    }
+    std::vector<cv::Mat> images;
+    size_t total_bytes = 0;
+    for (size_t i = 0; i < encoded.size(); ++i) {
+        std::string index = "images[" + std::to_string(i) + "]";
+        if (!encoded[i].is_string()) throw std::invalid_argument(index + " 不是字符串");
+        cv::Mat img;
+        try {
+            img = DecodeImage(encoded[i].get<std::string>(), max_bytes, &total_bytes);
+        } catch (const std::invalid_argument& e) {
+            throw std::invalid_argument(index + ": " + e.what());
+        }
+        if (img.empty()) throw std::invalid_argument(index + " 无效图像");
+        images.push_back(std::move(img));
+    }
+    return images;
+}
+
+bool AuthorizeAdmin(const std::string& admin_token, const httplib::Request& req, httplib::Response& res) {
+    if (admin_token.empty() || req.get_header_value("X-Admin-Token") == admin_token) return true;
+    res.status = 401;
+    res.set_content("{\"error\": \"X-Admin-Token 无效\"}", "application/json");
+    return false;
+}
+
+void DeleteSession(OCRSessionStore& sessions, const std::string& admin_token, const httplib::Request& req,
+                   httplib::Response& res) {
+    if (!AuthorizeAdmin(admin_token, req, res)) return;
+    res.status = sessions.Erase(req.path_params.at("id")) ? 204 : 404;
+}
+
+OCRService::OCRService(const json& service_config, const std::string& config_path)
+    : service_config_(service_config), config_path_(config_path) {
     auto service_layer = service_config.at("service");
     int thread_size = service_layer.value("thread_pool_size", 4);
     // 设置 ONNX threads (假设 inference_ 初始化时传递)
     max_size_ = service_layer.value("max_batch_size", 8) * 1024 * 1024;
+    timeout_ms_ = service_layer.value("timeout_ms", 30000);
+    max_request_timeout_ms_ = service_layer.value("max_request_timeout_ms", timeout_ms_);
+    std::string deadline_policy = service_layer.value("deadline_policy", "partial");
+    if (deadline_policy != "partial" && deadline_policy != "error") {
+        throw std::invalid_argument("deadline_policy 必须为 partial 或 error: " + deadline_policy);
+    }
+    partial_on_timeout_ = (deadline_policy == "partial");
+    admin_token_ = service_layer.value("admin_token", "");
+
+    auto& registry = MetricsRegistry::Instance();
+    requests_total_ = &registry.GetCounter("ocr_requests_total", "Total /ocr requests received");
+    errors_total_ = &registry.GetCounter("ocr_errors_total", "Total /ocr requests failed with an internal error");
+    deadline_aborts_total_ = &registry.GetCounter("ocr_deadline_aborts_total", "Requests whose deadline expired during inference");
 
+    // 准入控制：默认单推理槽位（OCRInference 内部为全局锁）
+    json admission_config = service_layer.value("admission", json::object());
+    admission_ = std::make_unique<AdmissionController>(admission_config);
+    tracer_ = std::make_unique<TraceExporter>(service_layer.value("tracing", json::object()),
+                                              service_layer.value("name", "ppocrv5_onnx_service"));
+    sessions_ = std::make_unique<OCRSessionStore>(service_layer.value("sessions", json::object()));
+    role_ = service_layer.value("role", "all");
+    if (role_ != "all" && role_ != "det" && role_ != "rec" && role_ != "frontend") {
+        throw std::invalid_argument("未知 service.role: " + role_ + "（可选 all / det / rec / frontend）");
+    }
+
+    reload_config_ = service_layer.value("reload", json::object());
+    reload_status_ = {{"generation", 1}, {"loaded_at", static_cast<int64_t>(std::time(nullptr))}};
+    warmup_config_ = service_layer.value("warmup", json::object());
+
+    if (role_ == "frontend") {
+        frontend_ = std::make_unique<OCRFrontend>(service_layer.value("workers", json::object()));
+        spdlog::info("服务配置加载完成 (角色: frontend)");
+        return;
+    }
     try {
-        inference_ = std::make_unique<OCRInference>(service_config);
+        inference_ = std::make_shared<OCRInference>(service_config);
     } catch (const std::exception& e) {
         spdlog::error("OCR 管道初始化失败: {}", e.what());
         throw;
     }
-    spdlog::info("服务配置加载完成 (模型: {})", service_config.at("model").at("rec_model").at("path"));
+    spdlog::info("服务配置加载完成 (角色: {}, 模型: {})", role_, service_config.at("model").at("rec_model").at("path"));
+}
+
+OCRService::~OCRService() {
+    if (ipc_) ipc_->Stop();  // 先停共享内存连接线程，其处理函数引用本对象
+    {
+        std::lock_guard<std::mutex> lock(watch_mutex_);
+        stopping_ = true;
+    }
+    watch_cv_.notify_all();
+    if (watch_thread_.joinable()) watch_thread_.join();
+    if (warmup_thread_.joinable()) warmup_thread_.join();
+    std::thread reload_thread;
+    {
+        std::lock_guard<std::mutex> lock(reload_mutex_);  // RunReload 收尾时也要取此锁，不能持锁 join
+        reload_thread = std::move(reload_thread_);
+    }
+    if (reload_thread.joinable()) reload_thread.join();
 }
 
 void OCRService::StartServer() {
@@ -29,85 +181,573 @@ void OCRService::StartServer() {
     int timeout = service_layer.value("timeout_ms", 30000);
 
     httplib::Server svr;
-    svr.set_timeout(timeout / 1000, 0);  // sec, usec
+    svr.set_read_timeout(timeout / 1000, (timeout % 1000) * 1000);  // sec, usec
+    svr.set_write_timeout(timeout / 1000, (timeout % 1000) * 1000);
+    svr.set_tcp_nodelay(true);  // 响应较小，关闭 Nagle 避免与客户端延迟 ACK 叠加出约 40ms 尾延迟
 
-    // /ocr
-    svr.Post("/ocr", [this](const httplib::Request& req, httplib::Response& res) {
-        ocr_handler(req, res);
-    });
+    // /ocr、/det、/rec：请求 ID 取 X-Request-ID（净化后，缺省生成）并回写；X-Trace: 1 强制采样
+    auto traced_route = [this](const char* trace_name, httplib::Server::Handler handler) {
+        return [this, trace_name, handler](const httplib::Request& req, httplib::Response& res) {
+            std::string request_id = SanitizeRequestId(req.get_header_value("X-Request-ID"));
+            ScopedTrace trace(*tracer_, request_id, trace_name, req.get_header_value("X-Trace") == "1");
+            res.set_header("X-Request-ID", request_id);
+            handler(req, res);
+            trace.SetAttribute("http.status_code", std::to_string(res.status == -1 ? 200 : res.status));
+        };
+    };
+    // 按角色注册：det / rec worker 只提供本阶段端点，frontend 只提供 /ocr（转发给 worker）
+    if (role_ == "all" || role_ == "frontend") {
+        svr.Post("/ocr", traced_route("ocr_request", [this](const httplib::Request& req, httplib::Response& res) {
+            ocr_handler(req, res, false);
+        }));
+    }
+
+    // /ocr/session：截图流增量 OCR（请求体另带 session_id）；DELETE 结束会话、释放缓存
+    if (role_ == "all") {
+        svr.Post("/ocr/session", traced_route("ocr_session_request", [this](const httplib::Request& req, httplib::Response& res) {
+            ocr_handler(req, res, true);
+        }));
+        svr.Delete("/ocr/session/:id", [this](const httplib::Request& req, httplib::Response& res) {
+            DeleteSession(*sessions_, admin_token_, req, res);
+        });
+    }
+
+    // /det：仅检测；/rec：仅识别已裁好的文本行。与 /ocr 共用模型、准入队列与截止时间，一次请求内多图拼批
+    if (role_ == "all" || role_ == "det") {
+        svr.Post("/det", traced_route("det_request", [this](const httplib::Request& req, httplib::Response& res) {
+            stage_handler(req, res, true);
+        }));
+    }
+    if (role_ == "all" || role_ == "rec") {
+        svr.Post("/rec", traced_route("rec_request", [this](const httplib::Request& req, httplib::Response& res) {
+            stage_handler(req, res, false);
+        }));
+    }
 
     // /info
     svr.Get("/info", [this](const httplib::Request&, httplib::Response& res) {
         info_handler({}, res);
     });
 
-    // /health
+    // /health：存活探针，进程在即 OK
     svr.Get("/health", [](const httplib::Request&, httplib::Response& res) {
         res.set_content("OK", "text/plain");
     });
 
-    // /metrics
-    svr.Get("/metrics", [this](const httplib::Request&, httplib::Response& res) {
-        std::lock_guard<std::mutex> lock(metrics_mutex_);
-        json metrics = {{"requests", request_count_}, {"errors", error_count_}};
-        res.set_content(metrics.dump(), "application/json");
+    // /ready：就绪探针，启动预热完成前 503（负载均衡据此摘流）
+    svr.Get("/ready", [this](const httplib::Request&, httplib::Response& res) {
+        if (!ready_) {
+            res.status = 503;
+            res.set_content("WARMING_UP", "text/plain");
+            return;
+        }
+        res.set_content("READY", "text/plain");
+    });
+
+    // /admin/profile：运行时开关 ORT 算子级剖析（POST 开启 / 取消，GET 查看状态与汇总）
+    svr.Post("/admin/profile", [this](const httplib::Request& req, httplib::Response& res) {
+        profile_handler(req, res);
+    });
+    svr.Get("/admin/profile", [this](const httplib::Request& req, httplib::Response& res) {
+        if (!authorize_admin(req, res)) return;
+        res.set_content(ProfileStatus().dump(2), "application/json");
+    });
+
+    // /admin/reload：从配置文件热重载模型（POST 触发，?wait=1 同步等待；GET 查看状态）
+    svr.Post("/admin/reload", [this](const httplib::Request& req, httplib::Response& res) {
+        reload_handler(req, res);
+    });
+    svr.Get("/admin/reload", [this](const httplib::Request& req, httplib::Response& res) {
+        if (!authorize_admin(req, res)) return;
+        res.set_content(ReloadStatus().dump(2), "application/json");
+    });
+
+    // /metrics：Prometheus 文本格式；?format=json 返回 JSON 快照
+    svr.Get("/metrics", [this](const httplib::Request& req, httplib::Response& res) {
+        if (req.get_param_value("format") == "json") {
+            json metrics = {{"requests", requests_total_->Value()}, {"errors", errors_total_->Value()}};
+            metrics["admission"] = admission_->Stats();
+            metrics["deadline_aborts"] = deadline_aborts_total_->Value();
+            metrics["registry"] = MetricsRegistry::Instance().Snapshot();
+            res.set_content(metrics.dump(), "application/json");
+            return;
+        }
+        std::string text = MetricsRegistry::Instance().RenderPrometheus() + admission_->PrometheusText();
+        res.set_content(std::move(text), "text/plain; version=0.0.4; charset=utf-8");
     });
 
-    // 线程池
+    // 线程池：需容纳 推理并发 + 等待队列，否则请求会堆积在 httplib 的无界任务队列中，
+    // 到不了准入控制；max_pending_connections 为 httplib 队列兜底上限（0 = 不限）
     if (service_layer.value("use_multithread", true)) {
-        int thread_size = service_layer["thread_pool_size"];
-        svr.new_task_queue = [thread_size]() { return new httplib::ThreadPool(thread_size); };
+        json admission_config = service_layer.value("admission", json::object());
+        int thread_size = std::max(service_layer.value("thread_pool_size", 4),
+                                   admission_config.value("max_concurrency", 1) +
+                                   admission_->TotalQueueCapacity());
+        size_t max_pending = admission_config.value("max_pending_connections", 64);
+        svr.new_task_queue = [thread_size, max_pending]() {
+            return new httplib::ThreadPool(thread_size, max_pending);
+        };
+        spdlog::info("HTTP 线程: {}, 挂起连接上限: {}", thread_size, max_pending);
     }
 
-    spdlog::info("服务器监听端口: {}", port);
+    // 预热在后台进行，期间 /health 已可响应、/ready 为 503
+    warmup_thread_ = std::thread([this] {
+        try {
+            Warmup();
+        } catch (const std::exception& e) {
+            spdlog::error("启动预热失败: {}", e.what());
+        }
+        ready_ = true;
+        spdlog::info("服务就绪");
+    });
+
+    if (reload_config_.value("watch_config", false) && !config_path_.empty() && inference_) {
+        watch_thread_ = std::thread(&OCRService::WatchConfig, this);
+    }
+
+    // 共享内存摄取（service.ipc，仅单进程角色）：与 HTTP 共用准入队列、截止时间与推理管道
+    json ipc_config = service_layer.value("ipc", json::object());
+    if (ipc_config.value("enabled", false) && role_ == "all") {
+        ipc_ = std::make_unique<IpcServer>(ipc_config, [this](const IpcFrame& frame) { return ipc_handler(frame); });
+        try {
+            ipc_->Start();
+        } catch (const std::exception& e) {
+            spdlog::error("共享内存摄取启动失败，仅提供 HTTP: {}", e.what());
+            ipc_.reset();
+        }
+    }
+
+    // service.listen = "unix:<path>"：监听 Unix 域套接字（同机的阶段 worker），否则 TCP port
+    std::string listen = service_layer.value("listen", "");
+    if (listen.rfind("unix:", 0) == 0) {
+        std::string path = listen.substr(5);
+        std::error_code ec;
+        if (!std::filesystem::is_directory(path, ec)) std::filesystem::remove(path, ec);  // 上次退出残留的套接字文件
+        svr.set_address_family(AF_UNIX);
+        spdlog::info("服务器监听 Unix 套接字: {} (角色: {})", path, role_);
+        if (!svr.listen(path, 80)) {
+            spdlog::error("服务器启动失败");
+        }
+        return;
+    }
+    spdlog::info("服务器监听端口: {} (角色: {})", port, role_);
     if (!svr.listen("0.0.0.0", port)) {
         spdlog::error("服务器启动失败");
     }
 }
 
 json OCRService::Infer(const cv::Mat& img) {
-    return inference_->Infer(img);
+    if (frontend_) throw std::logic_error("frontend 角色不加载模型");
+    return CurrentInference()->Infer(img);
+}
+
+json OCRService::StartProfiling(int runs, const std::vector<std::string>& models) {
+    if (frontend_) throw std::logic_error("frontend 角色不加载模型");
+    return CurrentInference()->StartProfiling(runs, models);
+}
+
+json OCRService::ProfileStatus() const {
+    if (frontend_) return json::object();
+    return CurrentInference()->ProfileStatus();
 }
 
-void OCRService::ocr_handler(const httplib::Request& req, httplib::Response& res) {
-    request_count_++;
+json OCRService::Warmup() {
+    if (frontend_ || !warmup_config_.value("enabled", true)) return json::object();
+    json report = CurrentInference()->Warmup(warmup_config_);
+    std::lock_guard<std::mutex> lock(reload_mutex_);
+    warmup_status_ = report;
+    return report;
+}
+
+json OCRService::ReloadModels(const std::string& trigger, bool wait) {
+    if (config_path_.empty()) throw std::invalid_argument("未指定配置文件路径，无法重载");
+    if (frontend_) throw std::invalid_argument("frontend 角色不加载模型，请分别重载各 worker");
+    bool expected = false;
+    if (!reload_in_progress_.compare_exchange_strong(expected, true)) {
+        throw std::logic_error("模型重载进行中");
+    }
+    if (wait) {
+        RunReload(trigger);
+        return ReloadStatus();
+    }
+    {
+        std::lock_guard<std::mutex> lock(reload_mutex_);
+        if (reload_thread_.joinable()) reload_thread_.join();  // 上一次重载已结束（in_progress 已复位）
+        reload_thread_ = std::thread(&OCRService::RunReload, this, trigger);
+    }
+    return ReloadStatus();
+}
+
+json OCRService::ReloadStatus() const {
+    std::lock_guard<std::mutex> lock(reload_mutex_);
+    json status = reload_status_;
+    status["in_progress"] = reload_in_progress_.load();
+    return status;
+}
+
+// 只替换 model 层；service 层（端口、线程池、准入等）的变更仍需重启
+void OCRService::RunReload(const std::string& trigger) {
+    auto start = std::chrono::steady_clock::now();
+    auto elapsed_ms = [](std::chrono::steady_clock::time_point since) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - since).count();
+    };
+    json result = {{"trigger", trigger}, {"started_at", static_cast<int64_t>(std::time(nullptr))}};
+    try {
+        spdlog::info("模型重载开始 (触发: {}, 配置: {})", trigger, config_path_);
+        json next_config = service_config_;
+        next_config["model"] = LoadServiceConfig(config_path_).at("model");
+
+        auto next = std::make_shared<OCRInference>(next_config);
+        result["load_ms"] = elapsed_ms(start);
+        if (warmup_config_.value("enabled", true)) {
+            json warmup = next->Warmup(warmup_config_);
+            result["warmup_ms"] = warmup["total_ms"];
+            std::lock_guard<std::mutex> lock(reload_mutex_);
+            warmup_status_ = warmup;
+        }
+
+        // 原子替换：之后的请求使用新管道；进行中的请求仍持有旧管道引用
+        std::shared_ptr<OCRInference> previous = std::atomic_exchange(&inference_, next);
+        result["swap_ms"] = elapsed_ms(start);
+        result["models"] = next->ModelVariants();
+
+        // 等待旧管道上的请求结束后在本线程释放，避免会话析构落在请求线程上
+        auto drain_start = std::chrono::steady_clock::now();
+        auto drain_deadline = drain_start + std::chrono::milliseconds(reload_config_.value("drain_timeout_ms", 60000));
+        while (previous.use_count() > 1 && std::chrono::steady_clock::now() < drain_deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        result["drained"] = previous.use_count() == 1;  // 超时则由最后一个请求释放
+        result["drain_ms"] = elapsed_ms(drain_start);
+        previous.reset();
+
+        result["status"] = "ok";
+        result["duration_ms"] = elapsed_ms(start);
+        std::lock_guard<std::mutex> lock(reload_mutex_);
+        reload_status_["generation"] = reload_status_["generation"].get<int64_t>() + 1;
+        reload_status_["loaded_at"] = static_cast<int64_t>(std::time(nullptr));
+        spdlog::info("模型重载完成 (第 {} 代, 加载 {:.0f} ms, 预热 {:.0f} ms, 排空 {:.0f} ms)",
+                     reload_status_["generation"].get<int64_t>(), result["load_ms"].get<double>(),
+                     result.value("warmup_ms", 0.0), result["drain_ms"].get<double>());
+    } catch (const std::exception& e) {
+        // 新管道加载或预热失败：保留旧管道继续服务
+        spdlog::error("模型重载失败，继续使用当前模型: {}", e.what());
+        result["status"] = "failed";
+        result["error"] = e.what();
+        result["duration_ms"] = elapsed_ms(start);
+    }
+    {
+        std::lock_guard<std::mutex> lock(reload_mutex_);
+        reload_status_["last_reload"] = result;
+    }
+    reload_in_progress_ = false;
+}
+
+// 轮询配置文件修改时间；model 层内容变化才触发重载（只改 service 层不重载）
+void OCRService::WatchConfig() {
+    auto interval = std::chrono::milliseconds(reload_config_.value("watch_interval_ms", 2000));
+    std::error_code ec;
+    auto last_write = std::filesystem::last_write_time(config_path_, ec);
+    json current_model = service_config_.at("model");
+    spdlog::info("监视配置文件: {} (间隔 {} ms)", config_path_, interval.count());
+
+    std::unique_lock<std::mutex> lock(watch_mutex_);
+    while (!watch_cv_.wait_for(lock, interval, [this] { return stopping_; })) {
+        auto write_time = std::filesystem::last_write_time(config_path_, ec);
+        if (ec || write_time == last_write) continue;
+        last_write = write_time;
+        try {
+            json model = LoadServiceConfig(config_path_).at("model");
+            if (model == current_model) continue;
+            ReloadModels("watch", false);
+            current_model = std::move(model);
+        } catch (const std::exception& e) {
+            // 重载进行中或配置不完整（编辑器写入一半）：清空修改时间，下一轮重试
+            spdlog::warn("配置变更暂不重载: {}", e.what());
+            last_write = {};
+        }
+    }
+}
+
+bool OCRService::authorize_admin(const httplib::Request& req, httplib::Response& res) const {
+    return AuthorizeAdmin(admin_token_, req, res);
+}
+
+// 请求体可选：{"wait": true} 同步等待重载完成（也可用 ?wait=1）
+void OCRService::reload_handler(const httplib::Request& req, httplib::Response& res) {
+    if (!authorize_admin(req, res)) return;
+    try {
+        json body = req.body.empty() ? json::object() : json::parse(req.body);
+        bool wait = body.value("wait", false) || req.get_param_value("wait") == "1";
+        json status = ReloadModels("admin", wait);
+        if (wait && status["last_reload"].value("status", "") != "ok") {
+            res.status = 500;  // 加载或预热失败，旧模型继续服务
+        } else {
+            res.status = wait ? 200 : 202;
+        }
+        res.set_content(status.dump(2), "application/json");
+    } catch (const json::exception& e) {
+        res.status = 400;
+        res.set_content(json{{"error", e.what()}}.dump(), "application/json");
+    } catch (const std::invalid_argument& e) {
+        res.status = 400;
+        res.set_content(json{{"error", e.what()}}.dump(), "application/json");
+    } catch (const std::logic_error& e) {
+        res.status = 409;  // 重载进行中
+        res.set_content(json{{"error", e.what()}}.dump(), "application/json");
+    } catch (const std::exception& e) {
+        spdlog::error("模型重载失败: {}", e.what());
+        res.status = 500;
+        res.set_content(json{{"error", e.what()}}.dump(), "application/json");
+    }
+}
+
+// 请求体：{"runs": 20, "models": ["det", "rec"]}；runs = 0 取消进行中的剖析
+void OCRService::profile_handler(const httplib::Request& req, httplib::Response& res) {
+    if (!authorize_admin(req, res)) return;
+    try {
+        json body = req.body.empty() ? json::object() : json::parse(req.body);
+        int runs = body.value("runs", 10);
+        if (runs < 0 || runs > 1000) throw std::invalid_argument("runs 须在 0..1000 之间");
+        auto models = body.value("models", std::vector<std::string>{"det", "rec"});
+        json status = StartProfiling(runs, models);
+        res.status = runs > 0 ? 202 : 200;  // 202：剖析结果在后续请求完成后生成
+        res.set_content(status.dump(2), "application/json");
+    } catch (const json::exception& e) {
+        res.status = 400;
+        res.set_content(json{{"error", e.what()}}.dump(), "application/json");
+    } catch (const std::invalid_argument& e) {
+        res.status = 400;
+        res.set_content(json{{"error", e.what()}}.dump(), "application/json");
+    } catch (const std::logic_error& e) {
+        res.status = 409;  // 剖析进行中
+        res.set_content(json{{"error", e.what()}}.dump(), "application/json");
+    } catch (const std::exception& e) {
+        spdlog::error("开启剖析失败: {}", e.what());
+        res.status = 500;
+        res.set_content(json{{"error", e.what()}}.dump(), "application/json");
+    }
+}
+
+void OCRService::serve_inference(const httplib::Request& req, httplib::Response& res, const std::string& label,
+                                 const std::function<void(const json& body)>& parse,
+                                 const std::function<json(RequestContext& ctx)>& run) {
+    auto arrival = AdmissionController::Clock::now();
     try {
         if (req.body.size() > max_size_) {
             res.status = 413;
             res.set_content("图像过大", "text/plain");
             return;
         }
-        json j = json::parse(req.body);
-        if (!j.contains("image_base64") || j["image_base64"].empty()) {
-            res.status = 400;
-            res.set_content("缺少 image_base64", "text/plain");
+
+        // 优先级类别：X-API-Key 映射或 X-Priority 头；队满快速拒绝，不再为注定超时的请求解码
+        int lane = admission_->ResolveLane(req.get_header_value("X-API-Key"), req.get_header_value("X-Priority"));
+        AdmissionTicket ticket(*admission_, lane);
+        if (!ticket.Enqueue()) {
+            reject_overloaded(res, "队列已满");
             return;
         }
+        {
+            ScopedStageTimer timer(Stage::kDecode);  // JSON 解析 + base64 + imdecode
+            parse(json::parse(req.body));
+        }
 
-        std::string base64_img = j["image_base64"];
-        std::string decoded = base64_decode(base64_img);
-        if (decoded.size() > max_size_) throw std::runtime_error("解码后过大");
-
-        std::vector<uchar> img_data(decoded.begin(), decoded.end());
-        cv::Mat img = cv::imdecode(img_data, cv::IMREAD_COLOR);
-        if (img.empty()) {
-            res.status = 400;
-            res.set_content("无效图像", "text/plain");
+        // 截止时间：X-Request-Timeout（毫秒，不超过 max_request_timeout_ms）或默认 timeout_ms；
+        // 排队已超时的请求在推理前丢弃
+        RequestContext ctx;
+        ctx.deadline = arrival + std::chrono::milliseconds(request_timeout_ms(req));
+        AdmissionController::Result admitted;
+        {
+            ScopedSpan span("admission_wait");
+            span.SetAttribute("class", admission_->LaneName(lane));
+            admitted = ticket.Wait(ctx.deadline);
+        }
+        if (admitted != AdmissionController::Result::kAdmitted) {
+            reject_overloaded(res, "排队超时");
             return;
         }
+        spdlog::debug("排队耗时: {} us", ticket.QueueTimeUs());
 
-        auto results = inference_->Infer(img);
-        json response {{"results", results["results"]}};
-        res.set_content(response.dump(2), "application/json");
-        spdlog::info("处理请求成功: {} 结果", results["results"].size());
+        json response = run(ctx);
+        if (ctx.timed_out) {
+            deadline_aborts_total_->Inc();
+            if (!partial_on_timeout_) {
+                res.status = 504;
+                res.set_content("推理超时", "text/plain");
+                return;
+            }
+            response["partial"] = true;
+        }
+
+        // 按 Accept 协商响应编码（JSON / MessagePack / CBOR）
+        ResponseFormat format = NegotiateFormat(req.get_header_value("Accept"));
+        std::string content_type;
+        std::string body;
+        {
+            ScopedStageTimer timer(Stage::kSerialize);
+            body = EncodeResponse(response, format, content_type);
+        }
+        res.set_content(std::move(body), content_type);
+        double latency = std::chrono::duration<double>(AdmissionController::Clock::now() - arrival).count();
+        admission_->ObserveLatency(lane, latency);
+        spdlog::info("{} 处理成功: {} 结果 (格式: {}, 类别: {}, {:.1f} ms)", label, response["results"].size(),
+                     FormatName(format), admission_->LaneName(lane), latency * 1000.0);
+    } catch (const std::invalid_argument& e) {
+        res.status = 400;  // 未知语言、缺少图像等请求参数错误
+        res.set_content(e.what(), "text/plain");
+    } catch (const json::exception& e) {
+        res.status = 400;  // 请求体不是合法 JSON 或字段类型错误
+        res.set_content("请求体无效: " + std::string(e.what()), "text/plain");
+    } catch (const WorkerError& e) {
+        errors_total_->Inc();
+        spdlog::error("worker 不可用: {}", e.what());
+        res.status = 502;  // frontend：下游 worker 全部不可达
+        res.set_content("worker 不可用: " + std::string(e.what()), "text/plain");
     } catch (const std::exception& e) {
-        error_count_++;
-        spdlog::error("处理失败: {}", e.what());
+        errors_total_->Inc();
+        spdlog::error("{} 处理失败: {}", label, e.what());
         res.status = 500;
         res.set_content("内部错误: " + std::string(e.what()), "text/plain");
     }
 }
 
+void OCRService::ocr_handler(const httplib::Request& req, httplib::Response& res, bool session) {
+    requests_total_->Inc();
+    cv::Mat img;
+    std::string encoded_image;  // frontend 原样转发给 det worker
+    InferOptions options;  // 识别语言（空 = 默认语言）、是否返回逐字符结果
+    std::string session_id;
+    auto parse = [&](const json& j) {
+        if (session && j.contains("rois")) throw std::invalid_argument("会话模式不支持 rois");
+        options = ParseInferOptions(j);
+        if (session) {
+            session_id = j.value("session_id", "");
+            if (session_id.empty() || session_id.size() > 64) throw std::invalid_argument("缺少 session_id（1~64 字符）");
+        }
+        if (!j.contains("image_base64") || j["image_base64"].empty()) throw std::invalid_argument("缺少 image_base64");
+        encoded_image = j["image_base64"].get<std::string>();
+        img = DecodeImage(encoded_image, max_size_);
+        if (img.empty()) throw std::invalid_argument("无效图像");
+    };
+    auto run = [&](RequestContext& ctx) {
+        auto inference = CurrentInference();  // 持有引用：热重载替换后本请求仍在旧管道上完成
+        json results;
+        if (frontend_) {
+            results = frontend_->Infer(img, encoded_image, &ctx, options);
+        } else if (session) {
+            // 影响结果的参数变化时会话整图重跑
+            std::string options_key = options.lang + "|" + (options.return_chars ? "chars" : "") + "|" + options.decode.dump();
+            results = sessions_->Process(session_id, img, options_key, inference,
+                                         [&](const std::vector<cv::Rect>& regions) {
+                InferOptions region_options = options;
+                region_options.det_regions = regions;
+                return inference->Infer(img, &ctx, region_options);
+            });
+        } else {
+            results = inference->Infer(img, &ctx, options);
+        }
+        json response{{"results", results["results"]}};
+        if (session) response["session"] = results["session"];
+        return response;
+    };
+    serve_inference(req, res, session ? "/ocr/session" : "/ocr", parse, run);
+}
+
+IpcReply OCRService::ipc_handler(const IpcFrame& frame) {
+    requests_total_->Inc();
+    auto arrival = AdmissionController::Clock::now();
+    const json& j = frame.options;
+    std::string request_id = SanitizeRequestId(j.value("request_id", ""));
+    ScopedTrace trace(*tracer_, request_id, "ipc_request", j.value("trace", false));
+    try {
+        int lane = admission_->ResolveLane(j.value("api_key", ""), j.value("priority", ""));
+        AdmissionTicket ticket(*admission_, lane);
+        if (!ticket.Enqueue()) {
+            spdlog::warn("共享内存请求被拒绝: 队列已满 (队列: {})", admission_->QueueDepth());
+            return {503, {{"error", "服务繁忙: 队列已满"}, {"retry_after", admission_->RetryAfterSeconds()}}};
+        }
+        InferOptions options = ParseInferOptions(j);
+        // 槽位像素直接包装成图像（零拷贝）：推理只读输入，结果返回前客户端不会改写该槽位
+        cv::Mat img(frame.height, frame.width, CV_8UC3, const_cast<uint8_t*>(frame.pixels), frame.stride);
+
+        // 截止时间：选项 timeout_ms（不超过 max_request_timeout_ms）或默认 timeout_ms
+        int requested = j.value("timeout_ms", 0);
+        RequestContext ctx;
+        ctx.deadline = arrival + std::chrono::milliseconds(requested > 0 ? std::min(requested, max_request_timeout_ms_)
+                                                                          : timeout_ms_);
+        AdmissionController::Result admitted;
+        {
+            ScopedSpan span("admission_wait");
+            span.SetAttribute("class", admission_->LaneName(lane));
+            admitted = ticket.Wait(ctx.deadline);
+        }
+        if (admitted != AdmissionController::Result::kAdmitted) {
+            return {503, {{"error", "服务繁忙: 排队超时"}, {"retry_after", admission_->RetryAfterSeconds()}}};
+        }
+
+        json results = CurrentInference()->Infer(img, &ctx, options);
+        if (ctx.timed_out) {
+            deadline_aborts_total_->Inc();
+            if (!partial_on_timeout_) return {504, {{"error", "推理超时"}}};
+        }
+        json response{{"results", results["results"]}};
+        if (ctx.timed_out) response["partial"] = true;
+        double latency = std::chrono::duration<double>(AdmissionController::Clock::now() - arrival).count();
+        admission_->ObserveLatency(lane, latency);
+        spdlog::info("共享内存请求成功: {} 结果 ({}x{}, 类别: {}, {:.1f} ms)", response["results"].size(), frame.width,
+                     frame.height, admission_->LaneName(lane), latency * 1000.0);
+        return {200, std::move(response)};
+    } catch (const std::invalid_argument& e) {
+        return {400, {{"error", e.what()}}};
+    } catch (const std::exception& e) {
+        errors_total_->Inc();
+        spdlog::error("共享内存请求处理失败: {}", e.what());
+        return {500, {{"error", e.what()}}};
+    }
+}
+
+void OCRService::stage_handler(const httplib::Request& req, httplib::Response& res, bool detect) {
+    const char* endpoint = detect ? "det" : "rec";
+    MetricsRegistry::Instance()
+        .GetCounter("ocr_stage_requests_total", "Detection-only / recognition-only requests", std::string("endpoint=\"") + endpoint + "\"")
+        .Inc();
+    // 单图 "image_base64" 或多图 "images"；响应 results 与输入一一对应
+    std::vector<cv::Mat> images;
+    InferOptions options;
+    auto parse = [&](const json& j) {
+        options.lang = j.value("lang", "");
+        options.return_chars = j.value("return_chars", false);
+        if (j.contains("decode")) options.decode = j["decode"];
+        images = DecodeStageImages(j, detect ? kMaxDetImages : kMaxRecImages, max_size_);
+    };
+    auto run = [&](RequestContext& ctx) {
+        auto inference = CurrentInference();
+        json results = detect ? inference->Detect(images, &ctx, options.lang) : inference->Recognize(images, &ctx, options);
+        return json{{"results", results["results"]}};
+    };
+    serve_inference(req, res, std::string("/") + endpoint, parse, run);
+}
+
+int OCRService::request_timeout_ms(const httplib::Request& req) const {
+    if (!req.has_header("X-Request-Timeout")) return timeout_ms_;
+    try {
+        int requested = std::stoi(req.get_header_value("X-Request-Timeout"));
+        if (requested > 0) return std::min(requested, max_request_timeout_ms_);
+    } catch (const std::exception&) {
+        // 非法值忽略，使用默认
+    }
+    spdlog::warn("X-Request-Timeout 无效: {}", req.get_header_value("X-Request-Timeout"));
+    return timeout_ms_;
+}
+
+void OCRService::reject_overloaded(httplib::Response& res, const std::string& reason) {
+    int retry_after = admission_->RetryAfterSeconds();
+    spdlog::warn("请求被拒绝: {} (队列: {}, Retry-After: {}s)", reason, admission_->QueueDepth(), retry_after);
+    res.status = 503;
+    res.set_header("Retry-After", std::to_string(retry_after));
+    res.set_content("服务繁忙: " + reason, "text/plain");
+}
+
 void OCRService::info_handler(const httplib::Request&, httplib::Response& res) {
     try {
         json info = GetInfo();
@@ -127,13 +767,20 @@ json OCRService::GetInfo() {
         {"git_version", GIT_VERSION},
         {"build_time", BUILD_TIME}
     };
+    info["role"] = role_;
+    if (frontend_) {  // 不加载模型：模型信息见各 worker 的 /info
+        info["workers"] = frontend_->Status();
+        info["ready"] = ready_.load();
+        return info;
+    }
 
-    // 模型信息
-    auto model_layer = service_config_.at("model");
+    // 模型信息（取当前管道，热重载后即为新配置）
+    auto inference = CurrentInference();
+    auto model_layer = inference->Config().at("model");
     json models;
-    auto det_config = model_layer.at("det_model");
-    std::string det_path = det_config.at("path");
-    models["det"] = {{"path", det_path}};
+    const json& variants = inference->ModelVariants();  // 实际加载的路径（FP32 / INT8）
+    std::string det_path = variants.at("det").at("path");
+    models["det"] = variants.at("det");
     // 读取 ONNX metadata
     try {
         Ort::Env env(ORT_LOGGING_LEVEL_WARNING, "Info");
@@ -150,9 +797,8 @@ json OCRService::GetInfo() {
     }
 
     // Rec 类似
-    auto rec_config = model_layer.at("rec_model");
-    std::string rec_path = rec_config.at("path");
-    models["rec"] = {{"path", rec_path}};
+    std::string rec_path = variants.at("rec").at("path");
+    models["rec"] = variants.at("rec");
     try {
         Ort::Env env(ORT_LOGGING_LEVEL_WARNING, "Info");
         Ort::SessionOptions opts;
@@ -167,29 +813,25 @@ json OCRService::GetInfo() {
         models["rec"]["op_version"] = -1;
     }
 
+    // 加载方式与各模型的 RSS 增量；memory 为进程 RSS 与仍在映射中的模型文件
+    json load_info = inference->LoadInfo();
+    models["det"]["load"] = load_info["det"];
+    models["rec"]["load"] = load_info["rec"];
+    info["memory"] = ModelLoader::Instance().Stats();
+
     // Dict
     auto dict_config = model_layer.at("character_dict");
     models["dict"] = {{"path", dict_config.at("path")}, {"version", "v1"}};
 
     info["models"] = models;
+    info["languages"] = inference->LanguageStatus();  // 各语言是否常驻、加载次数
+    info["sessions"] = sessions_->Stats();  // 增量 OCR 会话数
+    if (ipc_) info["ipc"] = ipc_->Stats();  // 共享内存摄取：连接数、已处理帧数
+    info["reload"] = ReloadStatus();  // generation（每次重载 +1）与最近一次重载耗时
+    info["ready"] = ready_.load();
+    {
+        std::lock_guard<std::mutex> lock(reload_mutex_);
+        info["warmup"] = warmup_status_;  // 各形状预热耗时
+    }
     return info;
 }
-
-std::string OCRService::base64_decode(const std::string& encoded) {
-    // 完整 Base64 解码（处理 padding）
-    static const std::string chars = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
-    std::string decoded;
-    int val = 0, valb = -8;
-    for (char c : encoded) {
-        if (c == '=') break;  // padding
-        size_t pos = chars.find(c);
-        if (pos == std::string::npos) continue;
-        val = (val << 6) + static_cast<int>(pos);
-        valb += 6;
-        if (valb >= 0) {
-            decoded.push_back(static_cast<char>((val >> valb) & 0xFF));
-            valb -= 8;
-        }
-    }
-    return decoded;
-}
\ No newline at end of file
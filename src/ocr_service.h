@@ -2,31 +2,116 @@
 #define OCR_SERVICE_H
 
 #include "ocr_inference.h"
+#include "ocr_admission.h"
+#include "ocr_metrics.h"
+#include "ocr_trace.h"
+#include "ocr_session.h"
+#include "ocr_workers.h"
+#include "ocr_ipc.h"
 #include <httplib.h>
 #include <json.hpp>
-#include <string>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
 #include <mutex>
+#include <string>
+#include <thread>
 
 using json = nlohmann::json;
 
+// /det、/rec 单次请求的图像数上限（一次请求内拼批，超过需客户端拆分）
+constexpr size_t kMaxDetImages = 16;
+constexpr size_t kMaxRecImages = 64;
+
+// base64 → BGR 图像（无效数据返回空）；total_bytes 累计多图解码后的总大小，超过 max_bytes 抛 std::invalid_argument
+cv::Mat DecodeImage(const std::string& base64_img, size_t max_bytes, size_t* total_bytes = nullptr);
+// /det、/rec 请求体中的图像：单图 "image_base64" 或多图 "images"（至多 limit 张）；
+// 缺失、类型错误、超量、无法解码或总大小超过 max_bytes 抛 std::invalid_argument（消息指明下标）
+std::vector<cv::Mat> DecodeStageImages(const json& body, size_t limit, size_t max_bytes);
+
+// X-Admin-Token 校验（admin_token 为空时不校验）；失败写 401 并返回 false
+bool AuthorizeAdmin(const std::string& admin_token, const httplib::Request& req, httplib::Response& res);
+// DELETE /ocr/session/:id：与 /admin/* 同样需 X-Admin-Token，防止他人猜出会话 ID 后删除；204 已删除，404 不存在
+void DeleteSession(OCRSessionStore& sessions, const std::string& admin_token, const httplib::Request& req,
+                   httplib::Response& res);
+
 class OCRService {
 public:
-    OCRService(const json& service_config);
+    // config_path：热重载时重新读取的配置文件（空 = 不支持重载）
+    OCRService(const json& service_config, const std::string& config_path = "");
+    ~OCRService();
     void StartServer();
     json Infer(const cv::Mat& img);  // 暴露 for CLI
+    json StartProfiling(int runs, const std::vector<std::string>& models = {"det", "rec"});  // 暴露 for CLI --profile
+    json ProfileStatus() const;
+    // 从 config_path 重新加载 model 层：后台建新管道并预热，原子替换后等待旧管道上的请求结束再释放。
+    // wait = false 时立即返回（202）；已有重载进行中抛 logic_error
+    json ReloadModels(const std::string& trigger, bool wait);
+    json ReloadStatus() const;
+    // 启动预热（service.warmup）：完成前 /ready 返回 503，/health 不受影响
+    json Warmup();
+    bool Ready() const { return ready_; }
 
 private:
-    std::unique_ptr<OCRInference> inference_;
+    // RCU：请求处理时 atomic_load 取一份引用，重载时 atomic_store 新管道，旧管道随最后一个引用释放
+    std::shared_ptr<OCRInference> inference_;
+    std::unique_ptr<AdmissionController> admission_;  // 推理前有界队列
+    std::unique_ptr<TraceExporter> tracer_;           // 请求追踪采样与导出
+    std::unique_ptr<OCRSessionStore> sessions_;       // 截图流增量 OCR 会话（/ocr/session）
+    // service.role：all（单进程）| det / rec（阶段 worker，只加载并提供本阶段）| frontend（不加载模型，转发给 worker）
+    std::string role_;
+    std::unique_ptr<OCRFrontend> frontend_;           // 仅 role = frontend；此时 inference_ 为空
+    std::unique_ptr<IpcServer> ipc_;                  // 共享内存摄取（service.ipc.enabled）
     json service_config_;
     size_t max_size_;
-    size_t request_count_ = 0;
-    size_t error_count_ = 0;
-    std::mutex metrics_mutex_;
+    int timeout_ms_;              // 默认请求截止时间
+    int max_request_timeout_ms_;  // X-Request-Timeout 上限
+    bool partial_on_timeout_;     // 超时策略：true 返回部分结果，false 返回 504
+    std::string admin_token_;     // /admin/* 的 X-Admin-Token（空 = 不校验）
+    // 注册表中的计数器（分片原子计数，无需加锁）
+    Counter* requests_total_;
+    Counter* errors_total_;
+    Counter* deadline_aborts_total_;
+
+    // 热重载
+    std::string config_path_;
+    json reload_config_;                     // service.reload：watch_config / watch_interval_ms / drain_timeout_ms
+    std::atomic<bool> reload_in_progress_{false};
+    mutable std::mutex reload_mutex_;        // 保护 reload_status_ / warmup_status_ / reload_thread_
+    json reload_status_;                     // generation、最近一次重载结果
+    json warmup_config_;                     // service.warmup
+    json warmup_status_;                     // 最近一次预热报告（启动或重载）
+    std::atomic<bool> ready_{false};
+    std::thread warmup_thread_;
+    std::thread reload_thread_;
+    std::thread watch_thread_;               // 配置文件监视（轮询修改时间）
+    std::mutex watch_mutex_;
+    std::condition_variable watch_cv_;
+    bool stopping_ = false;
+
+    std::shared_ptr<OCRInference> CurrentInference() const { return std::atomic_load(&inference_); }
+    void RunReload(const std::string& trigger);
+    void WatchConfig();
 
-    void ocr_handler(const httplib::Request& req, httplib::Response& res);
+    // /ocr、/ocr/session、/det、/rec 共用流程：体积检查 → 准入排队 → parse(请求体) → 等待准入 → run(ctx) 得到响应 →
+    // 超时策略（504 / partial）→ 按 Accept 编码；invalid_argument 与 JSON 错误 400，WorkerError 502，其余 500
+    void serve_inference(const httplib::Request& req, httplib::Response& res, const std::string& label,
+                         const std::function<void(const json& body)>& parse,
+                         const std::function<json(RequestContext& ctx)>& run);
+    // session = true：/ocr/session，按 session_id 与上一帧比对，只识别变化区域
+    void ocr_handler(const httplib::Request& req, httplib::Response& res, bool session = false);
+    // 共享内存摄取的一帧：选项同 /ocr 请求体（另有 timeout_ms / priority / api_key / request_id / trace）
+    IpcReply ipc_handler(const IpcFrame& frame);
+    // /det（detect = true）与 /rec：单图 image_base64 或多图 images，一次请求内拼批
+    void stage_handler(const httplib::Request& req, httplib::Response& res, bool detect);
     void info_handler(const httplib::Request& req, httplib::Response& res);  // 新增 /info
+    void profile_handler(const httplib::Request& req, httplib::Response& res);  // POST /admin/profile
+    void reload_handler(const httplib::Request& req, httplib::Response& res);   // POST /admin/reload
+    bool authorize_admin(const httplib::Request& req, httplib::Response& res) const;  // 失败即 401
     json GetInfo();  // 内部：收集版本/模型信息
-    std::string base64_decode(const std::string& encoded);
+    void reject_overloaded(httplib::Response& res, const std::string& reason);  // 503 + Retry-After
+    int request_timeout_ms(const httplib::Request& req) const;  // 默认或 X-Request-Timeout
 };
 
 #endif // OCR_SERVICE_H
\ No newline at end of file
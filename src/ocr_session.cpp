@@ -0,0 +1,285 @@
+#include "ocr_session.h"
+#include "ocr_metrics.h"
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+constexpr uint64_t kHashSeed = 0xcbf29ce484222325ULL;
+constexpr uint64_t kHashPrime = 0x9E3779B97F4A7C15ULL;
+
+// 8 字节一组的乘法 - 移位混合（逐字节 FNV 对整屏截图太慢）
+uint64_t HashBytes(uint64_t h, const uint8_t* data, size_t len) {
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, data + i, 8);
+        h = (h ^ word) * kHashPrime;
+        h ^= h >> 32;
+    }
+    for (; i < len; ++i) h = (h ^ data[i]) * kHashPrime;
+    return h;
+}
+
+bool Overlaps(const cv::Rect& a, const cv::Rect& b) {
+    return a.x < b.x + b.width && b.x < a.x + a.width && a.y < b.y + b.height && b.y < a.y + a.height;
+}
+
+// 反复合并相交的区域，直到两两不相交
+void MergeOverlapping(std::vector<cv::Rect>& regions) {
+    bool merged = true;
+    while (merged) {
+        merged = false;
+        for (size_t i = 0; i < regions.size() && !merged; ++i) {
+            for (size_t j = i + 1; j < regions.size(); ++j) {
+                if (!Overlaps(regions[i], regions[j])) continue;
+                regions[i] |= regions[j];
+                regions.erase(regions.begin() + static_cast<std::ptrdiff_t>(j));
+                merged = true;
+                break;
+            }
+        }
+    }
+}
+
+cv::Rect BoxRect(const json& result) {
+    const auto& b = result.at("bbox");  // [x1,y1,x2,y2]
+    int x1 = static_cast<int>(std::floor(b[0].get<double>())), y1 = static_cast<int>(std::floor(b[1].get<double>()));
+    int x2 = static_cast<int>(std::ceil(b[2].get<double>())), y2 = static_cast<int>(std::ceil(b[3].get<double>()));
+    return cv::Rect(cv::Point(x1, y1), cv::Point(x2, y2));
+}
+
+bool IntersectsAny(const cv::Rect& box, const std::vector<cv::Rect>& regions) {
+    return std::any_of(regions.begin(), regions.end(), [&](const cv::Rect& r) { return Overlaps(box, r); });
+}
+
+Counter& FramesCounter(const std::string& mode) {
+    return MetricsRegistry::Instance().GetCounter("ocr_session_frames_total", "Session OCR frames by processing mode",
+                                                  "mode=\"" + mode + "\"");
+}
+
+}  // namespace
+
+TileHashes HashTiles(const cv::Mat& img, int tile) {
+    if (tile <= 0) throw std::invalid_argument("tile_size 必须为正");
+    TileHashes result;
+    result.tile = tile;
+    result.frame = img.size();
+    result.cols = (img.cols + tile - 1) / tile;
+    result.rows = (img.rows + tile - 1) / tile;
+    result.hashes.assign(static_cast<size_t>(result.cols) * result.rows, kHashSeed);
+    size_t pixel_bytes = img.elemSize();
+    // 逐行扫描（内存顺序），每行按块切段累加到对应块的哈希
+    for (int y = 0; y < img.rows; ++y) {
+        const uint8_t* row = img.ptr<uint8_t>(y);
+        uint64_t* band = result.hashes.data() + static_cast<size_t>(y / tile) * result.cols;
+        for (int tx = 0; tx < result.cols; ++tx) {
+            int x0 = tx * tile;
+            int width = std::min(tile, img.cols - x0);
+            band[tx] = HashBytes(band[tx], row + x0 * pixel_bytes, width * pixel_bytes);
+        }
+    }
+    return result;
+}
+
+std::vector<cv::Rect> DirtyRegions(const TileHashes& previous, const TileHashes& current, int margin,
+                                   size_t* dirty_tiles) {
+    cv::Rect frame(0, 0, current.frame.width, current.frame.height);
+    if (previous.tile != current.tile || previous.frame != current.frame) {
+        if (dirty_tiles) *dirty_tiles = current.hashes.size();
+        return {frame};
+    }
+
+    std::vector<uint8_t> dirty(current.hashes.size());
+    size_t count = 0;
+    for (size_t i = 0; i < dirty.size(); ++i) {
+        dirty[i] = previous.hashes[i] != current.hashes[i];
+        count += dirty[i];
+    }
+    if (dirty_tiles) *dirty_tiles = count;
+
+    // 8 连通分量（块网格上的 flood fill），每个分量取外接矩形
+    std::vector<cv::Rect> regions;
+    std::vector<int> stack;
+    for (size_t start = 0; start < dirty.size(); ++start) {
+        if (!dirty[start]) continue;
+        int min_x = current.cols, min_y = current.rows, max_x = -1, max_y = -1;
+        dirty[start] = 0;
+        stack.push_back(static_cast<int>(start));
+        while (!stack.empty()) {
+            int index = stack.back();
+            stack.pop_back();
+            int tx = index % current.cols, ty = index / current.cols;
+            min_x = std::min(min_x, tx);
+            max_x = std::max(max_x, tx);
+            min_y = std::min(min_y, ty);
+            max_y = std::max(max_y, ty);
+            for (int dy = -1; dy <= 1; ++dy) {
+                for (int dx = -1; dx <= 1; ++dx) {
+                    int nx = tx + dx, ny = ty + dy;
+                    if (nx < 0 || ny < 0 || nx >= current.cols || ny >= current.rows) continue;
+                    int neighbor = ny * current.cols + nx;
+                    if (!dirty[neighbor]) continue;
+                    dirty[neighbor] = 0;
+                    stack.push_back(neighbor);
+                }
+            }
+        }
+        cv::Rect region(min_x * current.tile - margin, min_y * current.tile - margin,
+                        (max_x - min_x + 1) * current.tile + 2 * margin, (max_y - min_y + 1) * current.tile + 2 * margin);
+        region &= frame;
+        if (region.area() > 0) regions.push_back(region);
+    }
+    MergeOverlapping(regions);
+    return regions;
+}
+
+OCRSessionStore::OCRSessionStore(const json& config)
+    : tile_size_(config.value("tile_size", 32)),
+      margin_(config.value("margin", 16)),
+      full_frame_ratio_(config.value("full_frame_ratio", 0.5)),
+      max_sessions_(config.value("max_sessions", 64)),
+      ttl_(config.value("ttl_s", 300)) {
+    if (tile_size_ < 8) throw std::invalid_argument("sessions.tile_size 不能小于 8");
+    if (margin_ < 0) throw std::invalid_argument("sessions.margin 不能为负");
+    if (max_sessions_ == 0) throw std::invalid_argument("sessions.max_sessions 必须为正");
+    evicted_ = &MetricsRegistry::Instance().GetCounter("ocr_sessions_evicted_total",
+                                                       "OCR sessions dropped by TTL expiry or the max_sessions cap");
+}
+
+std::shared_ptr<OCRSessionStore::Session> OCRSessionStore::Acquire(const std::string& id) {
+    auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(mutex_);
+    // 过期会话随访问清理（处理中的会话由调用方引用保活）
+    for (auto it = sessions_.begin(); it != sessions_.end();) {
+        if (it->first != id && now - it->second->last_used > ttl_) {
+            it = sessions_.erase(it);
+            evicted_->Inc();
+        } else {
+            ++it;
+        }
+    }
+    auto& session = sessions_[id];
+    if (!session) {
+        if (sessions_.size() > max_sessions_) {  // 新会话已插入：淘汰最久未用的其他会话
+            auto oldest = sessions_.end();
+            for (auto it = sessions_.begin(); it != sessions_.end(); ++it) {
+                if (it->first == id) continue;
+                if (oldest == sessions_.end() || it->second->last_used < oldest->second->last_used) oldest = it;
+            }
+            if (oldest != sessions_.end()) {
+                sessions_.erase(oldest);
+                evicted_->Inc();
+            }
+        }
+        session = std::make_shared<Session>();
+    }
+    session->last_used = now;
+    return session;
+}
+
+json OCRSessionStore::Process(const std::string& id, const cv::Mat& img, const std::string& options_key,
+                              const std::shared_ptr<const void>& pipeline, const RunFn& run) {
+    std::shared_ptr<Session> session = Acquire(id);
+    std::lock_guard<std::mutex> lock(session->mutex);
+
+    TileHashes tiles = HashTiles(img, tile_size_);
+    size_t tile_count = tiles.hashes.size();
+    auto same_pipeline = [&] {
+        return !session->pipeline.owner_before(pipeline) && !pipeline.owner_before(session->pipeline);
+    };
+    bool reusable = session->valid && session->options_key == options_key && same_pipeline() &&
+                    session->tiles.frame == tiles.frame;
+
+    std::string mode = "full";
+    std::vector<cv::Rect> regions;
+    size_t dirty_tiles = tiles.hashes.size();
+    if (reusable) {
+        regions = DirtyRegions(session->tiles, tiles, margin_, &dirty_tiles);
+        // 区域外扩到覆盖与之相交的旧文本框，使跨区域边界的行整行重识别；外扩可能引入新的相交，迭代到稳定
+        bool grown = true;
+        while (grown && !regions.empty()) {
+            grown = false;
+            for (auto& region : regions) {
+                for (const auto& result : session->results) {
+                    cv::Rect box = BoxRect(result) & cv::Rect(0, 0, img.cols, img.rows);
+                    if (!Overlaps(box, region) || (region & box) == box) continue;
+                    region |= box;
+                    grown = true;
+                }
+            }
+            if (grown) MergeOverlapping(regions);
+        }
+        double area = 0.0;
+        for (const auto& region : regions) area += region.area();
+        if (regions.empty()) mode = "unchanged";
+        else if (area <= full_frame_ratio_ * img.cols * img.rows) mode = "incremental";
+    }
+
+    json response;
+    size_t reused = 0;
+    if (mode == "unchanged") {
+        response["results"] = session->results;
+        reused = session->results.size();
+    } else if (mode == "incremental") {
+        response = run(regions);
+        json merged = json::array();
+        for (const auto& result : session->results) {
+            if (IntersectsAny(BoxRect(result), regions)) continue;
+            merged.push_back(result);
+            ++reused;
+        }
+        for (auto& result : response["results"]) merged.push_back(std::move(result));
+        std::stable_sort(merged.begin(), merged.end(), [](const json& a, const json& b) {
+            return a["bbox"][1].get<double>() < b["bbox"][1].get<double>();  // top-to-bottom，与整图一致
+        });
+        response["results"] = std::move(merged);
+    } else {
+        regions.clear();
+        response = run({});
+    }
+
+    // 超时的部分结果不缓存，下一帧整图重跑
+    session->valid = !response.value("partial", false);
+    if (session->valid) {
+        session->tiles = std::move(tiles);
+        session->results = response["results"];
+        session->options_key = options_key;
+        session->pipeline = pipeline;
+    }
+    ++session->frames;
+    FramesCounter(mode).Inc();
+
+    json region_list = json::array();
+    for (const auto& r : regions) region_list.push_back({r.x, r.y, r.width, r.height});
+    response["session"] = {
+        {"id", id},
+        {"frame", session->frames},
+        {"mode", mode},
+        {"tiles", tile_count},
+        {"dirty_tiles", dirty_tiles},
+        {"regions", region_list},
+        {"reused", reused}
+    };
+    spdlog::debug("会话 {} 第 {} 帧: {} (变化块 {}, 区域 {}, 复用 {} 个结果)", id, session->frames, mode, dirty_tiles,
+                  regions.size(), reused);
+    return response;
+}
+
+bool OCRSessionStore::Erase(const std::string& id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return sessions_.erase(id) > 0;
+}
+
+json OCRSessionStore::Stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return {
+        {"active", sessions_.size()},
+        {"max_sessions", max_sessions_},
+        {"ttl_s", ttl_.count()},
+        {"tile_size", tile_size_}
+    };
+}
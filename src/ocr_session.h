@@ -0,0 +1,79 @@
+#ifndef OCR_SESSION_H
+#define OCR_SESSION_H
+
+#include <opencv2/opencv.hpp>
+#include <json.hpp>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using json = nlohmann::json;
+
+class Counter;
+
+// 分块哈希：图像按 tile × tile 切块，每块一个 64 位哈希（行优先；右 / 下边缘块可能不足 tile）
+struct TileHashes {
+    int tile = 0;
+    int cols = 0, rows = 0;  // 块网格
+    cv::Size frame;          // 图像尺寸
+    std::vector<uint64_t> hashes;
+};
+
+TileHashes HashTiles(const cv::Mat& img, int tile);
+
+// 两帧之间变化的块合并成互不相交的像素区域：相邻（8 连通）变化块取外接矩形，外扩 margin 像素后裁剪到图像内，
+// 重叠区域再合并。两帧尺寸或块大小不同时返回整图。dirty_tiles 返回变化块数
+std::vector<cv::Rect> DirtyRegions(const TileHashes& previous, const TileHashes& current, int margin,
+                                   size_t* dirty_tiles = nullptr);
+
+// 截图流的增量 OCR 会话（service.sessions）：按客户端会话保留上一帧的块哈希与结果，
+// 新帧只对变化区域跑 det / rec，未变化区域沿用缓存结果。
+//   full：首帧、尺寸 / 请求参数 / 模型（热重载）变化，或变化面积超过 full_frame_ratio
+//   incremental：变化区域外扩到覆盖与之相交的旧文本框（行不被切开），区域内旧结果丢弃后与新结果合并
+//   unchanged：无变化块，直接返回缓存结果
+// 会话按 ttl_s 过期，超过 max_sessions 时淘汰最久未用的会话
+class OCRSessionStore {
+public:
+    // 对给定区域运行 OCR（空 = 整图），返回 Infer 响应（results 为整图坐标，可带 partial）
+    using RunFn = std::function<json(const std::vector<cv::Rect>& regions)>;
+
+    explicit OCRSessionStore(const json& config);
+
+    // 同一会话的帧串行处理；返回 {"results", "partial"?, "session": {id, frame, mode, tiles, dirty_tiles, regions, reused}}。
+    // options_key 为影响结果的请求参数（语言 / 解码等），pipeline 为当前推理管道（热重载后旧缓存失效）
+    json Process(const std::string& id, const cv::Mat& img, const std::string& options_key,
+                 const std::shared_ptr<const void>& pipeline, const RunFn& run);
+    bool Erase(const std::string& id);
+    json Stats() const;
+
+private:
+    struct Session {
+        std::mutex mutex;
+        bool valid = false;  // 缓存可复用（超时的部分结果不缓存）
+        TileHashes tiles;
+        json results;
+        std::string options_key;
+        std::weak_ptr<const void> pipeline;
+        uint64_t frames = 0;
+        std::chrono::steady_clock::time_point last_used;
+    };
+
+    int tile_size_;
+    int margin_;
+    double full_frame_ratio_;
+    size_t max_sessions_;
+    std::chrono::seconds ttl_;
+
+    mutable std::mutex mutex_;  // 保护 sessions_
+    std::map<std::string, std::shared_ptr<Session>> sessions_;
+    Counter* evicted_;
+
+    std::shared_ptr<Session> Acquire(const std::string& id);
+};
+
+#endif // OCR_SESSION_H
@@ -0,0 +1,248 @@
+#include "ocr_trace.h"
+#include <spdlog/spdlog.h>
+#include <spdlog/pattern_formatter.h>
+#include <atomic>
+#include <cctype>
+#include <cstdio>
+#include <filesystem>
+#include <random>
+#include <stdexcept>
+
+namespace {
+
+thread_local Trace* current_trace = nullptr;
+
+uint64_t RandomU64() {
+    thread_local std::mt19937_64 rng(std::random_device{}() ^
+                                     static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count()));
+    return rng();
+}
+
+std::string Hex64(uint64_t value) {
+    char buf[17];
+    std::snprintf(buf, sizeof(buf), "%016llx", static_cast<unsigned long long>(value));
+    return buf;
+}
+
+// 线程编号：进程内从 1 递增，比系统线程 ID 更易读
+uint32_t ThreadIndex() {
+    static std::atomic<uint32_t> next{1};
+    thread_local uint32_t index = next++;
+    return index;
+}
+
+json OtlpAttributes(const std::vector<std::pair<const char*, std::string>>& attributes) {
+    json result = json::array();
+    for (const auto& [key, value] : attributes) {
+        result.push_back({{"key", key}, {"value", {{"stringValue", value}}}});
+    }
+    return result;
+}
+
+class RequestIdFlag : public spdlog::custom_flag_formatter {
+public:
+    void format(const spdlog::details::log_msg&, const std::tm&, spdlog::memory_buf_t& dest) override {
+        const std::string& id = CurrentRequestId();
+        dest.append(id.data(), id.data() + id.size());
+    }
+    std::unique_ptr<custom_flag_formatter> clone() const override { return std::make_unique<RequestIdFlag>(); }
+};
+
+}  // namespace
+
+Trace::Trace(std::string request_id, bool recording)
+    : request_id_(std::move(request_id)), recording_(recording), sampled_(false), start_(Clock::now()) {
+    start_unix_us_ = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    if (recording_) {
+        trace_id_ = Hex64(RandomU64()) + Hex64(RandomU64());
+        span_id_base_ = RandomU64() & ~0xFFFFull;
+        spans_.reserve(32);
+    } else {
+        span_id_base_ = 0;
+    }
+}
+
+int Trace::BeginSpan(const char* name) {
+    int64_t start = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start_).count();
+    spans_.push_back({name, current_, start, -1, ThreadIndex(), {}});
+    current_ = static_cast<int>(spans_.size()) - 1;
+    return current_;
+}
+
+void Trace::EndSpan(int index) {
+    auto& span = spans_[index];
+    span.duration_us = ElapsedUs() - span.start_us;
+    current_ = span.parent;
+}
+
+void Trace::SetAttribute(int index, const char* key, std::string value) {
+    spans_[index].attributes.emplace_back(key, std::move(value));
+}
+
+int64_t Trace::ElapsedUs() const {
+    return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start_).count();
+}
+
+json Trace::ToChromeEvents() const {
+    json events = json::array();
+    for (const auto& span : spans_) {
+        json args = {{"request_id", request_id_}};
+        for (const auto& [key, value] : span.attributes) args[key] = value;
+        events.push_back({
+            {"name", span.name},
+            {"cat", "ocr"},
+            {"ph", "X"},
+            {"ts", start_unix_us_ + span.start_us},
+            {"dur", span.duration_us < 0 ? 0 : span.duration_us},
+            {"pid", 1},
+            {"tid", span.thread_index},
+            {"args", args}
+        });
+    }
+    return events;
+}
+
+json Trace::ToOtlp(const std::string& service_name) const {
+    json spans = json::array();
+    for (size_t i = 0; i < spans_.size(); ++i) {
+        const auto& span = spans_[i];
+        int64_t start_ns = (start_unix_us_ + span.start_us) * 1000;
+        int64_t end_ns = start_ns + (span.duration_us < 0 ? 0 : span.duration_us) * 1000;
+        json attributes = OtlpAttributes(span.attributes);
+        attributes.push_back({{"key", "thread.id"}, {"value", {{"intValue", std::to_string(span.thread_index)}}}});
+        json otlp_span = {
+            {"traceId", trace_id_},
+            {"spanId", Hex64(span_id_base_ + i)},
+            {"name", span.name},
+            {"kind", span.parent < 0 ? 2 : 1},  // SPAN_KIND_SERVER / SPAN_KIND_INTERNAL
+            {"startTimeUnixNano", std::to_string(start_ns)},  // OTLP JSON 中 64 位整数编码为字符串
+            {"endTimeUnixNano", std::to_string(end_ns)},
+            {"attributes", attributes}
+        };
+        if (span.parent >= 0) otlp_span["parentSpanId"] = Hex64(span_id_base_ + span.parent);
+        spans.push_back(std::move(otlp_span));
+    }
+    json resource_attributes = OtlpAttributes({{"service.name", service_name}, {"request.id", request_id_}});
+    return {{"resourceSpans", json::array({{
+        {"resource", {{"attributes", resource_attributes}}},
+        {"scopeSpans", json::array({{{"scope", {{"name", "ocr_trace"}}}, {"spans", spans}}})}
+    }})}};
+}
+
+Trace* CurrentTrace() {
+    return current_trace;
+}
+
+const std::string& CurrentRequestId() {
+    static const std::string kNone = "-";
+    return current_trace ? current_trace->RequestId() : kNone;
+}
+
+TraceExporter::TraceExporter(const json& tracing_config, std::string service_name)
+    : service_name_(std::move(service_name)) {
+    sample_rate_ = tracing_config.value("sample_rate", 0.0);
+    if (sample_rate_ < 0.0 || sample_rate_ > 1.0) throw std::invalid_argument("tracing.sample_rate 须在 0..1 之间");
+    slow_threshold_us_ = static_cast<int64_t>(tracing_config.value("slow_threshold_ms", 0.0) * 1000.0);
+    allow_force_header_ = tracing_config.value("allow_force_header", false);
+    std::string format = tracing_config.value("format", "chrome");
+    if (format == "chrome") {
+        format_ = Format::kChrome;
+    } else if (format == "otlp") {
+        format_ = Format::kOtlp;
+    } else {
+        throw std::invalid_argument("tracing.format 必须为 chrome 或 otlp: " + format);
+    }
+    output_path_ = tracing_config.value("output", format_ == Format::kChrome ? "logs/traces.json" : "logs/traces.otlp.jsonl");
+    bool enabled = sample_rate_ > 0.0 || slow_threshold_us_ > 0 || allow_force_header_;
+    if (enabled) {
+        spdlog::info("请求追踪: sample_rate {}, slow_threshold_ms {}, 格式 {}, 输出 {}", sample_rate_,
+                     slow_threshold_us_ / 1000.0, format, output_path_);
+    }
+}
+
+bool TraceExporter::ShouldSample(bool force) const {
+    if (force && allow_force_header_) return true;
+    if (sample_rate_ <= 0.0) return false;
+    if (sample_rate_ >= 1.0) return true;
+    return static_cast<double>(RandomU64() >> 11) * 0x1.0p-53 < sample_rate_;
+}
+
+void TraceExporter::Finish(Trace& trace) {
+    if (!trace.Recording()) return;
+    if (!trace.Sampled() && slow_threshold_us_ > 0 && trace.ElapsedUs() >= slow_threshold_us_) trace.SetSampled(true);
+    if (!trace.Sampled()) return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    try {
+        Write(trace);
+        ++exported_;
+    } catch (const std::exception& e) {
+        spdlog::warn("trace 写入失败: {}", e.what());
+    }
+}
+
+// Chrome：JSON 数组格式，末尾的 ] 可省略，便于持续追加（chrome://tracing / Perfetto 均可直接打开）；
+// OTLP：每行一个 ExportTraceServiceRequest（与 OpenTelemetry 文件导出器一致）
+void TraceExporter::Write(const Trace& trace) {
+    if (!out_.is_open()) {
+        std::filesystem::path path(output_path_);
+        if (path.has_parent_path()) std::filesystem::create_directories(path.parent_path());
+        bool exists = std::filesystem::exists(path) && std::filesystem::file_size(path) > 0;
+        out_.open(path, std::ios::app);
+        if (!out_.is_open()) throw std::runtime_error("无法打开 trace 输出: " + output_path_);
+        if (format_ == Format::kChrome) {
+            if (!exists) out_ << "[\n";
+            first_event_ = !exists;
+        }
+    }
+    if (format_ == Format::kChrome) {
+        for (const auto& event : trace.ToChromeEvents()) {
+            if (!first_event_) out_ << ",\n";
+            out_ << event.dump();
+            first_event_ = false;
+        }
+    } else {
+        out_ << trace.ToOtlp(service_name_).dump() << "\n";
+    }
+    out_.flush();
+}
+
+uint64_t TraceExporter::ExportedCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return exported_;
+}
+
+ScopedTrace::ScopedTrace(TraceExporter& exporter, std::string request_id, const char* root_name, bool force)
+    : ScopedTrace(exporter, std::move(request_id), root_name, exporter.ShouldSample(force), 0) {}
+
+ScopedTrace::ScopedTrace(TraceExporter& exporter, std::string request_id, const char* root_name, bool sampled, int)
+    : exporter_(exporter), trace_(std::move(request_id), sampled || exporter.RecordsAll()), previous_(current_trace) {
+    trace_.SetSampled(sampled);
+    current_trace = &trace_;
+    if (trace_.Recording()) root_ = trace_.BeginSpan(root_name);
+}
+
+ScopedTrace::~ScopedTrace() {
+    if (trace_.Recording()) trace_.EndSpan(root_);
+    current_trace = previous_;
+    exporter_.Finish(trace_);
+}
+
+std::string NewRequestId() {
+    return Hex64(RandomU64());
+}
+
+std::string SanitizeRequestId(const std::string& candidate) {
+    std::string id;
+    for (char c : candidate) {
+        if (id.size() >= kMaxRequestIdLength) break;
+        if (std::isalnum(static_cast<unsigned char>(c)) || c == '.' || c == '_' || c == '-') id.push_back(c);
+    }
+    return id.empty() ? NewRequestId() : id;
+}
+
+void InstallTraceLogFormatter(const std::string& pattern) {
+    auto formatter = std::make_unique<spdlog::pattern_formatter>();
+    formatter->add_flag<RequestIdFlag>('*').set_pattern(pattern);
+    spdlog::set_formatter(std::move(formatter));
+}
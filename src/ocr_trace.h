@@ -0,0 +1,153 @@
+#ifndef OCR_TRACE_H
+#define OCR_TRACE_H
+
+#include <json.hpp>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+using json = nlohmann::json;
+
+// 请求级追踪：线程局部的当前 Trace + RAII span。
+// 未记录时 ScopedSpan 只有一次线程局部读取与分支；记录的 trace 按 Chrome trace-event 或 OTLP JSON 写入本地文件
+
+struct SpanRecord {
+    const char* name;           // 静态字符串
+    int parent;                 // 父 span 下标（-1 = 根）
+    int64_t start_us;           // 相对 trace 起点
+    int64_t duration_us = -1;   // -1 = 未结束
+    uint32_t thread_index;
+    std::vector<std::pair<const char*, std::string>> attributes;
+};
+
+class Trace {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    Trace(std::string request_id, bool recording);
+
+    const std::string& RequestId() const { return request_id_; }
+    bool Recording() const { return recording_; }
+    bool Sampled() const { return sampled_; }
+    void SetSampled(bool sampled) { sampled_ = sampled; }
+
+    int BeginSpan(const char* name);
+    void EndSpan(int index);
+    void SetAttribute(int index, const char* key, std::string value);
+    int64_t ElapsedUs() const;
+
+    json ToChromeEvents() const;                             // "ph": "X" 完整事件数组
+    json ToOtlp(const std::string& service_name) const;     // ExportTraceServiceRequest（JSON 编码）
+
+private:
+    std::string request_id_;
+    std::string trace_id_;   // 32 位十六进制（OTLP traceId）
+    uint64_t span_id_base_;  // spanId = base + 下标
+    bool recording_;         // 是否记录 span
+    bool sampled_;           // 是否导出（慢请求可在结束时补标记）
+    Clock::time_point start_;
+    int64_t start_unix_us_;
+    std::vector<SpanRecord> spans_;
+    int current_ = -1;       // 当前打开的 span（子 span 的父节点）
+};
+
+// 当前线程正在处理的 trace（无则 nullptr）与请求 ID（无则 "-"）
+Trace* CurrentTrace();
+const std::string& CurrentRequestId();
+
+class ScopedSpan {
+public:
+    explicit ScopedSpan(const char* name) : trace_(CurrentTrace()) {
+        if (trace_ && trace_->Recording()) {
+            index_ = trace_->BeginSpan(name);
+        } else {
+            trace_ = nullptr;
+        }
+    }
+    ~ScopedSpan() {
+        if (trace_) trace_->EndSpan(index_);
+    }
+    ScopedSpan(const ScopedSpan&) = delete;
+    ScopedSpan& operator=(const ScopedSpan&) = delete;
+
+    bool Active() const { return trace_ != nullptr; }
+    void SetAttribute(const char* key, std::string value) {
+        if (trace_) trace_->SetAttribute(index_, key, std::move(value));
+    }
+    template <typename T>
+    void SetAttribute(const char* key, T value) {
+        if (trace_) trace_->SetAttribute(index_, key, std::to_string(value));
+    }
+
+private:
+    Trace* trace_;
+    int index_ = -1;
+};
+
+// 采样与导出：sample_rate 按比例头部采样；slow_threshold_ms > 0 时记录全部请求、只导出慢请求；
+// 请求头 X-Trace: 1 强制采样（allow_force_header，默认关闭：未鉴权的客户端可借此往磁盘写 trace）
+class TraceExporter {
+public:
+    explicit TraceExporter(const json& tracing_config, std::string service_name = "ocr_service");
+
+    bool ShouldSample(bool force) const;  // 头部采样决定（随机）
+    bool RecordsAll() const { return slow_threshold_us_ > 0; }  // 慢请求导出需记录全部请求
+    void Finish(Trace& trace);  // 根 span 结束后调用，满足条件则写文件
+    bool AllowForceHeader() const { return allow_force_header_; }
+    uint64_t ExportedCount() const;
+
+private:
+    enum class Format { kChrome, kOtlp };
+
+    double sample_rate_;
+    int64_t slow_threshold_us_;
+    bool allow_force_header_;
+    Format format_;
+    std::string output_path_;
+    std::string service_name_;
+
+    mutable std::mutex mutex_;
+    std::ofstream out_;
+    bool first_event_ = true;  // Chrome 数组格式的分隔符
+    uint64_t exported_ = 0;
+
+    void Write(const Trace& trace);  // 持 mutex_ 调用
+};
+
+// RAII：在当前线程安装 trace（日志中的 request_id 随之生效）并打开根 span，析构时导出
+class ScopedTrace {
+public:
+    ScopedTrace(TraceExporter& exporter, std::string request_id, const char* root_name, bool force = false);
+    ~ScopedTrace();
+    ScopedTrace(const ScopedTrace&) = delete;
+    ScopedTrace& operator=(const ScopedTrace&) = delete;
+
+    Trace& Get() { return trace_; }
+    void SetAttribute(const char* key, std::string value) {
+        if (trace_.Recording()) trace_.SetAttribute(root_, key, std::move(value));
+    }
+
+private:
+    ScopedTrace(TraceExporter& exporter, std::string request_id, const char* root_name, bool sampled, int);
+
+    TraceExporter& exporter_;
+    Trace trace_;
+    Trace* previous_;
+    int root_ = -1;
+};
+
+// 16 位十六进制请求 ID
+std::string NewRequestId();
+// 客户端提供的请求 ID 进入日志与 trace 文件前净化：只保留 [A-Za-z0-9._-]，至多 kMaxRequestIdLength 字符；
+// 净化后为空时生成新 ID
+constexpr size_t kMaxRequestIdLength = 64;
+std::string SanitizeRequestId(const std::string& candidate);
+
+// 以 pattern 设置全局日志格式，其中 %* 输出当前请求 ID
+void InstallTraceLogFormatter(const std::string& pattern);
+
+#endif // OCR_TRACE_H
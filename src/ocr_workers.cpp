@@ -0,0 +1,249 @@
+#include "ocr_workers.h"
+#include "ocr_metrics.h"
+#include "ocr_trace.h"
+#include <httplib.h>
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <future>
+
+namespace {
+
+constexpr float kMinRecScore = 0.1f;  // 与单进程管道的最小识别阈值一致
+
+std::unique_ptr<httplib::Client> MakeClient(const WorkerEndpoint& endpoint) {
+    if (!endpoint.unix_socket) return std::make_unique<httplib::Client>(endpoint.host, endpoint.port);
+    auto client = std::make_unique<httplib::Client>(endpoint.host);
+    client->set_address_family(AF_UNIX);
+    return client;
+}
+
+// 距截止时间的剩余毫秒；无截止时间返回 -1
+int64_t RemainingMs(const RequestContext* ctx) {
+    if (!ctx || !ctx->HasDeadline()) return -1;
+    auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(ctx->deadline - RequestContext::Clock::now());
+    return std::max<int64_t>(0, remaining.count());
+}
+
+}  // namespace
+
+WorkerEndpoint ParseWorkerEndpoint(const std::string& spec) {
+    WorkerEndpoint endpoint;
+    endpoint.spec = spec;
+    if (spec.rfind("unix:", 0) == 0) {
+        endpoint.unix_socket = true;
+        endpoint.host = spec.substr(5);
+        if (endpoint.host.empty()) throw std::invalid_argument("worker 地址缺少套接字路径: " + spec);
+        return endpoint;
+    }
+    size_t colon = spec.rfind(':');
+    if (colon == std::string::npos || colon == 0 || colon + 1 == spec.size()) {
+        throw std::invalid_argument("无效 worker 地址: " + spec + "（unix:<path> 或 host:port）");
+    }
+    endpoint.host = spec.substr(0, colon);
+    try {
+        size_t parsed = 0;
+        endpoint.port = std::stoi(spec.substr(colon + 1), &parsed);
+        if (parsed != spec.size() - colon - 1) throw std::invalid_argument(spec);
+    } catch (const std::exception&) {
+        throw std::invalid_argument("无效 worker 端口: " + spec);
+    }
+    if (endpoint.port <= 0 || endpoint.port > 65535) throw std::invalid_argument("无效 worker 端口: " + spec);
+    return endpoint;
+}
+
+std::vector<std::pair<size_t, size_t>> SplitChunks(size_t n, size_t workers, size_t min_per_chunk) {
+    std::vector<std::pair<size_t, size_t>> chunks;
+    if (n == 0) return chunks;
+    size_t count = std::clamp<size_t>(n / std::max<size_t>(1, min_per_chunk), 1, std::max<size_t>(1, workers));
+    size_t begin = 0;
+    for (size_t k = 0; k < count; ++k) {
+        size_t size = n / count + (k < n % count ? 1 : 0);
+        chunks.emplace_back(begin, begin + size);
+        begin += size;
+    }
+    return chunks;
+}
+
+OCRFrontend::OCRFrontend(const json& config)
+    : min_crops_per_worker_(config.value("min_crops_per_worker", 8)),
+      connect_timeout_ms_(config.value("connect_timeout_ms", 1000)) {
+    auto& registry = MetricsRegistry::Instance();
+    auto load = [&](const char* stage, std::vector<Worker>& workers) {
+        for (const auto& spec : config.value(stage, std::vector<std::string>{})) {
+            Worker worker;
+            worker.endpoint = ParseWorkerEndpoint(spec);
+            std::string labels = std::string("stage=\"") + stage + "\",worker=\"" + spec + "\"";
+            worker.requests = &registry.GetCounter("ocr_worker_requests_total", "Requests forwarded to stage workers", labels);
+            worker.failures = &registry.GetCounter("ocr_worker_failures_total",
+                                                   "Forwarded requests that failed to connect or returned 5xx", labels);
+            workers.push_back(worker);
+        }
+        if (workers.empty()) throw std::invalid_argument(std::string("service.workers.") + stage + " 不能为空");
+    };
+    load("det", det_workers_);
+    load("rec", rec_workers_);
+    if (min_crops_per_worker_ == 0) throw std::invalid_argument("service.workers.min_crops_per_worker 必须为正");
+    spdlog::info("拆分部署前端: det worker {} 个, rec worker {} 个 (每个 rec 分片至少 {} 行)", det_workers_.size(),
+                 rec_workers_.size(), min_crops_per_worker_);
+}
+
+json OCRFrontend::Post(const std::vector<Worker>& workers, size_t start, const std::string& path, const json& body,
+                       RequestContext* ctx, const std::string& request_id) const {
+    std::string payload = body.dump();
+    std::string last_error = "无可用 worker";
+    for (size_t attempt = 0; attempt < workers.size(); ++attempt) {
+        const Worker& worker = workers[(start + attempt) % workers.size()];
+        int64_t remaining_ms = RemainingMs(ctx);
+        if (remaining_ms == 0) {
+            ctx->timed_out = true;
+            return {{"results", json::array()}, {"partial", true}};
+        }
+        auto client = MakeClient(worker.endpoint);
+        client->set_connection_timeout(connect_timeout_ms_ / 1000, (connect_timeout_ms_ % 1000) * 1000);
+        httplib::Headers headers{{"Accept", "application/msgpack"}, {"X-Request-ID", request_id}};
+        if (remaining_ms > 0) {
+            client->set_read_timeout(remaining_ms / 1000, (remaining_ms % 1000) * 1000);
+            headers.emplace("X-Request-Timeout", std::to_string(remaining_ms));
+        }
+        worker.requests->Inc();
+        auto result = client->Post(path, headers, payload, "application/json");
+        if (!result) {  // 连接失败 / 读超时：换下一个 worker
+            worker.failures->Inc();
+            last_error = worker.endpoint.spec + ": " + httplib::to_string(result.error());
+            spdlog::warn("worker 请求失败: {}{}", last_error, attempt + 1 < workers.size() ? "，尝试下一个" : "");
+            continue;
+        }
+        if (result->status == 503) {  // worker 排队已满或预热中
+            worker.failures->Inc();
+            last_error = worker.endpoint.spec + ": 503 " + result->body;
+            continue;
+        }
+        if (result->status == 400) throw std::invalid_argument(result->body);
+        if (result->status == 504) {  // worker 的 deadline_policy = error
+            if (ctx) ctx->timed_out = true;
+            return {{"results", json::array()}, {"partial", true}};
+        }
+        if (result->status != 200) {
+            worker.failures->Inc();
+            throw WorkerError(worker.endpoint.spec + ": " + std::to_string(result->status) + " " + result->body);
+        }
+        json response = result->get_header_value("Content-Type").rfind("application/msgpack", 0) == 0
+                            ? json::from_msgpack(result->body)
+                            : json::parse(result->body);
+        if (response.value("partial", false) && ctx) ctx->timed_out = true;
+        return response;
+    }
+    throw WorkerError(last_error);
+}
+
+json OCRFrontend::Infer(const cv::Mat& img, const std::string& encoded_image, RequestContext* ctx,
+                        const InferOptions& options) {
+    if (!options.rois.empty() || !options.det_regions.empty()) {
+        throw std::invalid_argument("拆分部署的前端不支持 rois 与会话");
+    }
+    std::string request_id = CurrentRequestId();  // rec 分片在其他线程发送，先取出
+    json response{{"results", json::array()}};
+
+    // 1. 检测：整图原样转发给一个 det worker
+    json det_body{{"image_base64", encoded_image}};
+    if (!options.lang.empty()) det_body["lang"] = options.lang;
+    json detected;
+    {
+        ScopedSpan span("det_worker");
+        detected = Post(det_workers_, next_det_++, "/det", det_body, ctx, request_id);
+    }
+    if (detected["results"].empty() || (ctx && !ctx->CheckDeadline())) {
+        if (ctx && ctx->timed_out) response["partial"] = true;
+        return response;
+    }
+
+    // 2. 按框裁剪（与单进程管道相同：轴对齐外接框，裁剪到图像内）
+    std::vector<cv::Mat> crops;
+    std::vector<std::vector<float>> crop_boxes;  // [x1,y1,x2,y2,score]
+    for (const auto& box : detected["results"][0]["boxes"]) {
+        std::vector<float> bbox = box.at("bbox").get<std::vector<float>>();
+        bbox.push_back(box.at("score").get<float>());
+        cv::Rect roi(static_cast<int>(bbox[0]), static_cast<int>(bbox[1]), static_cast<int>(bbox[2] - bbox[0]),
+                     static_cast<int>(bbox[3] - bbox[1]));
+        if (roi.area() <= 0 || roi.x < 0 || roi.y < 0) continue;
+        roi &= cv::Rect(0, 0, img.cols, img.rows);
+        if (roi.area() <= 0) continue;
+        crops.push_back(img(roi));
+        crop_boxes.push_back(std::move(bbox));
+    }
+    if (crops.empty()) return response;
+
+    // 3. 识别：裁剪切成分片，轮询起点后各分片并行发给不同的 rec worker
+    json rec_template = json::object();
+    if (!options.lang.empty()) rec_template["lang"] = options.lang;
+    if (!options.decode.is_null()) rec_template["decode"] = options.decode;
+    if (options.return_chars) rec_template["return_chars"] = true;
+    auto chunks = SplitChunks(crops.size(), rec_workers_.size(), min_crops_per_worker_);
+    size_t first = next_rec_.fetch_add(chunks.size());
+    std::vector<json> recognized(chunks.size());
+    {
+        ScopedSpan span("rec_workers");
+        span.SetAttribute("crops", crops.size());
+        span.SetAttribute("chunks", chunks.size());
+        std::vector<std::future<json>> futures;
+        for (size_t k = 0; k < chunks.size(); ++k) {
+            futures.push_back(std::async(std::launch::async, [&, k] {
+                json body = rec_template;
+                body["images"] = json::array();
+                std::vector<uchar> buffer;
+                for (size_t i = chunks[k].first; i < chunks[k].second; ++i) {
+                    cv::imencode(".bmp", crops[i], buffer);  // 无压缩：同机传输，编码开销最小
+                    body["images"].push_back(httplib::detail::base64_encode(std::string(buffer.begin(), buffer.end())));
+                }
+                return Post(rec_workers_, first + k, "/rec", body, ctx, request_id);
+            }));
+        }
+        for (size_t k = 0; k < chunks.size(); ++k) recognized[k] = futures[k].get();
+    }
+
+    // 4. 组装：识别结果映射回整图坐标，按 y 排序
+    for (size_t k = 0; k < chunks.size(); ++k) {
+        const json& results = recognized[k]["results"];
+        for (size_t i = chunks[k].first; i < chunks[k].second; ++i) {
+            size_t index = i - chunks[k].first;
+            if (index >= results.size()) break;  // worker 超时：只有部分结果
+            const json& rec = results[index];
+            std::string text = rec.value("text", "");
+            float rec_score = rec.value("score", 0.0f);
+            if (text.empty() || rec_score < kMinRecScore) continue;
+            const auto& bbox = crop_boxes[i];
+            json j_res{{"bbox", {bbox[0], bbox[1], bbox[2], bbox[3]}}, {"text", text},
+                       {"score", std::max(bbox[4], rec_score)}};
+            if (rec.contains("matched")) j_res["matched"] = rec["matched"];
+            if (options.return_chars) {
+                float crop_x = static_cast<float>(static_cast<int>(bbox[0]));  // 裁剪左边缘
+                j_res["chars"] = json::array();
+                for (const auto& ch : rec.value("chars", json::array())) {
+                    j_res["chars"].push_back({{"text", ch["text"]}, {"score", ch["score"]},
+                                              {"bbox", {ch["bbox"][0].get<float>() + crop_x, bbox[1],
+                                                        ch["bbox"][2].get<float>() + crop_x, bbox[3]}}});
+                }
+            }
+            response["results"].push_back(std::move(j_res));
+        }
+    }
+    std::stable_sort(response["results"].begin(), response["results"].end(), [](const json& a, const json& b) {
+        return a["bbox"][1].get<float>() < b["bbox"][1].get<float>();
+    });
+    if (ctx && ctx->timed_out) response["partial"] = true;
+    spdlog::info("拆分推理完成: {} 框, {} 个 rec 分片, {} 结果", crops.size(), chunks.size(), response["results"].size());
+    return response;
+}
+
+json OCRFrontend::Status() const {
+    auto describe = [](const std::vector<Worker>& workers) {
+        json list = json::array();
+        for (const auto& worker : workers) {
+            list.push_back({{"endpoint", worker.endpoint.spec}, {"requests", worker.requests->Value()},
+                            {"failures", worker.failures->Value()}});
+        }
+        return list;
+    };
+    return {{"det", describe(det_workers_)}, {"rec", describe(rec_workers_)},
+            {"min_crops_per_worker", min_crops_per_worker_}};
+}
@@ -0,0 +1,72 @@
+#ifndef OCR_WORKERS_H
+#define OCR_WORKERS_H
+
+#include "ocr_context.h"
+#include "ocr_inference.h"
+#include <opencv2/opencv.hpp>
+#include <json.hpp>
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+using json = nlohmann::json;
+
+class Counter;
+
+// 阶段 worker 地址："unix:<path>"（同机 Unix 域套接字）或 "host:port"（TCP，调试或跨机）
+struct WorkerEndpoint {
+    std::string spec;
+    std::string host;  // unix 时为套接字路径
+    int port = 0;
+    bool unix_socket = false;
+};
+
+// 格式错误抛 std::invalid_argument
+WorkerEndpoint ParseWorkerEndpoint(const std::string& spec);
+
+// n 个裁剪切成至多 workers 份、每份至少 min_per_chunk 个（n 不足时为一份），份间大小至多差 1；返回各份 [begin, end)
+std::vector<std::pair<size_t, size_t>> SplitChunks(size_t n, size_t workers, size_t min_per_chunk);
+
+// worker 全部不可达或返回非预期状态（服务映射为 502）
+class WorkerError : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+// 拆分部署的前端（service.role = frontend）：本进程不加载模型，/ocr 的图像转发给一个 det worker（/det），
+// 按框裁剪后分片并行发给多个 rec worker（/rec），组装成与单进程 /ocr 相同格式的结果。
+// det / rec worker 是以 role det / rec 启动的 ocr_server，只加载本阶段模型，可按 1 : N 独立扩缩。
+// 配置 service.workers：{"det": [地址...], "rec": [地址...], "min_crops_per_worker", "connect_timeout_ms"}
+class OCRFrontend {
+public:
+    explicit OCRFrontend(const json& config);
+
+    // encoded_image 为请求中的原始 base64，原样转发给 det worker（免重编码）；
+    // 截止时间随 X-Request-Timeout 传给 worker，worker 返回 partial 时置位 ctx->timed_out
+    json Infer(const cv::Mat& img, const std::string& encoded_image, RequestContext* ctx, const InferOptions& options);
+    // 各 worker 的地址、请求数与失败数
+    json Status() const;
+
+private:
+    struct Worker {
+        WorkerEndpoint endpoint;
+        Counter* requests = nullptr;
+        Counter* failures = nullptr;  // 连接失败 / 5xx
+    };
+
+    std::vector<Worker> det_workers_;
+    std::vector<Worker> rec_workers_;
+    std::atomic<size_t> next_det_{0};  // 轮询起点
+    std::atomic<size_t> next_rec_{0};
+    size_t min_crops_per_worker_;
+    int connect_timeout_ms_;
+
+    // 从 workers[start] 起依次尝试：连接失败或 503 换下一个，400 抛 std::invalid_argument，其余错误抛 WorkerError
+    json Post(const std::vector<Worker>& workers, size_t start, const std::string& path, const json& body,
+              RequestContext* ctx, const std::string& request_id) const;
+};
+
+#endif // OCR_WORKERS_H
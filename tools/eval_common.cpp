@@ -0,0 +1,174 @@
+#include "eval_common.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <tuple>
+
+std::vector<char32_t> DecodeUtf8(const std::string& text) {
+    std::vector<char32_t> out;
+    out.reserve(text.size());
+    for (size_t i = 0; i < text.size();) {
+        unsigned char c = static_cast<unsigned char>(text[i]);
+        int len = c < 0x80 ? 1 : (c >> 5) == 0x6 ? 2 : (c >> 4) == 0xE ? 3 : (c >> 3) == 0x1E ? 4 : 0;
+        if (len == 0 || i + len > text.size()) {
+            out.push_back(c);
+            ++i;
+            continue;
+        }
+        char32_t cp = len == 1 ? c : c & (0xFF >> (len + 1));
+        for (int k = 1; k < len; ++k) cp = (cp << 6) | (static_cast<unsigned char>(text[i + k]) & 0x3F);
+        out.push_back(cp);
+        i += len;
+    }
+    return out;
+}
+
+size_t EditDistance(const std::vector<char32_t>& a, const std::vector<char32_t>& b) {
+    std::vector<size_t> row(b.size() + 1);
+    for (size_t j = 0; j <= b.size(); ++j) row[j] = j;
+    for (size_t i = 1; i <= a.size(); ++i) {
+        size_t diagonal = row[0];
+        row[0] = i;
+        for (size_t j = 1; j <= b.size(); ++j) {
+            size_t up = row[j];
+            row[j] = std::min({row[j] + 1, row[j - 1] + 1, diagonal + (a[i - 1] == b[j - 1] ? 0 : 1)});
+            diagonal = up;
+        }
+    }
+    return row[b.size()];
+}
+
+void TextAccuracy::Add(const std::string& prediction, const std::string& reference) {
+    auto pred = DecodeUtf8(prediction);
+    auto ref = DecodeUtf8(reference);
+    edits_ += EditDistance(pred, ref);
+    ref_chars_ += ref.size();
+    if (pred == ref) ++exact_;
+    ++samples_;
+}
+
+json TextAccuracy::ToJson() const {
+    return {{"samples", samples_}, {"cer", Cer()}, {"accuracy", Accuracy()}, {"edits", edits_}, {"ref_chars", ref_chars_}};
+}
+
+std::vector<LabeledSample> LoadPaddleLabels(const std::string& label_path, const std::string& root) {
+    std::ifstream file(label_path);
+    if (!file.is_open()) throw std::runtime_error("无法读取标注: " + label_path);
+    std::filesystem::path base = root.empty() ? std::filesystem::path(label_path).parent_path() : std::filesystem::path(root);
+
+    std::vector<LabeledSample> samples;
+    std::string line;
+    while (std::getline(file, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        size_t tab = line.find('\t');
+        if (tab == std::string::npos) continue;
+        LabeledSample sample;
+        std::filesystem::path image = line.substr(0, tab);
+        sample.image_path = (image.is_relative() ? base / image : image).string();
+        std::string label = line.substr(tab + 1);
+        if (!label.empty() && label.front() == '[') {
+            sample.regions = json::parse(label);
+        } else {
+            sample.text = std::move(label);
+        }
+        samples.push_back(std::move(sample));
+    }
+    if (samples.empty()) throw std::runtime_error("标注为空: " + label_path);
+    return samples;
+}
+
+std::vector<GroundTruthRegion> LoadIcdarGroundTruth(const std::string& gt_path) {
+    std::ifstream file(gt_path);
+    if (!file.is_open()) throw std::runtime_error("无法读取真值: " + gt_path);
+    std::vector<GroundTruthRegion> regions;
+    std::string line;
+    bool first = true;
+    while (std::getline(file, line)) {
+        if (first && line.compare(0, 3, "\xEF\xBB\xBF") == 0) line.erase(0, 3);
+        first = false;
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty()) continue;
+
+        GroundTruthRegion region;
+        size_t pos = 0;
+        float coords[8];
+        for (int i = 0; i < 8; ++i) {
+            size_t comma = line.find(',', pos);
+            if (comma == std::string::npos) throw std::runtime_error("真值格式错误: " + gt_path + ": " + line);
+            coords[i] = std::stof(line.substr(pos, comma - pos));
+            pos = comma + 1;
+        }
+        for (int i = 0; i < 4; ++i) region.points.emplace_back(coords[2 * i], coords[2 * i + 1]);
+        region.text = line.substr(pos);
+        region.ignore = region.text == "###";
+        regions.push_back(std::move(region));
+    }
+    return regions;
+}
+
+std::vector<GroundTruthRegion> RegionsFromPaddleLabel(const json& regions) {
+    std::vector<GroundTruthRegion> result;
+    for (const auto& item : regions) {
+        GroundTruthRegion region;
+        for (const auto& pt : item.at("points")) region.points.emplace_back(pt.at(0).get<float>(), pt.at(1).get<float>());
+        region.text = item.value("transcription", "");
+        region.ignore = region.text == "###" || item.value("difficult", false);
+        result.push_back(std::move(region));
+    }
+    return result;
+}
+
+double PolygonArea(const std::vector<cv::Point2f>& polygon) {
+    return polygon.size() < 3 ? 0.0 : std::abs(cv::contourArea(polygon));
+}
+
+double PolygonIntersection(const std::vector<cv::Point2f>& a, const std::vector<cv::Point2f>& b) {
+    if (a.size() < 3 || b.size() < 3) return 0.0;
+    // 标注四边形偶有自交 / 凹形，取凸包后求交
+    std::vector<cv::Point2f> hull_a, hull_b, intersection;
+    cv::convexHull(a, hull_a);
+    cv::convexHull(b, hull_b);
+    return std::max(0.0f, cv::intersectConvexConvex(hull_a, hull_b, intersection, true));
+}
+
+double PolygonIoU(const std::vector<cv::Point2f>& a, const std::vector<cv::Point2f>& b) {
+    double inter = PolygonIntersection(a, b);
+    double uni = PolygonArea(a) + PolygonArea(b) - inter;
+    return uni > 0 ? inter / uni : 0.0;
+}
+
+DetectionMatch MatchDetections(const std::vector<GroundTruthRegion>& gt,
+                               const std::vector<std::vector<cv::Point2f>>& detections, double iou_threshold) {
+    DetectionMatch match;
+    std::vector<bool> det_ignored(detections.size(), false);
+    for (size_t d = 0; d < detections.size(); ++d) {
+        double area = PolygonArea(detections[d]);
+        for (const auto& region : gt) {
+            if (region.ignore && area > 0 && PolygonIntersection(region.points, detections[d]) / area > 0.5) {
+                det_ignored[d] = true;
+                break;
+            }
+        }
+        if (!det_ignored[d]) ++match.det_care;
+    }
+
+    std::vector<std::tuple<double, int, int>> candidates;
+    for (size_t g = 0; g < gt.size(); ++g) {
+        if (gt[g].ignore) continue;
+        ++match.gt_care;
+        for (size_t d = 0; d < detections.size(); ++d) {
+            if (det_ignored[d]) continue;
+            double iou = PolygonIoU(gt[g].points, detections[d]);
+            if (iou >= iou_threshold) candidates.emplace_back(iou, static_cast<int>(g), static_cast<int>(d));
+        }
+    }
+    std::sort(candidates.begin(), candidates.end(), [](const auto& a, const auto& b) { return std::get<0>(a) > std::get<0>(b); });
+    std::vector<bool> gt_used(gt.size(), false), det_used(detections.size(), false);
+    for (const auto& [iou, g, d] : candidates) {
+        if (gt_used[g] || det_used[d]) continue;
+        gt_used[g] = det_used[d] = true;
+        match.pairs.emplace_back(g, d);
+    }
+    return match;
+}
@@ -0,0 +1,71 @@
+#ifndef EVAL_COMMON_H
+#define EVAL_COMMON_H
+
+#include <opencv2/opencv.hpp>
+#include <json.hpp>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+using json = nlohmann::json;
+
+// UTF-8 → Unicode 码点（非法字节按单字节处理），CER 按字符而非字节计算
+std::vector<char32_t> DecodeUtf8(const std::string& text);
+
+// Levenshtein 编辑距离
+size_t EditDistance(const std::vector<char32_t>& a, const std::vector<char32_t>& b);
+
+// 识别精度累加：CER = Σ编辑距离 / Σ参考字符数；准确率 = 完全匹配的样本比例。
+// 参考全为空串时 CER 无法按比例计算：无编辑为 0，有任何多识别的字符为 1（不能让误识别通过闸门）
+class TextAccuracy {
+public:
+    void Add(const std::string& prediction, const std::string& reference);
+    double Cer() const {
+        if (ref_chars_ == 0) return edits_ ? 1.0 : 0.0;
+        return static_cast<double>(edits_) / ref_chars_;
+    }
+    double Accuracy() const { return samples_ ? static_cast<double>(exact_) / samples_ : 0.0; }
+    size_t Samples() const { return samples_; }
+    json ToJson() const;
+
+private:
+    size_t edits_ = 0, ref_chars_ = 0, exact_ = 0, samples_ = 0;
+};
+
+// PaddleOCR 标注格式：每行 "图片路径\t标注"。
+// 识别集的标注为文本；检测 / 端到端集的标注为 [{"transcription": ..., "points": [[x,y],...]}, ...]
+struct LabeledSample {
+    std::string image_path;  // 已按标注文件所在目录（或 root）解析
+    std::string text;        // 识别集
+    json regions;            // 检测 / 端到端集（否则为 null）
+};
+
+std::vector<LabeledSample> LoadPaddleLabels(const std::string& label_path, const std::string& root = "");
+
+// 检测真值区域：多边形（通常为四点）+ 文本；### 为不计分区域（don't care）
+struct GroundTruthRegion {
+    std::vector<cv::Point2f> points;
+    std::string text;
+    bool ignore = false;
+};
+
+// ICDAR 2015 格式：每行 x1,y1,...,x4,y4,transcription（文本可含逗号，可带 UTF-8 BOM）
+std::vector<GroundTruthRegion> LoadIcdarGroundTruth(const std::string& gt_path);
+// PaddleOCR 检测标注 [{"transcription", "points"}]
+std::vector<GroundTruthRegion> RegionsFromPaddleLabel(const json& regions);
+
+double PolygonArea(const std::vector<cv::Point2f>& polygon);
+double PolygonIntersection(const std::vector<cv::Point2f>& a, const std::vector<cv::Point2f>& b);
+double PolygonIoU(const std::vector<cv::Point2f>& a, const std::vector<cv::Point2f>& b);
+
+// ICDAR 2015 协议的一对一匹配：与 don't care 区域重叠（交集 / 检测面积 > 0.5）的检测不计分，
+// 其余按 IoU 降序贪心匹配（IoU ≥ iou_threshold）
+struct DetectionMatch {
+    std::vector<std::pair<int, int>> pairs;  // (gt 下标, 检测下标)
+    size_t gt_care = 0;   // 计分的真值数
+    size_t det_care = 0;  // 计分的检测数
+};
+DetectionMatch MatchDetections(const std::vector<GroundTruthRegion>& gt,
+                               const std::vector<std::vector<cv::Point2f>>& detections, double iou_threshold = 0.5);
+
+#endif // EVAL_COMMON_H
@@ -0,0 +1,34 @@
+#include "loadgen_stats.h"
+#include <algorithm>
+#include <numeric>
+
+double Percentile(const std::vector<double>& sorted, double q) {
+    if (sorted.empty()) return 0.0;
+    size_t idx = std::min(sorted.size() - 1, static_cast<size_t>(q * (sorted.size() - 1) + 0.5));
+    return sorted[idx];
+}
+
+json LatencySummary(std::vector<double> values) {
+    std::sort(values.begin(), values.end());
+    double mean = values.empty() ? 0.0 : std::accumulate(values.begin(), values.end(), 0.0) / values.size();
+    return {
+        {"count", values.size()},
+        {"mean", mean},
+        {"p50", Percentile(values, 0.5)},
+        {"p90", Percentile(values, 0.9)},
+        {"p99", Percentile(values, 0.99)},
+        {"p999", Percentile(values, 0.999)},
+        {"max", values.empty() ? 0.0 : values.back()}
+    };
+}
+
+std::vector<double> CorrectCoordinatedOmission(const std::vector<double>& values, double expected_interval) {
+    std::vector<double> corrected(values);
+    if (expected_interval <= 0) return corrected;
+    for (double v : values) {
+        for (double missing = v - expected_interval; missing >= expected_interval; missing -= expected_interval) {
+            corrected.push_back(missing);
+        }
+    }
+    return corrected;
+}
@@ -0,0 +1,20 @@
+#ifndef LOADGEN_STATS_H
+#define LOADGEN_STATS_H
+
+#include <json.hpp>
+#include <vector>
+
+using json = nlohmann::json;
+
+// 已排序样本的分位数（最近秩，q ∈ [0, 1]）；空样本为 0
+double Percentile(const std::vector<double>& sorted, double q);
+
+// 延迟分布摘要：count / mean / p50 / p90 / p99 / p999 / max（values 无需排序）
+json LatencySummary(std::vector<double> values);
+
+// 闭环协调遗漏修正（同 HdrHistogram recordValueWithExpectedInterval）：
+// 单次耗时 v 超过期望间隔 E 时，补记 v-E, v-2E, ...（≥ E）这些本应发出却被阻塞的请求；
+// 返回原样本 + 补记样本，E ≤ 0 时不修正
+std::vector<double> CorrectCoordinatedOmission(const std::vector<double>& values, double expected_interval);
+
+#endif // LOADGEN_STATS_H
@@ -0,0 +1,235 @@
+// tools/ocr_bench.cpp
+// 基准测试：合成文档 → OCRDetect / OCRRecognize / OCRInference 各阶段延迟与 1..N 线程吞吐，输出 JSON
+// 用法: ocr_bench [--config config/bench_config.json] [--threads 4] [--repeat 2] [--output bench.json]
+#include "ocr_inference.h"
+#include "ocr_codec.h"
+#include "ocr_metrics.h"
+#include "ocr_quant.h"
+#include "synthetic_doc.h"
+#include <spdlog/spdlog.h>
+#include <json.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef GIT_VERSION
+#define GIT_VERSION "unknown"
+#endif
+
+namespace {
+
+struct BenchOptions {
+    std::string config_path = "config/bench_config.json";
+    int max_threads = 4;
+    int repeat = 2;
+    std::string output;  // 空 = stdout
+};
+
+BenchOptions ParseArgs(int argc, char** argv) {
+    BenchOptions opts;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto next = [&]() -> std::string {
+            if (i + 1 >= argc) throw std::invalid_argument("缺少参数值: " + arg);
+            return argv[++i];
+        };
+        if (arg == "--config") opts.config_path = next();
+        else if (arg == "--threads") opts.max_threads = std::max(1, std::stoi(next()));
+        else if (arg == "--repeat") opts.repeat = std::max(1, std::stoi(next()));
+        else if (arg == "--output") opts.output = next();
+        else throw std::invalid_argument("未知参数: " + arg);
+    }
+    return opts;
+}
+
+double Percentile(std::vector<double>& sorted, double q) {
+    if (sorted.empty()) return 0.0;
+    size_t idx = std::min(sorted.size() - 1, static_cast<size_t>(q * (sorted.size() - 1) + 0.5));
+    return sorted[idx];
+}
+
+// 从注册表快照提取各阶段耗时（毫秒）
+json StageSummary() {
+    json snapshot = MetricsRegistry::Instance().Snapshot();
+    json stages = json::object();
+    if (snapshot.contains("ocr_stage_duration_seconds")) {
+        for (const auto& [labels, hist] : snapshot["ocr_stage_duration_seconds"].items()) {
+            uint64_t count = hist["count"];
+            if (count == 0) continue;
+            // labels 形如 stage="det_inference"
+            std::string name = labels.substr(labels.find('"') + 1);
+            name.pop_back();
+            stages[name] = {
+                {"count", count},
+                {"mean_ms", hist["sum"].get<double>() * 1000.0 / count},
+                {"p50_ms", hist["p50"].get<double>() * 1000.0},
+                {"p99_ms", hist["p99"].get<double>() * 1000.0}
+            };
+        }
+    }
+    json summary = {{"stages", stages}};
+    for (const char* name : {"ocr_boxes_per_image", "ocr_rec_input_width_pixels"}) {
+        if (snapshot.contains(name) && snapshot[name].contains("")) {
+            const auto& hist = snapshot[name][""];
+            summary[name] = {{"count", hist["count"]}, {"p50", hist["p50"]}, {"p90", hist["p90"]}, {"p99", hist["p99"]}};
+        }
+    }
+    return summary;
+}
+
+// threads 个线程共同完成 total 次调用，统计吞吐与单次延迟分布
+template <typename Fn>
+json RunParallel(int threads, size_t total, Fn&& fn) {
+    MetricsRegistry::Instance().Reset();
+    std::atomic<size_t> next{0};
+    std::vector<std::vector<double>> latencies(threads);
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            for (size_t i = next++; i < total; i = next++) {
+                auto call_start = std::chrono::steady_clock::now();
+                fn(i);
+                latencies[t].push_back(
+                    std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - call_start).count());
+            }
+        });
+    }
+    for (auto& w : workers) w.join();
+    double wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::vector<double> all;
+    for (auto& v : latencies) all.insert(all.end(), v.begin(), v.end());
+    std::sort(all.begin(), all.end());
+    double mean = all.empty() ? 0.0 : std::accumulate(all.begin(), all.end(), 0.0) / all.size();
+
+    json result = {
+        {"threads", threads},
+        {"calls", total},
+        {"wall_s", wall_s},
+        {"throughput_per_s", wall_s > 0 ? total / wall_s : 0.0},
+        {"latency_ms", {{"mean", mean}, {"p50", Percentile(all, 0.5)}, {"p90", Percentile(all, 0.9)},
+                        {"p99", Percentile(all, 0.99)}, {"max", all.empty() ? 0.0 : all.back()}}}
+    };
+    result.update(StageSummary());
+    return result;
+}
+
+std::vector<int> ThreadCounts(int max_threads) {
+    std::vector<int> counts;
+    for (int t = 1; t < max_threads; t *= 2) counts.push_back(t);
+    counts.push_back(max_threads);
+    return counts;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    try {
+        BenchOptions opts = ParseArgs(argc, argv);
+        spdlog::set_level(spdlog::level::warn);  // 避免逐请求日志干扰计时
+
+        std::ifstream config_file(opts.config_path);
+        if (!config_file.is_open()) throw std::runtime_error("无法加载配置: " + opts.config_path);
+        json service_config = json::parse(config_file).at("service_config");
+        auto model_layer = service_config.at("model");
+
+        // 与 OCRInference 相同的子配置注入与精度变体选择（INT8 须已批准）
+        std::string precision = model_layer.value("precision", "fp32");
+        bool require_approval = model_layer.value("require_int8_approval", true);
+        json det_config = model_layer.at("det_model");
+        json rec_config = model_layer.at("rec_model");
+        det_config["path"] = SelectModelVariant(det_config, precision, require_approval, "det").path;
+        rec_config["path"] = SelectModelVariant(rec_config, precision, require_approval, "rec").path;
+        rec_config["character_dict"] = model_layer.at("character_dict");
+        rec_config["postprocess"] = model_layer.at("postprocess");
+        // model.loading（共享线程池 / intra-op 线程 / mmap）：ModelLoader::Env 以首次调用的设置为准，
+        // 阶段基准的 session 先于 OCRInference 创建，缺少这一层会测到服务从不使用的配置
+        det_config["loading"] = rec_config["loading"] = model_layer.value("loading", json::object());
+
+        OCRDetect detector(det_config);
+        OCRRecognize recognizer(rec_config);
+        OCRInference inference(service_config);
+
+        // 合成数据：整页文档 + 单行裁剪
+        std::vector<SyntheticDoc> docs;
+        for (const auto& spec : DefaultBenchSpecs()) docs.push_back(RenderSyntheticDoc(spec));
+        std::vector<cv::Mat> lines;
+        unsigned state = 42;
+        for (int i = 0; i < 64; ++i) lines.push_back(RenderTextLine(RandomTextLine(state, 1, 8), 0.6 + (i % 4) * 0.3));
+        std::cerr << "合成数据: " << docs.size() << " 文档, " << lines.size() << " 行" << std::endl;
+
+        // 预热：每种形状跑一次，排除首轮 kernel 特化开销
+        std::vector<json> responses;
+        for (const auto& doc : docs) responses.push_back(inference.Infer(doc.image));
+        for (const auto& line : lines) {
+            float score = 0.0f;
+            recognizer.Recognize(line, score);
+        }
+
+        json report;
+        report["meta"] = {
+            {"git_version", GIT_VERSION},
+            {"config", opts.config_path},
+            {"models", inference.ModelVariants()},
+            {"hardware_concurrency", std::thread::hardware_concurrency()},
+            {"timestamp", static_cast<int64_t>(std::time(nullptr))},
+            {"docs", docs.size()},
+            {"lines", lines.size()},
+            {"repeat", opts.repeat}
+        };
+
+        json det_runs = json::array(), rec_runs = json::array(), e2e_runs = json::array();
+        for (int threads : ThreadCounts(opts.max_threads)) {
+            std::cerr << "线程数 " << threads << " ..." << std::endl;
+            det_runs.push_back(RunParallel(threads, docs.size() * opts.repeat, [&](size_t i) {
+                detector.Detect(docs[i % docs.size()].image);
+            }));
+            rec_runs.push_back(RunParallel(threads, lines.size() * opts.repeat, [&](size_t i) {
+                float score = 0.0f;
+                recognizer.Recognize(lines[i % lines.size()], score);
+            }));
+            e2e_runs.push_back(RunParallel(threads, docs.size() * opts.repeat, [&](size_t i) {
+                inference.Infer(docs[i % docs.size()].image);
+            }));
+        }
+        report["det"] = det_runs;
+        report["rec"] = rec_runs;
+        report["e2e"] = e2e_runs;
+
+        // 响应序列化：JSON vs MessagePack vs CBOR
+        json serialize = json::object();
+        for (auto format : {ResponseFormat::kJson, ResponseFormat::kMsgpack, ResponseFormat::kCbor}) {
+            size_t bytes = 0;
+            std::string content_type;
+            auto start = std::chrono::steady_clock::now();
+            for (int r = 0; r < opts.repeat; ++r) {
+                for (const auto& response : responses) bytes += EncodeResponse(response, format, content_type).size();
+            }
+            double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+            size_t encodes = responses.size() * opts.repeat;
+            serialize[FormatName(format)] = {{"avg_bytes", bytes / encodes}, {"avg_us", us / encodes}};
+        }
+        report["serialize"] = serialize;
+
+        std::string text = report.dump(2);
+        if (opts.output.empty()) {
+            std::cout << text << std::endl;
+        } else {
+            std::ofstream(opts.output) << text << std::endl;
+            std::cerr << "结果已写入: " << opts.output << std::endl;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "基准测试失败: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,293 @@
+// tools/ocr_eval.cpp
+// 精度评估：ICDAR 风格真值集上运行 OCRInference，同一轮给出检测 P/R/H-mean（IoU 0.5）、识别 CER 与吞吐，JSON 输出供 CI 对比
+// 用法: ocr_eval --config config/service_config.json --images data/icdar2015/test_images --gt data/icdar2015/test_gts
+//       ocr_eval --labels data/det_gt.txt [--root data/]       （PaddleOCR 检测标注格式）
+//       [--iou 0.5] [--limit N] [--per-image] [--output eval.json]
+//       [--baseline last_eval.json --max-hmean-drop 0.01 --max-cer-increase 0.005]   （回归闸门，超出退出码 2）
+//       [--prefilter-shadow]   （裁剪预过滤以 shadow 运行：统计会被误丢的真实文本行）
+#include "ocr_inference.h"
+#include "eval_common.h"
+#include <spdlog/spdlog.h>
+#include <json.hpp>
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#ifndef GIT_VERSION
+#define GIT_VERSION "unknown"
+#endif
+
+namespace {
+
+struct EvalOptions {
+    std::string config_path = "config/service_config.json";
+    std::string images;   // ICDAR：图片目录
+    std::string gt;       // ICDAR：真值目录（gt_<name>.txt 或 <name>.txt）
+    std::string labels;   // 或 PaddleOCR 检测标注
+    std::string root;
+    double iou = 0.5;
+    size_t limit = 0;
+    bool per_image = false;
+    std::string output;
+    std::string baseline;
+    double max_hmean_drop = 0.01;
+    double max_cer_increase = 0.005;
+    bool prefilter_shadow = false;
+};
+
+EvalOptions ParseArgs(int argc, char** argv) {
+    EvalOptions opts;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto next = [&]() -> std::string {
+            if (i + 1 >= argc) throw std::invalid_argument("缺少参数值: " + arg);
+            return argv[++i];
+        };
+        if (arg == "--config") opts.config_path = next();
+        else if (arg == "--images") opts.images = next();
+        else if (arg == "--gt") opts.gt = next();
+        else if (arg == "--labels") opts.labels = next();
+        else if (arg == "--root") opts.root = next();
+        else if (arg == "--iou") opts.iou = std::stod(next());
+        else if (arg == "--limit") opts.limit = std::stoull(next());
+        else if (arg == "--per-image") opts.per_image = true;
+        else if (arg == "--output") opts.output = next();
+        else if (arg == "--baseline") opts.baseline = next();
+        else if (arg == "--max-hmean-drop") opts.max_hmean_drop = std::stod(next());
+        else if (arg == "--max-cer-increase") opts.max_cer_increase = std::stod(next());
+        else if (arg == "--prefilter-shadow") opts.prefilter_shadow = true;
+        else throw std::invalid_argument("未知参数: " + arg);
+    }
+    if (opts.labels.empty() && (opts.images.empty() || opts.gt.empty())) {
+        throw std::invalid_argument("需要 --images + --gt（ICDAR）或 --labels（PaddleOCR）");
+    }
+    return opts;
+}
+
+struct EvalSample {
+    std::string image_path;
+    std::vector<GroundTruthRegion> regions;
+};
+
+std::vector<EvalSample> LoadIcdarSet(const std::string& image_dir, const std::string& gt_dir) {
+    std::vector<std::filesystem::path> images;
+    for (const auto& entry : std::filesystem::directory_iterator(image_dir)) {
+        std::string ext = entry.path().extension().string();
+        std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+        if (ext == ".jpg" || ext == ".jpeg" || ext == ".png" || ext == ".bmp") images.push_back(entry.path());
+    }
+    std::sort(images.begin(), images.end());
+
+    std::vector<EvalSample> samples;
+    for (const auto& image : images) {
+        std::string stem = image.stem().string();
+        std::filesystem::path gt_path = std::filesystem::path(gt_dir) / ("gt_" + stem + ".txt");
+        if (!std::filesystem::exists(gt_path)) gt_path = std::filesystem::path(gt_dir) / (stem + ".txt");
+        if (!std::filesystem::exists(gt_path)) {
+            std::cerr << "跳过（无真值）: " << image.string() << std::endl;
+            continue;
+        }
+        samples.push_back({image.string(), LoadIcdarGroundTruth(gt_path.string())});
+    }
+    return samples;
+}
+
+std::vector<EvalSample> LoadPaddleSet(const std::string& labels, const std::string& root) {
+    std::vector<EvalSample> samples;
+    for (const auto& sample : LoadPaddleLabels(labels, root)) {
+        if (sample.regions.is_null()) throw std::runtime_error("--labels 需为检测标注（图片\\t[{transcription, points}]）");
+        samples.push_back({sample.image_path, RegionsFromPaddleLabel(sample.regions)});
+    }
+    return samples;
+}
+
+double Percentile(std::vector<double> values, double q) {
+    if (values.empty()) return 0.0;
+    std::sort(values.begin(), values.end());
+    return values[std::min(values.size() - 1, static_cast<size_t>(q * (values.size() - 1) + 0.5))];
+}
+
+// 与基线对比：H-mean 下降或 CER 上升超过阈值即回归
+json CompareBaseline(const json& report, const json& baseline, const EvalOptions& opts) {
+    double hmean_drop = baseline["detection"]["hmean"].get<double>() - report["detection"]["hmean"].get<double>();
+    double cer_increase = report["recognition"]["end_to_end"]["cer"].get<double>() -
+                          baseline["recognition"]["end_to_end"]["cer"].get<double>();
+    bool passed = hmean_drop <= opts.max_hmean_drop && cer_increase <= opts.max_cer_increase;
+    return {
+        {"baseline", opts.baseline},
+        {"hmean_drop", hmean_drop},
+        {"cer_increase", cer_increase},
+        {"throughput_ratio", report["throughput"]["images_per_s"].get<double>() /
+                             std::max(1e-9, baseline["throughput"]["images_per_s"].get<double>())},
+        {"passed", passed}
+    };
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    try {
+        EvalOptions opts = ParseArgs(argc, argv);
+        spdlog::set_level(spdlog::level::warn);
+
+        std::ifstream config_file(opts.config_path);
+        if (!config_file.is_open()) throw std::runtime_error("无法加载配置: " + opts.config_path);
+        json service_config = json::parse(config_file).at("service_config");
+        if (opts.prefilter_shadow) {  // 沿用配置中的阈值，只切换模式
+            service_config["model"]["postprocess"]["crop_filter"]["mode"] = "shadow";
+        }
+
+        std::vector<EvalSample> samples = opts.labels.empty() ? LoadIcdarSet(opts.images, opts.gt)
+                                                              : LoadPaddleSet(opts.labels, opts.root);
+        if (opts.limit > 0 && samples.size() > opts.limit) samples.resize(opts.limit);
+        if (samples.empty()) throw std::runtime_error("评估集为空");
+        std::cerr << "评估集: " << samples.size() << " 图" << std::endl;
+
+        OCRInference inference(service_config);
+        // 预热一张，排除首轮 session 初始化开销
+        cv::Mat warm = cv::imread(samples.front().image_path);
+        if (!warm.empty()) inference.Infer(warm);
+
+        size_t gt_care = 0, det_care = 0, matched = 0;
+        TextAccuracy matched_text;   // 匹配上的框：识别文本 vs 真值
+        TextAccuracy e2e_text;       // 全部计分真值：未检出按空预测计
+        // shadow 预过滤：带 "prefilter" 的结果在 enforce 下不会输出
+        size_t prefilter_results = 0, prefilter_true_lines = 0, prefilter_correct_lines = 0;
+        std::map<std::string, size_t> prefilter_reasons;
+        TextAccuracy e2e_enforced;   // 假设 enforce 后的端到端精度
+        std::vector<double> latencies;
+        json per_image = json::array();
+
+        auto wall_start = std::chrono::steady_clock::now();
+        for (const auto& sample : samples) {
+            cv::Mat img = cv::imread(sample.image_path);
+            if (img.empty()) throw std::runtime_error("图像加载失败: " + sample.image_path);
+
+            auto start = std::chrono::steady_clock::now();
+            json response = inference.Infer(img);
+            latencies.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+
+            std::vector<std::vector<cv::Point2f>> detections;
+            std::vector<std::string> texts;
+            std::vector<bool> prefiltered;
+            for (const auto& r : response["results"]) {
+                auto b = r["bbox"].get<std::vector<float>>();  // [x1,y1,x2,y2]
+                detections.push_back({{b[0], b[1]}, {b[2], b[1]}, {b[2], b[3]}, {b[0], b[3]}});
+                texts.push_back(r["text"].get<std::string>());
+                prefiltered.push_back(r.contains("prefilter"));
+                if (prefiltered.back()) {
+                    ++prefilter_results;
+                    ++prefilter_reasons[r["prefilter"].get<std::string>()];
+                }
+            }
+
+            DetectionMatch match = MatchDetections(sample.regions, detections, opts.iou);
+            gt_care += match.gt_care;
+            det_care += match.det_care;
+            matched += match.pairs.size();
+
+            std::vector<int> prediction_for_gt(sample.regions.size(), -1);
+            for (const auto& [g, d] : match.pairs) {
+                prediction_for_gt[g] = d;
+                matched_text.Add(texts[d], sample.regions[g].text);
+            }
+            for (size_t g = 0; g < sample.regions.size(); ++g) {
+                if (sample.regions[g].ignore) continue;
+                int d = prediction_for_gt[g];
+                e2e_text.Add(d >= 0 ? texts[d] : std::string(), sample.regions[g].text);
+                if (!opts.prefilter_shadow) continue;
+                bool dropped = d >= 0 && prefiltered[d];
+                if (dropped) {
+                    ++prefilter_true_lines;
+                    if (texts[d] == sample.regions[g].text) ++prefilter_correct_lines;
+                }
+                e2e_enforced.Add(d >= 0 && !dropped ? texts[d] : std::string(), sample.regions[g].text);
+            }
+
+            if (opts.per_image) {
+                per_image.push_back({
+                    {"image", sample.image_path},
+                    {"gt", match.gt_care},
+                    {"det", match.det_care},
+                    {"matched", match.pairs.size()},
+                    {"latency_ms", latencies.back()}
+                });
+            }
+        }
+        double wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+
+        double precision = det_care ? static_cast<double>(matched) / det_care : 0.0;
+        double recall = gt_care ? static_cast<double>(matched) / gt_care : 0.0;
+        double hmean = precision + recall > 0 ? 2 * precision * recall / (precision + recall) : 0.0;
+        double mean_ms = std::accumulate(latencies.begin(), latencies.end(), 0.0) / latencies.size();
+
+        json report;
+        report["meta"] = {
+            {"git_version", GIT_VERSION},
+            {"config", opts.config_path},
+            {"dataset", opts.labels.empty() ? opts.gt : opts.labels},
+            {"images", samples.size()},
+            {"iou_threshold", opts.iou},
+            {"models", inference.ModelVariants()},
+            {"timestamp", static_cast<int64_t>(std::time(nullptr))}
+        };
+        report["detection"] = {
+            {"precision", precision},
+            {"recall", recall},
+            {"hmean", hmean},
+            {"gt", gt_care},
+            {"det", det_care},
+            {"matched", matched}
+        };
+        report["recognition"] = {{"matched", matched_text.ToJson()}, {"end_to_end", e2e_text.ToJson()}};
+        report["throughput"] = {
+            {"images", samples.size()},
+            {"wall_s", wall_s},
+            {"images_per_s", samples.size() / wall_s},
+            {"latency_ms", {{"mean", mean_ms}, {"p50", Percentile(latencies, 0.5)}, {"p90", Percentile(latencies, 0.9)},
+                            {"p99", Percentile(latencies, 0.99)}}}
+        };
+        if (opts.prefilter_shadow) {
+            // true_lines：被标记为“会丢弃”但匹配到计分真值的框（enforce 下的误丢）
+            report["prefilter"] = {
+                {"mode", "shadow"},
+                {"flagged_results", prefilter_results},
+                {"reasons", prefilter_reasons},
+                {"true_lines", prefilter_true_lines},
+                {"true_lines_correct", prefilter_correct_lines},
+                {"true_line_rate", gt_care ? static_cast<double>(prefilter_true_lines) / gt_care : 0.0},
+                {"end_to_end_if_enforced", e2e_enforced.ToJson()}
+            };
+        }
+        if (opts.per_image) report["per_image"] = per_image;
+
+        int exit_code = 0;
+        if (!opts.baseline.empty()) {
+            std::ifstream baseline_file(opts.baseline);
+            if (!baseline_file.is_open()) throw std::runtime_error("无法读取基线: " + opts.baseline);
+            report["regression"] = CompareBaseline(report, json::parse(baseline_file), opts);
+            if (!report["regression"]["passed"].get<bool>()) exit_code = 2;
+        }
+
+        std::cerr << "检测 P " << precision << " R " << recall << " H " << hmean << ", 识别 CER "
+                  << matched_text.Cer() << "（端到端 " << e2e_text.Cer() << "）, " << samples.size() / wall_s
+                  << " 图/秒" << (exit_code ? "，相对基线回归" : "") << std::endl;
+        std::string text = report.dump(2);
+        if (opts.output.empty()) {
+            std::cout << text << std::endl;
+        } else {
+            std::ofstream(opts.output) << text << std::endl;
+        }
+        return exit_code;
+    } catch (const std::exception& e) {
+        std::cerr << "评估失败: " << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,222 @@
+// tools/ocr_ipc_bench.cpp
+// 摄取路径对比：同一批已解码图像分别经 HTTP /ocr（编码 + base64 + JSON）与共享内存通道（service.ipc）
+// 发给运行中的 ocr_server，闭环 N 并发，输出两条路径的吞吐、延迟与客户端准备耗时
+// 用法: ocr_ipc_bench --url http://127.0.0.1:8000 --ipc /tmp/ocr/ingest.sock [--input images/]
+//                      [--requests 200] [--concurrency 1] [--encode .png] [--output report.json]
+#include "ocr_ipc.h"
+#include "synthetic_doc.h"
+#include <httplib.h>
+#include <json.hpp>
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <numeric>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef GIT_VERSION
+#define GIT_VERSION "unknown"
+#endif
+
+using json = nlohmann::json;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+struct IpcBenchOptions {
+    std::string url = "http://127.0.0.1:8000";
+    std::string ipc_socket = "/tmp/ocr/ingest.sock";
+    std::string input;          // 空 = 合成文档
+    size_t requests = 200;      // 每条路径的请求数
+    int concurrency = 1;
+    std::string encode = ".png";  // HTTP 路径的图像编码（.png 无损；.jpg 更小但有损）
+    std::string output;         // 空 = stdout
+};
+
+IpcBenchOptions ParseArgs(int argc, char** argv) {
+    IpcBenchOptions opts;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto next = [&]() -> std::string {
+            if (i + 1 >= argc) throw std::invalid_argument("缺少参数值: " + arg);
+            return argv[++i];
+        };
+        if (arg == "--url") opts.url = next();
+        else if (arg == "--ipc") opts.ipc_socket = next();
+        else if (arg == "--input") opts.input = next();
+        else if (arg == "--requests") opts.requests = std::max<size_t>(1, std::stoull(next()));
+        else if (arg == "--concurrency") opts.concurrency = std::max(1, std::stoi(next()));
+        else if (arg == "--encode") opts.encode = next();
+        else if (arg == "--output") opts.output = next();
+        else throw std::invalid_argument("未知参数: " + arg);
+    }
+    return opts;
+}
+
+double Percentile(std::vector<double>& sorted, double q) {
+    if (sorted.empty()) return 0.0;
+    size_t idx = std::min(sorted.size() - 1, static_cast<size_t>(q * (sorted.size() - 1) + 0.5));
+    return sorted[idx];
+}
+
+std::vector<cv::Mat> LoadImages(const std::string& input) {
+    std::vector<cv::Mat> images;
+    if (input.empty()) {
+        for (const auto& spec : DefaultBenchSpecs()) images.push_back(RenderSyntheticDoc(spec).image);
+        return images;
+    }
+    std::vector<std::filesystem::path> files;
+    for (const auto& entry : std::filesystem::directory_iterator(input)) {
+        if (entry.is_regular_file()) files.push_back(entry.path());
+    }
+    std::sort(files.begin(), files.end());
+    for (const auto& file : files) {
+        cv::Mat img = cv::imread(file.string(), cv::IMREAD_COLOR);
+        if (!img.empty()) images.push_back(img);
+    }
+    if (images.empty()) throw std::runtime_error("目录中没有可读取的图像: " + input);
+    return images;
+}
+
+// 单次请求：返回 {状态码, 结果条数}；prep_ms 为客户端发送前的准备耗时（编码 / 拷贝）
+struct Outcome {
+    int status = 0;
+    size_t results = 0;
+    double prep_ms = 0.0;
+};
+
+// threads 个客户端（各自一条连接）共同完成 total 次请求
+template <typename MakeClient>
+json RunTransport(const std::vector<cv::Mat>& images, size_t total, int threads, MakeClient&& make_client,
+                  std::vector<size_t>& results_per_image) {
+    std::atomic<size_t> next{0};
+    std::vector<std::vector<double>> latencies(threads), preps(threads);
+    std::vector<std::map<int, size_t>> statuses(threads);
+    results_per_image.assign(images.size(), 0);
+    std::mutex results_mutex;
+
+    auto start = Clock::now();
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            auto send = make_client();
+            for (size_t i = next++; i < total; i = next++) {
+                auto call_start = Clock::now();
+                Outcome outcome = send(images[i % images.size()]);
+                latencies[t].push_back(std::chrono::duration<double, std::milli>(Clock::now() - call_start).count());
+                preps[t].push_back(outcome.prep_ms);
+                ++statuses[t][outcome.status];
+                if (outcome.status == 200 && i < images.size()) {
+                    std::lock_guard<std::mutex> lock(results_mutex);
+                    results_per_image[i] = outcome.results;
+                }
+            }
+        });
+    }
+    for (auto& w : workers) w.join();
+    double wall_s = std::chrono::duration<double>(Clock::now() - start).count();
+
+    std::vector<double> all, prep;
+    std::map<std::string, size_t> status_counts;
+    for (int t = 0; t < threads; ++t) {
+        all.insert(all.end(), latencies[t].begin(), latencies[t].end());
+        prep.insert(prep.end(), preps[t].begin(), preps[t].end());
+        for (const auto& [status, count] : statuses[t]) status_counts[std::to_string(status)] += count;
+    }
+    std::sort(all.begin(), all.end());
+    double prep_mean = prep.empty() ? 0.0 : std::accumulate(prep.begin(), prep.end(), 0.0) / prep.size();
+    return {
+        {"requests", total},
+        {"wall_s", wall_s},
+        {"throughput_per_s", wall_s > 0 ? total / wall_s : 0.0},
+        {"status", status_counts},
+        {"client_prep_ms", prep_mean},
+        {"latency_ms", {{"p50", Percentile(all, 0.5)}, {"p90", Percentile(all, 0.9)}, {"p99", Percentile(all, 0.99)},
+                        {"max", all.empty() ? 0.0 : all.back()}}}
+    };
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    try {
+        IpcBenchOptions opts = ParseArgs(argc, argv);
+        std::vector<cv::Mat> images = LoadImages(opts.input);
+        size_t pixels = 0;
+        for (const auto& img : images) pixels += img.total();
+        std::cerr << "图像: " << images.size() << " 张, 平均 " << pixels / images.size() / 1000 << " K 像素" << std::endl;
+
+        // HTTP：编码 → base64 → JSON，与现有客户端一致
+        auto http_client = [&] {
+            auto client = std::make_shared<httplib::Client>(opts.url);
+            client->set_read_timeout(120, 0);
+            return [client, &opts](const cv::Mat& img) {
+                Outcome outcome;
+                auto prep_start = Clock::now();
+                std::vector<uchar> encoded;
+                cv::imencode(opts.encode, img, encoded);
+                std::string body = json{{"image_base64", httplib::detail::base64_encode(
+                                                             std::string(encoded.begin(), encoded.end()))}}.dump();
+                outcome.prep_ms = std::chrono::duration<double, std::milli>(Clock::now() - prep_start).count();
+                auto res = client->Post("/ocr", body, "application/json");
+                outcome.status = res ? res->status : -1;
+                if (res && res->status == 200) outcome.results = json::parse(res->body)["results"].size();
+                return outcome;
+            };
+        };
+        // 共享内存：像素拷入槽位 + 门铃
+        auto ipc_client = [&] {
+            auto client = std::make_shared<IpcClient>(opts.ipc_socket);
+            return [client](const cv::Mat& img) {
+                Outcome outcome;
+                auto prep_start = Clock::now();
+                client->Submit(img.data, img.cols, img.rows, img.step[0]);
+                outcome.prep_ms = std::chrono::duration<double, std::milli>(Clock::now() - prep_start).count();
+                IpcReply reply = client->Receive();
+                outcome.status = reply.status;
+                if (reply.status == 200) outcome.results = reply.body["results"].size();
+                return outcome;
+            };
+        };
+
+        // 预热：每张图各路径一次（首轮形状特化不计入）
+        std::vector<size_t> http_results, ipc_results;
+        RunTransport(images, images.size(), 1, http_client, http_results);
+        RunTransport(images, images.size(), 1, ipc_client, ipc_results);
+
+        std::cerr << "HTTP /ocr ..." << std::endl;
+        json http = RunTransport(images, opts.requests, opts.concurrency, http_client, http_results);
+        std::cerr << "共享内存 ..." << std::endl;
+        json ipc = RunTransport(images, opts.requests, opts.concurrency, ipc_client, ipc_results);
+
+        double http_tput = http["throughput_per_s"], ipc_tput = ipc["throughput_per_s"];
+        json report = {
+            {"meta", {{"git_version", GIT_VERSION}, {"url", opts.url}, {"ipc", opts.ipc_socket},
+                      {"images", images.size()}, {"concurrency", opts.concurrency}, {"encode", opts.encode},
+                      {"timestamp", static_cast<int64_t>(std::time(nullptr))}}},
+            {"http", http},
+            {"ipc", ipc},
+            {"speedup", http_tput > 0 ? ipc_tput / http_tput : 0.0},
+            {"results_match", http_results == ipc_results}  // 无损编码时两条路径结果条数应一致
+        };
+        std::string text = report.dump(2);
+        if (opts.output.empty()) {
+            std::cout << text << std::endl;
+        } else {
+            std::ofstream(opts.output) << text << std::endl;
+            std::cerr << "结果已写入: " << opts.output << std::endl;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "对比失败: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,257 @@
+// tools/ocr_quant_eval.cpp
+// INT8 量化模型精度闸门：同一标注集分别跑 FP32 与 INT8 管道，对比 CER / 准确率与速度；
+// 精度下降在阈值内才为 INT8 模型写入批准清单（<int8_path>.approval.json），服务只加载已批准的 INT8 模型
+// 用法: ocr_quant_eval --config config/service_config.json --labels eval/rec_gt.txt
+//                      [--root eval/] [--max-cer-increase 0.005] [--max-accuracy-drop 0.01] [--dry-run] [--output report.json]
+// 标注为识别集（图片\t文本，评估 rec）或检测集（图片\t[{"transcription","points"}]，评估 det + rec 端到端）
+#include "ocr_inference.h"
+#include "ocr_quant.h"
+#include "eval_common.h"
+#include <spdlog/spdlog.h>
+#include <json.hpp>
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#ifndef GIT_VERSION
+#define GIT_VERSION "unknown"
+#endif
+
+namespace {
+
+struct EvalOptions {
+    std::string config_path = "config/service_config.json";
+    std::string labels;
+    std::string root;
+    double max_cer_increase = 0.005;   // CER 绝对增量上限
+    double max_accuracy_drop = 0.01;   // 准确率绝对下降上限
+    bool dry_run = false;              // 只出报告，不写批准清单
+    std::string output;
+};
+
+EvalOptions ParseArgs(int argc, char** argv) {
+    EvalOptions opts;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto next = [&]() -> std::string {
+            if (i + 1 >= argc) throw std::invalid_argument("缺少参数值: " + arg);
+            return argv[++i];
+        };
+        if (arg == "--config") opts.config_path = next();
+        else if (arg == "--labels") opts.labels = next();
+        else if (arg == "--root") opts.root = next();
+        else if (arg == "--max-cer-increase") opts.max_cer_increase = std::stod(next());
+        else if (arg == "--max-accuracy-drop") opts.max_accuracy_drop = std::stod(next());
+        else if (arg == "--dry-run") opts.dry_run = true;
+        else if (arg == "--output") opts.output = next();
+        else throw std::invalid_argument("未知参数: " + arg);
+    }
+    if (opts.labels.empty()) throw std::invalid_argument("缺少 --labels");
+    return opts;
+}
+
+// 端到端参考文本：按区域上边缘排序后逐行拼接（跳过 ### 忽略区域）
+std::vector<std::string> ReferenceLines(const json& regions) {
+    std::vector<std::pair<float, std::string>> lines;
+    for (const auto& region : regions) {
+        std::string text = region.value("transcription", "");
+        if (text.empty() || text == "###") continue;
+        float top = 1e9f;
+        for (const auto& pt : region.at("points")) top = std::min(top, pt.at(1).get<float>());
+        lines.emplace_back(top, std::move(text));
+    }
+    std::stable_sort(lines.begin(), lines.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+    std::vector<std::string> result;
+    for (auto& line : lines) result.push_back(std::move(line.second));
+    return result;
+}
+
+std::string JoinLines(const std::vector<std::string>& lines) {
+    std::string joined;
+    for (const auto& line : lines) {
+        if (!joined.empty()) joined += '\n';
+        joined += line;
+    }
+    return joined;
+}
+
+struct PipelineResult {
+    TextAccuracy text;        // 识别集：逐样本；端到端：整图拼接文本
+    TextAccuracy lines;       // 端到端：参考行是否被完整识别出（行级召回）
+    double total_ms = 0.0;
+    size_t calls = 0;
+
+    json ToJson() const {
+        json j = text.ToJson();
+        if (lines.Samples() > 0) j["line_recall"] = lines.Accuracy();
+        j["avg_ms"] = calls ? total_ms / calls : 0.0;
+        return j;
+    }
+};
+
+class QuantEvaluator {
+public:
+    QuantEvaluator(const json& service_config, const std::string& precision) {
+        json config = service_config;
+        auto& model = config["model"];
+        model["precision"] = precision;
+        model["det_model"].erase("precision");  // 模型级覆盖会屏蔽对比
+        model["rec_model"].erase("precision");
+        model["require_int8_approval"] = false;  // 待评估的 INT8 模型本就未批准
+        inference_ = std::make_unique<OCRInference>(config);
+        // 识别集直接调用 rec（与管道加载同一变体）
+        json rec_config = model.at("rec_model");
+        rec_config["character_dict"] = model.at("character_dict");
+        rec_config["postprocess"] = model.at("postprocess");
+        rec_config["path"] = inference_->ModelVariants()["rec"]["path"];
+        rec_config["loading"] = model.value("loading", json::object());
+        recognizer_ = std::make_unique<OCRRecognize>(rec_config);
+    }
+
+    const json& Variants() const { return inference_->ModelVariants(); }
+
+    PipelineResult Run(const std::vector<LabeledSample>& samples, const std::vector<cv::Mat>& images) {
+        PipelineResult result;
+        for (size_t i = 0; i < samples.size(); ++i) {
+            const auto& sample = samples[i];
+            auto start = std::chrono::steady_clock::now();
+            if (sample.regions.is_null()) {
+                float score = 0.0f;
+                std::string text = recognizer_->Recognize(images[i], score);
+                result.total_ms += ElapsedMs(start);
+                result.text.Add(text, sample.text);
+            } else {
+                json response = inference_->Infer(images[i]);
+                result.total_ms += ElapsedMs(start);
+                std::vector<std::string> predicted;
+                for (const auto& r : response["results"]) predicted.push_back(r["text"].get<std::string>());
+                std::vector<std::string> reference = ReferenceLines(sample.regions);
+                result.text.Add(JoinLines(predicted), JoinLines(reference));
+                for (const auto& line : reference) {
+                    bool found = std::find(predicted.begin(), predicted.end(), line) != predicted.end();
+                    result.lines.Add(found ? line : std::string(), line);
+                }
+            }
+            ++result.calls;
+        }
+        return result;
+    }
+
+private:
+    std::unique_ptr<OCRInference> inference_;
+    std::unique_ptr<OCRRecognize> recognizer_;
+
+    static double ElapsedMs(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+};
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    try {
+        EvalOptions opts = ParseArgs(argc, argv);
+        spdlog::set_level(spdlog::level::warn);
+
+        std::ifstream config_file(opts.config_path);
+        if (!config_file.is_open()) throw std::runtime_error("无法加载配置: " + opts.config_path);
+        json service_config = json::parse(config_file).at("service_config");
+
+        auto samples = LoadPaddleLabels(opts.labels, opts.root);
+        bool end_to_end = !samples.front().regions.is_null();
+        std::vector<cv::Mat> images;
+        for (const auto& sample : samples) {
+            cv::Mat img = cv::imread(sample.image_path);
+            if (img.empty()) throw std::runtime_error("图像加载失败: " + sample.image_path);
+            images.push_back(std::move(img));
+        }
+        std::cerr << "评估集: " << samples.size() << (end_to_end ? " 图（端到端）" : " 行（识别）") << std::endl;
+
+        QuantEvaluator fp32(service_config, "fp32");
+        QuantEvaluator int8(service_config, "int8");
+        // 识别集只评估 rec；端到端评估 det + rec 中已配置 int8_path 的模型
+        std::vector<std::string> candidates;
+        for (const char* tag : {"det", "rec"}) {
+            if (!end_to_end && std::string(tag) == "det") continue;
+            if (int8.Variants()[tag]["precision"] == "int8") candidates.push_back(tag);
+        }
+        if (candidates.empty()) throw std::runtime_error("没有可评估的 INT8 模型（检查 int8_path）");
+
+        // 预热：各跑一遍前几个样本，排除首轮开销
+        size_t warmup = std::min<size_t>(3, samples.size());
+        std::vector<LabeledSample> warm_samples(samples.begin(), samples.begin() + warmup);
+        std::vector<cv::Mat> warm_images(images.begin(), images.begin() + warmup);
+        fp32.Run(warm_samples, warm_images);
+        int8.Run(warm_samples, warm_images);
+
+        PipelineResult fp32_result = fp32.Run(samples, images);
+        PipelineResult int8_result = int8.Run(samples, images);
+
+        double cer_increase = int8_result.text.Cer() - fp32_result.text.Cer();
+        double accuracy_drop = fp32_result.text.Accuracy() - int8_result.text.Accuracy();
+        double fp32_ms = fp32_result.calls ? fp32_result.total_ms / fp32_result.calls : 0.0;
+        double int8_ms = int8_result.calls ? int8_result.total_ms / int8_result.calls : 0.0;
+        double speedup = int8_ms > 0 ? fp32_ms / int8_ms : 0.0;
+
+        bool approved = cer_increase <= opts.max_cer_increase && accuracy_drop <= opts.max_accuracy_drop;
+        std::string reason = approved ? "ok"
+            : "CER +" + std::to_string(cer_increase) + " (上限 " + std::to_string(opts.max_cer_increase) + "), 准确率 -" +
+              std::to_string(accuracy_drop) + " (上限 " + std::to_string(opts.max_accuracy_drop) + ")";
+
+        json report = {
+            {"labels", opts.labels},
+            {"mode", end_to_end ? "e2e" : "rec"},
+            {"fp32", fp32_result.ToJson()},
+            {"int8", int8_result.ToJson()},
+            {"cer_increase", cer_increase},
+            {"accuracy_drop", accuracy_drop},
+            {"speedup", speedup},
+            {"thresholds", {{"max_cer_increase", opts.max_cer_increase}, {"max_accuracy_drop", opts.max_accuracy_drop}}},
+            {"approved", approved},
+            {"reason", reason},
+            {"models", json::object()}
+        };
+
+        for (const auto& tag : candidates) {
+            std::string path = int8.Variants()[tag]["path"];
+            json manifest = {
+                {"model", path},
+                {"fp32_model", fp32.Variants()[tag]["path"]},
+                {"fingerprint", ModelFingerprint(path)},
+                {"approved", approved},
+                {"reason", reason},
+                {"labels", opts.labels},
+                {"mode", report["mode"]},
+                {"fp32_cer", fp32_result.text.Cer()},
+                {"int8_cer", int8_result.text.Cer()},
+                {"fp32_accuracy", fp32_result.text.Accuracy()},
+                {"int8_accuracy", int8_result.text.Accuracy()},
+                {"speedup", speedup},
+                {"git_version", GIT_VERSION},
+                {"timestamp", static_cast<int64_t>(std::time(nullptr))}
+            };
+            report["models"][tag] = path;
+            if (!opts.dry_run) {
+                WriteApproval(path, manifest);
+                std::cerr << (approved ? "已批准: " : "未批准: ") << ApprovalManifestPath(path) << std::endl;
+            }
+        }
+
+        std::cerr << "FP32 CER " << fp32_result.text.Cer() << " / INT8 CER " << int8_result.text.Cer()
+                  << ", 加速 " << speedup << "x, " << (approved ? "通过" : "未通过: " + reason) << std::endl;
+        std::string text = report.dump(2);
+        if (opts.output.empty()) {
+            std::cout << text << std::endl;
+        } else {
+            std::ofstream(opts.output) << text << std::endl;
+        }
+        return approved ? 0 : 2;
+    } catch (const std::exception& e) {
+        std::cerr << "量化评估失败: " << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,106 @@
+#include "synthetic_doc.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+const char* kWords[] = {"Invoice", "Total", "Amount", "Date", "No.", "Customer", "Address", "Tax", "Paid",
+                        "Order", "Item", "Qty", "Price", "Hello", "World", "OCR", "Service", "Report",
+                        "Account", "Balance", "Due", "Ref", "Page", "Summary"};
+
+// 线性同余随机数（跨平台结果一致，便于对比不同提交的基准）
+unsigned NextRandom(unsigned& state) {
+    state = state * 1103515245u + 12345u;
+    return (state >> 16) & 0x7FFF;
+}
+
+}  // namespace
+
+std::string RandomTextLine(unsigned& state, int min_words, int max_words) {
+    int words = min_words + static_cast<int>(NextRandom(state) % (max_words - min_words + 1));
+    std::string line;
+    for (int i = 0; i < words; ++i) {
+        if (!line.empty()) line += ' ';
+        if (NextRandom(state) % 4 == 0) {
+            line += std::to_string(NextRandom(state) * 37 % 100000);
+        } else {
+            line += kWords[NextRandom(state) % (sizeof(kWords) / sizeof(kWords[0]))];
+        }
+    }
+    return line;
+}
+
+SyntheticDoc RenderSyntheticDoc(const SyntheticDocSpec& spec) {
+    SyntheticDoc doc;
+    doc.image = cv::Mat(spec.height, spec.width, CV_8UC3, cv::Scalar(255, 255, 255));
+    unsigned state = spec.seed * 2654435761u + 1;
+
+    const int font = cv::FONT_HERSHEY_SIMPLEX;
+    int thickness = std::max(1, static_cast<int>(std::round(spec.font_scale * 2)));
+    int baseline = 0;
+    int line_height = cv::getTextSize("Ag", font, spec.font_scale, thickness, &baseline).height + baseline;
+    int pitch = std::max(line_height * 2, spec.height / std::max(1, spec.lines + 1));
+    int margin = spec.width / 20;
+
+    std::vector<std::array<cv::Point2f, 4>> boxes;
+    for (int i = 0; i < spec.lines; ++i) {
+        int y = pitch * (i + 1);
+        if (y + baseline >= spec.height) break;
+        std::string text = RandomTextLine(state, 2, 6);
+        cv::Size size = cv::getTextSize(text, font, spec.font_scale, thickness, &baseline);
+        int x = margin + static_cast<int>(NextRandom(state) % std::max(1, spec.width / 8));
+        if (x + size.width >= spec.width) size.width = spec.width - x - 1;
+        cv::putText(doc.image, text, cv::Point(x, y), font, spec.font_scale, cv::Scalar(0, 0, 0), thickness, cv::LINE_AA);
+
+        float top = static_cast<float>(y - size.height), bottom = static_cast<float>(y + baseline);
+        float left = static_cast<float>(x), right = static_cast<float>(x + size.width);
+        boxes.push_back({cv::Point2f(left, top), cv::Point2f(right, top), cv::Point2f(right, bottom), cv::Point2f(left, bottom)});
+        doc.texts.push_back(std::move(text));
+    }
+
+    if (spec.rotation_deg != 0.0) {
+        cv::Point2f center(spec.width / 2.0f, spec.height / 2.0f);
+        cv::Mat rot = cv::getRotationMatrix2D(center, spec.rotation_deg, 1.0);
+        cv::warpAffine(doc.image, doc.image, rot, doc.image.size(), cv::INTER_LINEAR, cv::BORDER_CONSTANT,
+                       cv::Scalar(255, 255, 255));
+        for (auto& quad : boxes) {
+            for (auto& pt : quad) {
+                double px = rot.at<double>(0, 0) * pt.x + rot.at<double>(0, 1) * pt.y + rot.at<double>(0, 2);
+                double py = rot.at<double>(1, 0) * pt.x + rot.at<double>(1, 1) * pt.y + rot.at<double>(1, 2);
+                pt = cv::Point2f(static_cast<float>(px), static_cast<float>(py));
+            }
+        }
+    }
+    doc.quads = std::move(boxes);
+    return doc;
+}
+
+cv::Mat RenderTextLine(const std::string& text, double font_scale) {
+    const int font = cv::FONT_HERSHEY_SIMPLEX;
+    int thickness = std::max(1, static_cast<int>(std::round(font_scale * 2)));
+    int baseline = 0;
+    cv::Size size = cv::getTextSize(text, font, font_scale, thickness, &baseline);
+    int pad = std::max(4, size.height / 4);
+    cv::Mat line(size.height + baseline + 2 * pad, size.width + 2 * pad, CV_8UC3, cv::Scalar(255, 255, 255));
+    cv::putText(line, text, cv::Point(pad, pad + size.height), font, font_scale, cv::Scalar(0, 0, 0), thickness, cv::LINE_AA);
+    return line;
+}
+
+std::vector<SyntheticDocSpec> DefaultBenchSpecs() {
+    std::vector<SyntheticDocSpec> specs;
+    const cv::Size resolutions[] = {{640, 480}, {1280, 960}, {1920, 1080}};
+    const double font_scales[] = {0.6, 1.0};
+    const int densities[] = {5, 20};
+    const double rotations[] = {0.0, 5.0};
+    unsigned seed = 0;
+    for (const auto& res : resolutions) {
+        for (double scale : font_scales) {
+            for (int lines : densities) {
+                for (double rot : rotations) {
+                    specs.push_back({res.width, res.height, scale * res.width / 1280.0 + 0.2, lines, rot, seed++});
+                }
+            }
+        }
+    }
+    return specs;
+}
@@ -0,0 +1,37 @@
+#ifndef SYNTHETIC_DOC_H
+#define SYNTHETIC_DOC_H
+
+#include <opencv2/opencv.hpp>
+#include <array>
+#include <string>
+#include <vector>
+
+// 合成文档参数：分辨率、字号、行密度、旋转
+struct SyntheticDocSpec {
+    int width = 1280;
+    int height = 960;
+    double font_scale = 0.8;
+    int lines = 12;             // 文本行数（密度）
+    double rotation_deg = 0.0;  // 整页旋转角度
+    unsigned seed = 0;
+};
+
+struct SyntheticDoc {
+    cv::Mat image;                                   // BGR，白底黑字
+    std::vector<std::string> texts;                  // 每行文本
+    std::vector<std::array<cv::Point2f, 4>> quads;   // 每行文本框（旋转后，顺时针自左上）
+};
+
+// 用 cv::putText 渲染合成文档（Hershey 字体，仅 ASCII）
+SyntheticDoc RenderSyntheticDoc(const SyntheticDocSpec& spec);
+
+// 单行文本裁剪图（识别基准用）
+cv::Mat RenderTextLine(const std::string& text, double font_scale);
+
+// 随机 ASCII 文本行（单词 + 数字）
+std::string RandomTextLine(unsigned& state, int min_words, int max_words);
+
+// 默认基准集：分辨率 × 字号 × 密度 × 旋转 的组合
+std::vector<SyntheticDocSpec> DefaultBenchSpecs();
+
+#endif // SYNTHETIC_DOC_H